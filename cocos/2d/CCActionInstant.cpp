@@ -28,6 +28,7 @@
 #include "2d/CCActionInstant.h"
 #include "2d/CCNode.h"
 #include "2d/CCSprite.h"
+#include "base/allocator/CCAllocatorStrategySlab.h"
 
 #if defined(__GNUC__) && ((__GNUC__ >= 4) || ((__GNUC__ == 3) && (__GNUC_MINOR__ >= 1)))
 #pragma GCC diagnostic ignored "-Wdeprecated-declarations"
@@ -319,6 +320,8 @@ void Place::update(float time) {
 // CallFunc
 //
 
+CC_IMPLEMENT_ALLOCATOR_SLAB(CallFunc)
+
 CallFunc * CallFunc::create(const std::function<void()> &func)
 {
     CallFunc *ret = new (std::nothrow) CallFunc();
@@ -318,6 +318,8 @@ private:
 class CC_DLL CallFunc : public ActionInstant //<NSCopying>
 {
 public:
+    CC_USE_ALLOCATOR_SLAB(CallFunc)
+
     /** Creates the action with the callback of type std::function<void()>.
      This is the preferred way to create the callback.
      * When this funtion bound in js or lua ,the input param will be changed.
@@ -37,6 +37,7 @@ THE SOFTWARE.
 #include "base/CCEventCustom.h"
 #include "base/CCEventDispatcher.h"
 #include "platform/CCStdC.h"
+#include "base/allocator/CCAllocatorStrategySlab.h"
 
 NS_CC_BEGIN
 
@@ -110,7 +111,7 @@ bool ActionInterval::isDone() const
     return _elapsed >= _duration;
 }
 
-void ActionInterval::step(float dt)
+float ActionInterval::advanceElapsed(float dt)
 {
     if (_firstTick)
     {
@@ -122,12 +123,16 @@ void ActionInterval::step(float dt)
         _elapsed += dt;
     }
     
-    this->update(MAX (0,                                  // needed for rewind. elapsed could be negative
-                      MIN(1, _elapsed /
-                          MAX(_duration, FLT_EPSILON)   // division by 0
-                          )
-                      )
-                 );
+    return MAX (0,                                  // needed for rewind. elapsed could be negative
+                MIN(1, _elapsed /
+                    MAX(_duration, FLT_EPSILON)   // division by 0
+                    )
+                );
+}
+
+void ActionInterval::step(float dt)
+{
+    this->update(advanceElapsed(dt));
 }
 
 void ActionInterval::setAmplitudeRate(float amp)
@@ -156,6 +161,8 @@ void ActionInterval::startWithTarget(Node *target)
 // Sequence
 //
 
+CC_IMPLEMENT_ALLOCATOR_SLAB(Sequence)
+
 Sequence* Sequence::createWithTwoActions(FiniteTimeAction *actionOne, FiniteTimeAction *actionTwo)
 {
     Sequence *sequence = new (std::nothrow) Sequence();
@@ -72,6 +72,16 @@ public:
      */
     inline float getElapsed(void) { return _elapsed; }
 
+    /** Moves the elapsed time forward the way step() does, without updating the action.
+     * ActionManager uses it to step common actions without virtual calls.
+     *
+     * @param dt In seconds.
+     * @return The progress, between 0 and 1, that step() passes to update().
+     * @js NA
+     * @lua NA
+     */
+    float advanceElapsed(float dt);
+
     /** Sets the ampliture rate, extension in GridAction
      *
      * @param amp   The ampliture rate.
@@ -120,6 +130,8 @@ protected:
 class CC_DLL Sequence : public ActionInterval
 {
 public:
+    CC_USE_ALLOCATOR_SLAB(Sequence)
+
     /** Helper constructor to create an array of sequenceable actions.
      *
      * @return An autoreleased Sequence object.
@@ -27,12 +27,19 @@ THE SOFTWARE.
 ****************************************************************************/
 
 #include "2d/CCActionManager.h"
+
+#include <algorithm>
+#include <typeinfo>
+
 #include "2d/CCNode.h"
 #include "2d/CCAction.h"
+#include "2d/CCActionInterval.h"
+#include "2d/CCActionEase.h"
+#include "2d/CCTweenFunction.h"
 #include "base/CCScheduler.h"
 #include "base/ccMacros.h"
-#include "base/ccCArray.h"
 #include "base/uthash.h"
+#include "base/CCProfiling.h"
 
 NS_CC_BEGIN
 //
@@ -40,19 +47,109 @@ NS_CC_BEGIN
 //
 typedef struct _hashElement
 {
-    struct _ccArray     *actions;
     Node                *target;
-    int                 actionIndex;
-    Action              *currentAction;
-    bool                currentActionSalvaged;
     bool                paused;
+    // true while the element waits in _emptiedElements
+    bool                emptied;
+    // the retained actions of the target, in the order they were added, and where each one is stored
+    std::vector<Action*>                        actions;
+    std::vector<ActionManager::ActionLocation>  locations;
     UT_hash_handle      hh;
 } tHashElement;
 
+// Easing of the eased actions stepped without virtual calls. The values up to
+// tweenfunc::TWEEN_EASING_MAX are tween types passed to tweenfunc::tweenTo().
+enum
+{
+    EASING_NONE = tweenfunc::Linear,
+    EASING_RATE_IN = tweenfunc::TWEEN_EASING_MAX + 1,
+    EASING_RATE_OUT,
+    EASING_RATE_IN_OUT,
+};
+
+static inline float applyEasing(int easing, float param, float time)
+{
+    switch (easing)
+    {
+        case EASING_NONE:
+            return time;
+        case EASING_RATE_IN:
+            return tweenfunc::easeIn(time, param);
+        case EASING_RATE_OUT:
+            return tweenfunc::easeOut(time, param);
+        case EASING_RATE_IN_OUT:
+            return tweenfunc::easeInOut(time, param);
+        default:
+            return tweenfunc::tweenTo(time, (tweenfunc::TweenType)easing, &param);
+    }
+}
+
+// Returns the easing of an ease action whose update() is exactly "inner->update(easing(time))", or -1
+static int getEasing(const ActionInterval* action, float* param)
+{
+    const std::type_info& type = typeid(*action);
+
+    if (type == typeid(EaseIn) || type == typeid(EaseOut) || type == typeid(EaseInOut))
+    {
+        *param = static_cast<const EaseRateAction*>(action)->getRate();
+        return type == typeid(EaseIn) ? EASING_RATE_IN : (type == typeid(EaseOut) ? EASING_RATE_OUT : EASING_RATE_IN_OUT);
+    }
+    if (type == typeid(EaseElasticIn) || type == typeid(EaseElasticOut) || type == typeid(EaseElasticInOut))
+    {
+        *param = static_cast<const EaseElastic*>(action)->getPeriod();
+        return type == typeid(EaseElasticIn) ? tweenfunc::Elastic_EaseIn
+            : (type == typeid(EaseElasticOut) ? tweenfunc::Elastic_EaseOut : tweenfunc::Elastic_EaseInOut);
+    }
+
+    static const struct
+    {
+        const std::type_info& type;
+        int easing;
+    } tweens[] = {
+        { typeid(EaseSineIn), tweenfunc::Sine_EaseIn },
+        { typeid(EaseSineOut), tweenfunc::Sine_EaseOut },
+        { typeid(EaseSineInOut), tweenfunc::Sine_EaseInOut },
+        { typeid(EaseExponentialIn), tweenfunc::Expo_EaseIn },
+        { typeid(EaseExponentialOut), tweenfunc::Expo_EaseOut },
+        { typeid(EaseExponentialInOut), tweenfunc::Expo_EaseInOut },
+        { typeid(EaseBackIn), tweenfunc::Back_EaseIn },
+        { typeid(EaseBackOut), tweenfunc::Back_EaseOut },
+        { typeid(EaseBackInOut), tweenfunc::Back_EaseInOut },
+        { typeid(EaseBounceIn), tweenfunc::Bounce_EaseIn },
+        { typeid(EaseBounceOut), tweenfunc::Bounce_EaseOut },
+        { typeid(EaseBounceInOut), tweenfunc::Bounce_EaseInOut },
+    };
+    for (const auto& tween : tweens)
+    {
+        if (type == tween.type)
+        {
+            *param = 0;
+            return tween.easing;
+        }
+    }
+    return -1;
+}
+
+// Returns the bucket of an action that doesn't override step() nor update() of the listed classes
+int ActionManager::getStepKind(const Action* action)
+{
+    const std::type_info& type = typeid(*action);
+
+    if (type == typeid(MoveTo) || type == typeid(MoveBy))
+        return STEP_MOVE;
+    if (type == typeid(ScaleTo) || type == typeid(ScaleBy))
+        return STEP_SCALE;
+    if (type == typeid(FadeTo) || type == typeid(FadeIn) || type == typeid(FadeOut))
+        return STEP_FADE;
+    if (type == typeid(RotateTo))
+        return STEP_ROTATE;
+    return STEP_GENERIC;
+}
+
 ActionManager::ActionManager()
 : _targets(nullptr),
-  _currentTarget(nullptr),
-  _currentTargetSalvaged(false)
+  _updating(false),
+  _hasRemovedEntries(false)
 {
 
 }
@@ -68,49 +165,110 @@ ActionManager::~ActionManager()
 
 void ActionManager::deleteHashElement(tHashElement *element)
 {
-    ccArrayFree(element->actions);
     HASH_DEL(_targets, element);
     element->target->release();
-    free(element);
+    delete element;
 }
 
-void ActionManager::actionAllocWithHashElement(tHashElement *element)
+ActionManager::ActionEntry ActionManager::makeEntry(Action *action, tHashElement *element, int *kind) const
 {
-    // 4 actions per Node by default
-    if (element->actions == nullptr)
+    ActionEntry entry;
+    entry.action = action;
+    entry.timer = nullptr;
+    entry.inner = nullptr;
+    entry.element = element;
+    entry.easing = EASING_NONE;
+    entry.easingParam = 0;
+
+    *kind = getStepKind(action);
+    if (*kind != STEP_GENERIC)
     {
-        element->actions = ccArrayNew(4);
-    }else 
-    if (element->actions->num == element->actions->max)
+        entry.timer = entry.inner = static_cast<ActionInterval*>(action);
+        return entry;
+    }
+
+    // an ease over one of the common actions is stepped with them, its easing applied to the progress
+    auto ease = dynamic_cast<ActionEase*>(action);
+    if (ease && ease->getInnerAction())
     {
-        ccArrayDoubleCapacity(element->actions);
+        int innerKind = getStepKind(ease->getInnerAction());
+        float param = 0;
+        int easing = innerKind != STEP_GENERIC ? getEasing(ease, &param) : -1;
+        if (easing >= 0)
+        {
+            *kind = innerKind;
+            entry.timer = ease;
+            entry.inner = ease->getInnerAction();
+            entry.easing = easing;
+            entry.easingParam = param;
+        }
     }
+    return entry;
+}
 
+int ActionManager::getEntryKind(const ActionEntry& entry)
+{
+    return entry.inner ? getStepKind(entry.inner) : STEP_GENERIC;
 }
 
-void ActionManager::removeActionAtIndex(ssize_t index, tHashElement *element)
+void ActionManager::setEntryLocation(const ActionEntry& entry, int kind, ssize_t index)
+{
+    auto& actions = entry.element->actions;
+    auto position = std::find(actions.begin(), actions.end(), entry.action) - actions.begin();
+    CCASSERT(position < (ssize_t)actions.size(), "the action of an entry must belong to its element");
+
+    entry.element->locations[position].kind = kind;
+    entry.element->locations[position].index = index;
+}
+
+void ActionManager::removeEntry(const ActionLocation& location)
 {
-    Action *action = (Action*)element->actions->arr[index];
+    auto& entries = (location.kind == STEP_PENDING) ? _pendingEntries : _buckets[location.kind];
 
-    if (action == element->currentAction && (! element->currentActionSalvaged))
+    if (_updating)
     {
-        element->currentAction->retain();
-        element->currentActionSalvaged = true;
+        // the entries are being walked, leave a hole that is compacted once the update is over
+        entries[location.index].action = nullptr;
+        _hasRemovedEntries = true;
+        return;
     }
 
-    ccArrayRemoveObjectAtIndex(element->actions, index, true);
+    if (location.index != (ssize_t)entries.size() - 1)
+    {
+        entries[location.index] = entries.back();
+        setEntryLocation(entries[location.index], location.kind, location.index);
+    }
+    entries.pop_back();
+}
+
+void ActionManager::removeActionAtIndex(ssize_t index, tHashElement *element)
+{
+    Action *action = element->actions[index];
+    ActionLocation location = element->locations[index];
+
+    element->actions.erase(element->actions.begin() + index);
+    element->locations.erase(element->locations.begin() + index);
+    removeEntry(location);
 
-    // update actionIndex in case we are in tick. looping over the actions
-    if (element->actionIndex >= index)
+    if (_updating)
     {
-        element->actionIndex--;
+        // the action may be the one being stepped, keep it alive until the update is over
+        _removedActions.push_back(action);
+    }
+    else
+    {
+        action->release();
     }
 
-    if (element->actions->num == 0)
+    if (element->actions.empty())
     {
-        if (_currentTarget == element)
+        if (_updating)
         {
-            _currentTargetSalvaged = true;
+            if (! element->emptied)
+            {
+                element->emptied = true;
+                _emptiedElements.push_back(element);
+            }
         }
         else
         {
@@ -177,19 +335,37 @@ void ActionManager::addAction(Action *action, Node *target, bool paused)
     HASH_FIND_PTR(_targets, &tmp, element);
     if (! element)
     {
-        element = (tHashElement*)calloc(sizeof(*element), 1);
+        element = new (std::nothrow) tHashElement();
         element->paused = paused;
+        element->emptied = false;
         target->retain();
         element->target = target;
         HASH_ADD_PTR(_targets, target, element);
     }
 
-     actionAllocWithHashElement(element);
- 
-     CCASSERT(! ccArrayContainsObject(element->actions, action), "");
-     ccArrayAppendObject(element->actions, action);
- 
-     action->startWithTarget(target);
+    CCASSERT(std::find(element->actions.begin(), element->actions.end(), action) == element->actions.end(), "");
+    action->retain();
+
+    int kind = STEP_GENERIC;
+    ActionEntry entry = makeEntry(action, element, &kind);
+    ActionLocation location;
+    if (_updating)
+    {
+        // the buckets are being walked, the action starts to be stepped on the next update
+        location.kind = STEP_PENDING;
+        location.index = _pendingEntries.size();
+        _pendingEntries.push_back(entry);
+    }
+    else
+    {
+        location.kind = kind;
+        location.index = _buckets[kind].size();
+        _buckets[kind].push_back(entry);
+    }
+    element->actions.push_back(action);
+    element->locations.push_back(location);
+
+    action->startWithTarget(target);
 }
 
 // remove
@@ -216,20 +392,10 @@ void ActionManager::removeAllActionsFromTarget(Node *target)
     HASH_FIND_PTR(_targets, &target, element);
     if (element)
     {
-        if (ccArrayContainsObject(element->actions, element->currentAction) && (! element->currentActionSalvaged))
+        // the element is deleted along with its last action, unless an update is running
+        for (ssize_t i = (ssize_t)element->actions.size() - 1; i >= 0; --i)
         {
-            element->currentAction->retain();
-            element->currentActionSalvaged = true;
-        }
-
-        ccArrayRemoveAllObjects(element->actions);
-        if (_currentTarget == element)
-        {
-            _currentTargetSalvaged = true;
-        }
-        else
-        {
-            deleteHashElement(element);
+            removeActionAtIndex(i, element);
         }
     }
     else
@@ -251,10 +417,10 @@ void ActionManager::removeAction(Action *action)
     HASH_FIND_PTR(_targets, &target, element);
     if (element)
     {
-        auto i = ccArrayGetIndexOfObject(element->actions, action);
-        if (i != CC_INVALID_INDEX)
+        auto it = std::find(element->actions.begin(), element->actions.end(), action);
+        if (it != element->actions.end())
         {
-            removeActionAtIndex(i, element);
+            removeActionAtIndex(it - element->actions.begin(), element);
         }
     }
     else
@@ -273,10 +439,10 @@ void ActionManager::removeActionByTag(int tag, Node *target)
 
     if (element)
     {
-        auto limit = element->actions->num;
-        for (int i = 0; i < limit; ++i)
+        ssize_t limit = element->actions.size();
+        for (ssize_t i = 0; i < limit; ++i)
         {
-            Action *action = (Action*)element->actions->arr[i];
+            Action *action = element->actions[i];
 
             if (action->getTag() == (int)tag && action->getOriginalTarget() == target)
             {
@@ -297,13 +463,14 @@ void ActionManager::removeAllActionsByTag(int tag, Node *target)
     
     if (element)
     {
-        auto limit = element->actions->num;
-        for (int i = 0; i < limit;)
+        ssize_t limit = element->actions.size();
+        for (ssize_t i = 0; i < limit;)
         {
-            Action *action = (Action*)element->actions->arr[i];
+            Action *action = element->actions[i];
             
             if (action->getTag() == (int)tag && action->getOriginalTarget() == target)
             {
+                // the element is gone once its last action is removed outside of an update, limit is 0 then
                 removeActionAtIndex(i, element);
                 --limit;
             }
@@ -328,17 +495,11 @@ Action* ActionManager::getActionByTag(int tag, const Node *target) const
 
     if (element)
     {
-        if (element->actions != nullptr)
+        for (auto action : element->actions)
         {
-            auto limit = element->actions->num;
-            for (int i = 0; i < limit; ++i)
+            if (action->getTag() == (int)tag)
             {
-                Action *action = (Action*)element->actions->arr[i];
-
-                if (action->getTag() == (int)tag)
-                {
-                    return action;
-                }
+                return action;
             }
         }
         //CCLOG("cocos2d : getActionByTag(tag = %d): Action not found", tag);
@@ -359,70 +520,136 @@ ssize_t ActionManager::getNumberOfRunningActionsInTarget(const Node *target) con
     HASH_FIND_PTR(_targets, &target, element);
     if (element)
     {
-        return element->actions ? element->actions->num : 0;
+        return element->actions.size();
     }
 
     return 0;
 }
 
 // main loop
-void ActionManager::update(float dt)
+void ActionManager::stepGenericActions(float dt)
 {
-    for (tHashElement *elt = _targets; elt != nullptr; )
+    auto& entries = _buckets[STEP_GENERIC];
+    // the entries don't move during the update, actions added meanwhile go to _pendingEntries
+    for (size_t i = 0, count = entries.size(); i < count; ++i)
     {
-        _currentTarget = elt;
-        _currentTargetSalvaged = false;
+        Action *action = entries[i].action;
+        if (action == nullptr || entries[i].element->paused)
+        {
+            continue;
+        }
 
-        if (! _currentTarget->paused)
+        action->step(dt);
+
+        // skip the actions that removed themselves during their step
+        if (entries[i].action != nullptr && action->isDone())
         {
-            // The 'actions' MutableArray may change while inside this loop.
-            for (_currentTarget->actionIndex = 0; _currentTarget->actionIndex < _currentTarget->actions->num;
-                _currentTarget->actionIndex++)
-            {
-                _currentTarget->currentAction = (Action*)_currentTarget->actions->arr[_currentTarget->actionIndex];
-                if (_currentTarget->currentAction == nullptr)
-                {
-                    continue;
-                }
+            action->stop();
+            removeAction(action);
+        }
+    }
+}
 
-                _currentTarget->currentActionSalvaged = false;
+template<typename T>
+void ActionManager::stepActions(std::vector<ActionEntry>& entries, float dt)
+{
+    for (size_t i = 0, count = entries.size(); i < count; ++i)
+    {
+        const ActionEntry& entry = entries[i];
+        if (entry.action == nullptr || entry.element->paused)
+        {
+            continue;
+        }
 
-                _currentTarget->currentAction->step(dt);
+        // same as ActionInterval::step() followed by the eases' update(), without the virtual calls
+        float time = entry.timer->advanceElapsed(dt);
+        if (entry.easing != EASING_NONE)
+        {
+            time = applyEasing(entry.easing, entry.easingParam, time);
+        }
+        static_cast<T*>(entry.inner)->T::update(time);
 
-                if (_currentTarget->currentActionSalvaged)
-                {
-                    // The currentAction told the node to remove it. To prevent the action from
-                    // accidentally deallocating itself before finishing its step, we retained
-                    // it. Now that step is done, it's safe to release it.
-                    _currentTarget->currentAction->release();
-                } else
-                if (_currentTarget->currentAction->isDone())
-                {
-                    _currentTarget->currentAction->stop();
+        // the target may have removed the action while it was updated
+        Action *action = entries[i].action;
+        if (action != nullptr && entries[i].timer->ActionInterval::isDone())
+        {
+            action->stop();
+            removeAction(action);
+        }
+    }
+}
 
-                    Action *action = _currentTarget->currentAction;
-                    // Make currentAction nil to prevent removeAction from salvaging it.
-                    _currentTarget->currentAction = nullptr;
-                    removeAction(action);
-                }
+void ActionManager::applyDeferredChanges()
+{
+    if (_hasRemovedEntries)
+    {
+        _hasRemovedEntries = false;
+        for (int kind = 0; kind < STEP_KIND_COUNT; ++kind)
+        {
+            auto& entries = _buckets[kind];
+            size_t count = 0;
+            for (size_t i = 0; i < entries.size(); ++i)
+            {
+                if (entries[i].action == nullptr)
+                    continue;
 
-                _currentTarget->currentAction = nullptr;
+                if (count != i)
+                {
+                    entries[count] = entries[i];
+                    setEntryLocation(entries[count], kind, count);
+                }
+                ++count;
             }
+            entries.resize(count);
         }
+    }
 
-        // elt, at this moment, is still valid
-        // so it is safe to ask this here (issue #490)
-        elt = (tHashElement*)(elt->hh.next);
+    for (const auto& entry : _pendingEntries)
+    {
+        if (entry.action == nullptr)
+            continue;
 
-        // only delete currentTarget if no actions were scheduled during the cycle (issue #481)
-        if (_currentTargetSalvaged && _currentTarget->actions->num == 0)
+        int kind = getEntryKind(entry);
+        setEntryLocation(entry, kind, _buckets[kind].size());
+        _buckets[kind].push_back(entry);
+    }
+    _pendingEntries.clear();
+
+    // releasing actions and targets may call back into the manager, work on local lists
+    std::vector<tHashElement*> emptiedElements;
+    emptiedElements.swap(_emptiedElements);
+    for (auto element : emptiedElements)
+    {
+        element->emptied = false;
+        if (element->actions.empty())
         {
-            deleteHashElement(_currentTarget);
+            deleteHashElement(element);
         }
     }
 
-    // issue #635
-    _currentTarget = nullptr;
+    std::vector<Action*> removedActions;
+    removedActions.swap(_removedActions);
+    for (auto action : removedActions)
+    {
+        action->release();
+    }
+}
+
+void ActionManager::update(float dt)
+{
+    CC_PROFILER_SCOPE("ActionManager - update");
+
+    _updating = true;
+
+    stepGenericActions(dt);
+    stepActions<MoveBy>(_buckets[STEP_MOVE], dt);
+    stepActions<ScaleTo>(_buckets[STEP_SCALE], dt);
+    stepActions<FadeTo>(_buckets[STEP_FADE], dt);
+    stepActions<RotateTo>(_buckets[STEP_ROTATE], dt);
+
+    _updating = false;
+
+    applyDeferredChanges();
 }
 
 NS_CC_END
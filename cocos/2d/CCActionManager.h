@@ -29,6 +29,8 @@ THE SOFTWARE.
 #ifndef __ACTION_CCACTION_MANAGER_H__
 #define __ACTION_CCACTION_MANAGER_H__
 
+#include <vector>
+
 #include "2d/CCAction.h"
 #include "base/CCVector.h"
 #include "base/CCRef.h"
@@ -36,6 +38,7 @@ THE SOFTWARE.
 NS_CC_BEGIN
 
 class Action;
+class ActionInterval;
 
 struct _hashElement;
 
@@ -167,16 +170,64 @@ public:
     void update(float dt);
     
 protected:
-    // declared in ActionManager.m
+    /** Actions are stored in one bucket per kind. The common interval actions (MoveTo, ScaleTo, FadeTo, RotateTo
+     and the like, eased or not) are stepped by a loop of their own without virtual calls, the others through
+     Action::step().
+     */
+    enum StepKind
+    {
+        STEP_GENERIC,
+        STEP_MOVE,
+        STEP_SCALE,
+        STEP_FADE,
+        STEP_ROTATE,
+        STEP_KIND_COUNT,
+        // added during update(), moved to its bucket once the update is over
+        STEP_PENDING = STEP_KIND_COUNT,
+    };
+
+    struct ActionEntry
+    {
+        // nullptr once the action has been removed during update()
+        Action*                 action;
+        // the action whose elapsed time drives the step, and the one that is updated. They differ for eased actions
+        ActionInterval*         timer;
+        ActionInterval*         inner;
+        struct _hashElement*    element;
+        // easing applied to the progress of eased actions, see CCActionManager.cpp
+        int                     easing;
+        float                   easingParam;
+    };
+
+    struct ActionLocation
+    {
+        int         kind;
+        ssize_t     index;
+    };
+
+    friend struct _hashElement;
 
     void removeActionAtIndex(ssize_t index, struct _hashElement *element);
     void deleteHashElement(struct _hashElement *element);
-    void actionAllocWithHashElement(struct _hashElement *element);
+    static int getStepKind(const Action *action);
+    static int getEntryKind(const ActionEntry& entry);
+    ActionEntry makeEntry(Action *action, struct _hashElement *element, int *kind) const;
+    void removeEntry(const ActionLocation& location);
+    void setEntryLocation(const ActionEntry& entry, int kind, ssize_t index);
+    void stepGenericActions(float dt);
+    template<typename T> void stepActions(std::vector<ActionEntry>& entries, float dt);
+    void applyDeferredChanges();
 
 protected:
     struct _hashElement    *_targets;
-    struct _hashElement    *_currentTarget;
-    bool            _currentTargetSalvaged;
+    std::vector<ActionEntry> _buckets[STEP_KIND_COUNT];
+
+    // changes made while update() walks the buckets, applied once it is done
+    bool                     _updating;
+    std::vector<ActionEntry> _pendingEntries;
+    std::vector<Action*>     _removedActions;
+    std::vector<struct _hashElement*> _emptiedElements;
+    bool                     _hasRemovedEntries;
 };
 
 // end of actions group
@@ -29,6 +29,7 @@
 #include "renderer/CCGLProgramState.h"
 #include "renderer/CCGLProgramCache.h"
 #include "base/CCDirector.h"
+#include "base/CCFrameArena.h"
 #include "base/CCEventListenerCustom.h"
 #include "base/CCEventDispatcher.h"
 #include "2d/CCActionCatmullRom.h"
@@ -304,21 +305,21 @@ void DrawNode::draw(Renderer *renderer, const Mat4 &transform, uint32_t flags)
     if(_bufferCount)
     {
         _customCommand.init(_globalZOrder, transform, flags);
-        _customCommand.func = CC_CALLBACK_0(DrawNode::onDraw, this, transform, flags);
+        _customCommand.func = _director->getFrameArena()->makeCallback(CC_CALLBACK_0(DrawNode::onDraw, this, transform, flags));
         renderer->addCommand(&_customCommand);
     }
     
     if(_bufferCountGLPoint)
     {
         _customCommandGLPoint.init(_globalZOrder, transform, flags);
-        _customCommandGLPoint.func = CC_CALLBACK_0(DrawNode::onDrawGLPoint, this, transform, flags);
+        _customCommandGLPoint.func = _director->getFrameArena()->makeCallback(CC_CALLBACK_0(DrawNode::onDrawGLPoint, this, transform, flags));
         renderer->addCommand(&_customCommandGLPoint);
     }
     
     if(_bufferCountGLLine)
     {
         _customCommandGLLine.init(_globalZOrder, transform, flags);
-        _customCommandGLLine.func = CC_CALLBACK_0(DrawNode::onDrawGLLine, this, transform, flags);
+        _customCommandGLLine.func = _director->getFrameArena()->makeCallback(CC_CALLBACK_0(DrawNode::onDrawGLLine, this, transform, flags));
         renderer->addCommand(&_customCommandGLLine);
     }
 }
@@ -24,12 +24,22 @@
  ****************************************************************************/
 
 #include "2d/CCFontAtlas.h"
+
+#include <algorithm>
+#include <float.h>
+#include <limits.h>
+#include <math.h>
+
 #include "2d/CCFontFreeType.h"
 #include "base/ccUTF8.h"
 #include "base/CCDirector.h"
 #include "base/CCEventListenerCustom.h"
 #include "base/CCEventDispatcher.h"
 #include "base/CCEventType.h"
+#include "base/CCAsyncTaskPool.h"
+#include "platform/CCFileUtils.h"
+#include "renderer/CCRenderer.h"
+#include "renderer/CCCustomCommand.h"
 
 
 NS_CC_BEGIN
@@ -39,9 +49,58 @@ const int FontAtlas::CacheTextureHeight = 512;
 const char* FontAtlas::CMD_PURGE_FONTATLAS = "__cc_PURGE_FONTATLAS";
 const char* FontAtlas::CMD_RESET_FONTATLAS = "__cc_RESET_FONTATLAS";
 
+static int s_defaultPageWidth = FontAtlas::CacheTextureWidth;
+static int s_defaultPageHeight = FontAtlas::CacheTextureHeight;
+
+// atlases with rows to upload, and whether the command uploading them is queued for the current frame
+static std::vector<FontAtlas*> s_dirtyAtlases;
+static bool s_textureUpdateQueued = false;
+static unsigned int s_textureUpdateFrame = 0;
+
+// Letters rasterized by a worker thread. The atlas clears font when it is destroyed,
+// the worker then stops and the results are dropped.
+struct FontAtlas::GlyphJob
+{
+    struct Glyph
+    {
+        unsigned short letter;
+        unsigned char* bitmap;
+        long width;
+        long height;
+        Rect rect;
+        int xAdvance;
+    };
+
+    ~GlyphJob()
+    {
+        for (auto& glyph : glyphs)
+        {
+            delete [] glyph.bitmap;
+        }
+    }
+
+    std::mutex mutex;
+    FontFreeType* font;
+    std::u16string letters;
+    std::vector<Glyph> glyphs;
+    std::function<void()> callback;
+};
+
+void FontAtlas::setDefaultPageSize(int width, int height)
+{
+    CCASSERT(width > 0 && height > 0, "Invalid page size");
+    s_defaultPageWidth = width;
+    s_defaultPageHeight = height;
+}
+
 FontAtlas::FontAtlas(Font &theFont) 
 : _font(&theFont)
 , _currentPageData(nullptr)
+, _pageWidth(s_defaultPageWidth)
+, _pageHeight(s_defaultPageHeight)
+, _bytesPerPixel(1)
+, _dirtyTop(INT_MAX)
+, _dirtyBottom(0)
 , _fontAscender(0)
 , _rendererRecreatedListener(nullptr)
 , _antialiasEnabled(true)
@@ -55,32 +114,33 @@ FontAtlas::FontAtlas(Font &theFont)
         _fontAscender = fontTTf->getFontAscender();
         auto texture = new (std::nothrow) Texture2D;
         _currentPage = 0;
-        _currentPageOrigX = 0;
-        _currentPageOrigY = 0;
         _letterPadding = 0;
 
         if(fontTTf->isDistanceFieldEnabled())
         {
             _letterPadding += 2 * FontFreeType::DistanceMapSpread;    
         }
-        _currentPageDataSize = CacheTextureWidth * CacheTextureHeight;
         auto outlineSize = fontTTf->getOutlineSize();
         if(outlineSize > 0)
         {
             _commonLineHeight += 2 * outlineSize;
-            _currentPageDataSize *= 2;
+            _bytesPerPixel = 2;
         }    
+        _currentPageDataSize = _pageWidth * _pageHeight * _bytesPerPixel;
 
         _currentPageData = new unsigned char[_currentPageDataSize];
         memset(_currentPageData, 0, _currentPageDataSize);
 
         auto  pixelFormat = outlineSize > 0 ? Texture2D::PixelFormat::AI88 : Texture2D::PixelFormat::A8; 
         texture->initWithData(_currentPageData, _currentPageDataSize, 
-            pixelFormat, CacheTextureWidth, CacheTextureHeight, Size(CacheTextureWidth,CacheTextureHeight) );
+            pixelFormat, _pageWidth, _pageHeight, Size(_pageWidth,_pageHeight) );
 
         addTexture(texture,0);
         texture->release();
 
+        SkylineNode node = { 0, 0, _pageWidth };
+        _skyline.push_back(node);
+
 #if CC_ENABLE_CACHE_TEXTURE_DATA
         auto eventDispatcher = Director::getInstance()->getEventDispatcher();
 
@@ -102,6 +162,14 @@ FontAtlas::~FontAtlas()
     }
 #endif
 
+    // waits for the letter being rasterized, the font must outlive it
+    for (auto& job : _glyphJobs)
+    {
+        std::lock_guard<std::mutex> lock(job->mutex);
+        job->font = nullptr;
+    }
+    s_dirtyAtlases.erase(std::remove(s_dirtyAtlases.begin(), s_dirtyAtlases.end(), this), s_dirtyAtlases.end());
+
     _font->release();
     relaseTextures();
 
@@ -168,19 +236,10 @@ bool FontAtlas::prepareLetterDefinitions(const std::u16string& utf16String)
     
     size_t length = utf16String.length();
 
-    float offsetAdjust = _letterPadding / 2;  
     long bitmapWidth;
     long bitmapHeight;
     Rect tempRect;
-    FontLetterDefinition tempDef;
-
-    auto scaleFactor = CC_CONTENT_SCALE_FACTOR();
-    auto  pixelFormat = fontTTf->getOutlineSize() > 0 ? Texture2D::PixelFormat::AI88 : Texture2D::PixelFormat::A8; 
-
-    bool existNewLetter = false;
-    int bottomHeight = _commonLineHeight - _fontAscender;
-
-    float startY = _currentPageOrigY;
+    int xAdvance;
 
     for (size_t i = 0; i < length; ++i)
     {
@@ -188,108 +247,336 @@ bool FontAtlas::prepareLetterDefinitions(const std::u16string& utf16String)
 
         if (outIterator == _fontLetterDefinitions.end())
         {  
-            existNewLetter = true;
+            auto bitmap = fontTTf->rasterizeGlyph(utf16String[i],bitmapWidth,bitmapHeight,tempRect,xAdvance);
+            addLetter(utf16String[i], bitmap, bitmapWidth, bitmapHeight,
+                      tempRect.origin.x, tempRect.origin.y, tempRect.size.width, tempRect.size.height, xAdvance);
+            delete [] bitmap;
+        }       
+    }
 
-            auto bitmap = fontTTf->getGlyphBitmap(utf16String[i],bitmapWidth,bitmapHeight,tempRect,tempDef.xAdvance);
-            if (bitmap)
+    return true;
+}
+
+void FontAtlas::prepareLetterDefinitionsAsync(const std::u16string& utf16String, const std::function<void()>& callback)
+{
+    FontFreeType* fontTTf = dynamic_cast<FontFreeType*>(_font);
+
+    auto job = std::make_shared<GlyphJob>();
+    job->font = fontTTf;
+    job->callback = callback;
+    if (fontTTf)
+    {
+        std::u16string letters(utf16String);
+        std::sort(letters.begin(), letters.end());
+        letters.erase(std::unique(letters.begin(), letters.end()), letters.end());
+
+        for (auto letter : letters)
+        {
+            if (letter != u'\n' && letter != u'\r' && _fontLetterDefinitions.find(letter) == _fontLetterDefinitions.end())
             {
-                tempDef.validDefinition = true;
-                tempDef.letteCharUTF16   = utf16String[i];
-                tempDef.width            = tempRect.size.width + _letterPadding;
-                tempDef.height           = tempRect.size.height + _letterPadding;
-                tempDef.offsetX          = tempRect.origin.x + offsetAdjust;
-                tempDef.offsetY          = _fontAscender + tempRect.origin.y - offsetAdjust;
-                tempDef.clipBottom     = bottomHeight - (tempDef.height + tempRect.origin.y + offsetAdjust);
-
-                if (_currentPageOrigX + tempDef.width > CacheTextureWidth)
-                {
-                    _currentPageOrigY += _commonLineHeight;
-                    _currentPageOrigX = 0;
-                    if(_currentPageOrigY + _commonLineHeight >= CacheTextureHeight)
-                    {
-                        unsigned char *data = nullptr;
-                        if(pixelFormat == Texture2D::PixelFormat::AI88)
-                        {
-                            data = _currentPageData + CacheTextureWidth * (int)startY * 2;
-                        }
-                        else
-                        {
-                            data = _currentPageData + CacheTextureWidth * (int)startY;
-                        }
-                        _atlasTextures[_currentPage]->updateWithData(data, 0, startY, 
-                            CacheTextureWidth, CacheTextureHeight - startY);
-
-                        startY = 0.0f;
-
-                        _currentPageOrigY = 0;
-                        memset(_currentPageData, 0, _currentPageDataSize);
-                        _currentPage++;
-                        auto tex = new (std::nothrow) Texture2D;
-                        if (_antialiasEnabled)
-                        {
-                            tex->setAntiAliasTexParameters();
-                        } 
-                        else
-                        {
-                            tex->setAliasTexParameters();
-                        }
-                        tex->initWithData(_currentPageData, _currentPageDataSize, 
-                            pixelFormat, CacheTextureWidth, CacheTextureHeight, Size(CacheTextureWidth,CacheTextureHeight) );
-                        addTexture(tex,_currentPage);
-                        tex->release();
-                    }  
-                }
-                fontTTf->renderCharAt(_currentPageData,_currentPageOrigX,_currentPageOrigY,bitmap,bitmapWidth,bitmapHeight);
-
-                tempDef.U                = _currentPageOrigX;
-                tempDef.V                = _currentPageOrigY;
-                tempDef.textureID        = _currentPage;
-                _currentPageOrigX        += tempDef.width + 1;
-                // take from pixels to points
-                tempDef.width  =    tempDef.width  / scaleFactor;
-                tempDef.height =    tempDef.height / scaleFactor;      
-                tempDef.U      =    tempDef.U      / scaleFactor;
-                tempDef.V      =    tempDef.V      / scaleFactor;
+                job->letters.push_back(letter);
             }
-            else{
-                if(tempDef.xAdvance)
-                    tempDef.validDefinition = true;
-                else
-                    tempDef.validDefinition = false;
-
-                tempDef.letteCharUTF16   = utf16String[i];
-                tempDef.width            = 0;
-                tempDef.height           = 0;
-                tempDef.U                = 0;
-                tempDef.V                = 0;
-                tempDef.offsetX          = 0;
-                tempDef.offsetY          = 0;
-                tempDef.textureID        = 0;
-                tempDef.clipBottom = 0;
-                _currentPageOrigX += 1;
+        }
+    }
+
+    if (job->letters.empty())
+    {
+        if (callback)
+        {
+            callback();
+        }
+        return;
+    }
+
+    _glyphJobs.push_back(job);
+
+    AsyncTaskPool::getInstance()->enqueue(AsyncTaskPool::TaskType::TASK_OTHER, [this, job](void*) {
+        if (job->font == nullptr)
+        {
+            // the atlas is gone
+            return;
+        }
+
+        for (auto& glyph : job->glyphs)
+        {
+            if (_fontLetterDefinitions.find(glyph.letter) == _fontLetterDefinitions.end())
+            {
+                addLetter(glyph.letter, glyph.bitmap, glyph.width, glyph.height,
+                          glyph.rect.origin.x, glyph.rect.origin.y, glyph.rect.size.width, glyph.rect.size.height, glyph.xAdvance);
             }
+        }
+        _glyphJobs.erase(std::find(_glyphJobs.begin(), _glyphJobs.end(), job));
 
-            _fontLetterDefinitions[tempDef.letteCharUTF16] = tempDef;
-        }       
+        if (job->callback)
+        {
+            job->callback();
+        }
+    }, nullptr, [job]() {
+        job->glyphs.reserve(job->letters.size());
+        for (auto letter : job->letters)
+        {
+            std::lock_guard<std::mutex> lock(job->mutex);
+            if (job->font == nullptr)
+            {
+                break;
+            }
+
+            GlyphJob::Glyph glyph;
+            glyph.letter = letter;
+            glyph.bitmap = job->font->rasterizeGlyph(letter, glyph.width, glyph.height, glyph.rect, glyph.xAdvance);
+            job->glyphs.push_back(glyph);
+        }
+    });
+}
+
+bool FontAtlas::prewarmFromFile(const std::string& filename, const std::function<void()>& callback)
+{
+    std::string content = FileUtils::getInstance()->getStringFromFile(filename);
+    if (content.empty())
+    {
+        CCLOG("FontAtlas: can't read the letters from %s", filename.c_str());
+        return false;
+    }
+
+    std::u16string letters;
+    if (!StringUtils::UTF8ToUTF16(content, letters))
+    {
+        CCLOG("FontAtlas: %s isn't valid UTF-8", filename.c_str());
+        return false;
     }
 
-    if(existNewLetter)
+    prepareLetterDefinitionsAsync(letters, callback);
+    return true;
+}
+
+void FontAtlas::addLetter(unsigned short letter, unsigned char* bitmap, long bitmapWidth, long bitmapHeight, float rectX, float rectY, float rectWidth, float rectHeight, int xAdvance)
+{
+    FontLetterDefinition tempDef;
+    tempDef.letteCharUTF16 = letter;
+    tempDef.xAdvance = xAdvance;
+
+    int x = 0;
+    int y = 0;
+    if (bitmap)
     {
-        unsigned char *data = nullptr;
-        if(pixelFormat == Texture2D::PixelFormat::AI88)
+        float offsetAdjust = _letterPadding / 2;
+        int bottomHeight = _commonLineHeight - _fontAscender;
+
+        tempDef.validDefinition = true;
+        tempDef.width            = rectWidth + _letterPadding;
+        tempDef.height           = rectHeight + _letterPadding;
+        tempDef.offsetX          = rectX + offsetAdjust;
+        tempDef.offsetY          = _fontAscender + rectY - offsetAdjust;
+        tempDef.clipBottom     = bottomHeight - (tempDef.height + rectY + offsetAdjust);
+
+        // letters are kept one pixel apart, they are sampled with linear filtering
+        int packWidth = std::max((int)ceilf(tempDef.width), (int)bitmapWidth) + 1;
+        int packHeight = std::max((int)ceilf(tempDef.height), (int)bitmapHeight) + 1;
+        if (!allocateRect(packWidth, packHeight, x, y))
         {
-            data = _currentPageData + CacheTextureWidth * (int)startY * 2;
+            addPage();
+            if (!allocateRect(packWidth, packHeight, x, y))
+            {
+                CCLOG("FontAtlas: letter %d doesn't fit in a %dx%d page", (int)letter, _pageWidth, _pageHeight);
+                bitmap = nullptr;
+            }
+        }
+    }
+
+    if (bitmap)
+    {
+        auto rowSize = bitmapWidth * _bytesPerPixel;
+        for (long row = 0; row < bitmapHeight; ++row)
+        {
+            memcpy(_currentPageData + ((y + row) * _pageWidth + x) * _bytesPerPixel, bitmap + row * rowSize, rowSize);
+        }
+        _dirtyTop = std::min(_dirtyTop, y);
+        _dirtyBottom = std::max(_dirtyBottom, y + (int)bitmapHeight);
+        scheduleTextureUpdate();
+
+        auto scaleFactor = CC_CONTENT_SCALE_FACTOR();
+
+        tempDef.U                = x;
+        tempDef.V                = y;
+        tempDef.textureID        = _currentPage;
+        // take from pixels to points
+        tempDef.width  =    tempDef.width  / scaleFactor;
+        tempDef.height =    tempDef.height / scaleFactor;      
+        tempDef.U      =    tempDef.U      / scaleFactor;
+        tempDef.V      =    tempDef.V      / scaleFactor;
+    }
+    else{
+        if(tempDef.xAdvance)
+            tempDef.validDefinition = true;
+        else
+            tempDef.validDefinition = false;
+
+        tempDef.width            = 0;
+        tempDef.height           = 0;
+        tempDef.U                = 0;
+        tempDef.V                = 0;
+        tempDef.offsetX          = 0;
+        tempDef.offsetY          = 0;
+        tempDef.textureID        = 0;
+        tempDef.clipBottom = 0;
+    }
+
+    _fontLetterDefinitions[tempDef.letteCharUTF16] = tempDef;
+}
+
+bool FontAtlas::allocateRect(int width, int height, int &outX, int &outY)
+{
+    // bottom-left: the lowest position, then the narrowest node
+    int bestIndex = -1;
+    int bestY = INT_MAX;
+    int bestWidth = INT_MAX;
+
+    for (size_t i = 0; i < _skyline.size(); ++i)
+    {
+        int x = _skyline[i].x;
+        if (x + width > _pageWidth)
+        {
+            break;
+        }
+
+        // the rect rests on the highest node it spans
+        int y = 0;
+        int remaining = width;
+        for (size_t j = i; remaining > 0; ++j)
+        {
+            y = std::max(y, _skyline[j].y);
+            remaining -= _skyline[j].width;
+        }
+
+        if (y + height <= _pageHeight && (y < bestY || (y == bestY && _skyline[i].width < bestWidth)))
+        {
+            bestIndex = static_cast<int>(i);
+            bestY = y;
+            bestWidth = _skyline[i].width;
+        }
+    }
+
+    if (bestIndex < 0)
+    {
+        return false;
+    }
+
+    SkylineNode node = { _skyline[bestIndex].x, bestY + height, width };
+    _skyline.insert(_skyline.begin() + bestIndex, node);
+
+    // the nodes under the new one are shortened or removed
+    for (size_t i = bestIndex + 1; i < _skyline.size(); )
+    {
+        int overlap = node.x + node.width - _skyline[i].x;
+        if (overlap <= 0)
+        {
+            break;
+        }
+
+        _skyline[i].x += overlap;
+        _skyline[i].width -= overlap;
+        if (_skyline[i].width > 0)
+        {
+            break;
+        }
+        _skyline.erase(_skyline.begin() + i);
+    }
+
+    for (size_t i = 0; i + 1 < _skyline.size(); )
+    {
+        if (_skyline[i].y == _skyline[i + 1].y)
+        {
+            _skyline[i].width += _skyline[i + 1].width;
+            _skyline.erase(_skyline.begin() + i + 1);
         }
         else
         {
-            data = _currentPageData + CacheTextureWidth * (int)startY;
+            ++i;
         }
-        _atlasTextures[_currentPage]->updateWithData(data, 0, startY,
-                                                     CacheTextureWidth, _currentPageOrigY - startY + _commonLineHeight);
     }
+
+    outX = node.x;
+    outY = bestY;
     return true;
 }
 
+void FontAtlas::addPage()
+{
+    // the end of the full page is uploaded before its data is reused
+    updateTextures();
+
+    memset(_currentPageData, 0, _currentPageDataSize);
+    _currentPage++;
+
+    auto pixelFormat = _bytesPerPixel == 2 ? Texture2D::PixelFormat::AI88 : Texture2D::PixelFormat::A8;
+    auto tex = new (std::nothrow) Texture2D;
+    if (_antialiasEnabled)
+    {
+        tex->setAntiAliasTexParameters();
+    } 
+    else
+    {
+        tex->setAliasTexParameters();
+    }
+    tex->initWithData(_currentPageData, _currentPageDataSize, 
+        pixelFormat, _pageWidth, _pageHeight, Size(_pageWidth,_pageHeight) );
+    addTexture(tex,_currentPage);
+    tex->release();
+
+    _skyline.clear();
+    SkylineNode node = { 0, 0, _pageWidth };
+    _skyline.push_back(node);
+}
+
+void FontAtlas::updateTextures()
+{
+    if (_dirtyTop >= _dirtyBottom)
+    {
+        return;
+    }
+
+    auto data = _currentPageData + _pageWidth * _dirtyTop * _bytesPerPixel;
+    _atlasTextures[_currentPage]->updateWithData(data, 0, _dirtyTop, _pageWidth, _dirtyBottom - _dirtyTop);
+
+    _dirtyTop = INT_MAX;
+    _dirtyBottom = 0;
+}
+
+void FontAtlas::scheduleTextureUpdate()
+{
+    if (std::find(s_dirtyAtlases.begin(), s_dirtyAtlases.end(), this) == s_dirtyAtlases.end())
+    {
+        s_dirtyAtlases.push_back(this);
+    }
+
+    auto director = Director::getInstance();
+    if (s_textureUpdateQueued && s_textureUpdateFrame == director->getTotalFrames())
+    {
+        return;
+    }
+
+    // the first command of the main queue, so that the letters are uploaded before any label
+    // is drawn, render textures included
+    static CustomCommand s_textureUpdateCommand;
+    s_textureUpdateCommand.init(-FLT_MAX);
+    s_textureUpdateCommand.func = &FontAtlas::updateDirtyTextures;
+    director->getRenderer()->addCommand(&s_textureUpdateCommand, 0);
+
+    s_textureUpdateQueued = true;
+    s_textureUpdateFrame = director->getTotalFrames();
+}
+
+void FontAtlas::updateDirtyTextures()
+{
+    s_textureUpdateQueued = false;
+
+    for (auto atlas : s_dirtyAtlases)
+    {
+        atlas->updateTextures();
+    }
+    s_dirtyAtlases.clear();
+}
+
 void FontAtlas::addTexture(Texture2D *texture, int slot)
 {
     texture->retain();
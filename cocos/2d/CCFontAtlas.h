@@ -29,6 +29,9 @@
 /// @cond DO_NOT_SHOW
 
 #include <string>
+#include <vector>
+#include <memory>
+#include <functional>
 #include <unordered_map>
 
 #include "platform/CCPlatformMacros.h"
@@ -58,9 +61,16 @@ struct FontLetterDefinition
     int clipBottom;
 };
 
+/** The letters of a FontAtlas.
+ With a FreeType font, the letters are rasterized on demand and packed with a skyline packer
+ in texture pages. The modified rows of the current page are uploaded once per frame, before
+ the scene is rendered. Letters can also be rasterized ahead of time on a worker thread with
+ prepareLetterDefinitionsAsync() or prewarmFromFile().
+ */
 class CC_DLL FontAtlas : public Ref
 {
 public:
+    /** The default size of the texture pages */
     static const int CacheTextureWidth;
     static const int CacheTextureHeight;
     static const char* CMD_PURGE_FONTATLAS;
@@ -80,6 +90,29 @@ public:
     
     bool prepareLetterDefinitions(const std::u16string& utf16String);
 
+    /** Rasterizes the missing letters of utf16String on a worker thread.
+     They are added to the atlas on the cocos thread, where callback is called once they all are.
+     Letters needed before then are rasterized by prepareLetterDefinitions() as usual.
+     */
+    void prepareLetterDefinitionsAsync(const std::u16string& utf16String, const std::function<void()>& callback = nullptr);
+
+    /** Rasterizes the letters of a UTF-8 text file on a worker thread, see prepareLetterDefinitionsAsync().
+     Line breaks in the file are ignored.
+     */
+    bool prewarmFromFile(const std::string& filename, const std::function<void()>& callback = nullptr);
+
+    /** Uploads the rows of the current page modified since the last upload.
+     It is done automatically before the scene is rendered.
+     */
+    void updateTextures();
+
+    /** Sets the size in pixels of the texture pages of the font atlases created from now on.
+     Bigger pages mean less textures, hence less draw calls, for fonts with many letters.
+     */
+    static void setDefaultPageSize(int width, int height);
+    int getPageWidth() const { return _pageWidth; }
+    int getPageHeight() const { return _pageHeight; }
+
     inline const std::unordered_map<ssize_t, Texture2D*>& getTextures() const{ return _atlasTextures;}
     void  addTexture(Texture2D *texture, int slot);
     float getCommonLineHeight() const;
@@ -111,7 +144,23 @@ public:
      void setAliasTexParameters();
 
 protected:
+    struct GlyphJob;
+
+    // the top of the used area of a page, across [x, x + width)
+    struct SkylineNode
+    {
+        int x;
+        int y;
+        int width;
+    };
+
     void relaseTextures();
+    void addLetter(unsigned short letter, unsigned char* bitmap, long bitmapWidth, long bitmapHeight, float rectX, float rectY, float rectWidth, float rectHeight, int xAdvance);
+    bool allocateRect(int width, int height, int &outX, int &outY);
+    void addPage();
+    void scheduleTextureUpdate();
+    static void updateDirtyTextures();
+
     std::unordered_map<ssize_t, Texture2D*> _atlasTextures;
     std::unordered_map<unsigned short, FontLetterDefinition> _fontLetterDefinitions;
     float _commonLineHeight;
@@ -121,9 +170,15 @@ protected:
     int _currentPage;
     unsigned char *_currentPageData;
     int _currentPageDataSize;
-    float _currentPageOrigX;
-    float _currentPageOrigY;
+    int _pageWidth;
+    int _pageHeight;
+    int _bytesPerPixel;
+    std::vector<SkylineNode> _skyline;
+    // rows of the current page to upload
+    int _dirtyTop;
+    int _dirtyBottom;
     float _letterPadding;
+    std::vector<std::shared_ptr<GlyphJob>> _glyphJobs;
 
     int _fontAscender;
     EventListenerCustom* _rendererRecreatedListener;
@@ -36,6 +36,7 @@ NS_CC_BEGIN
 
 FT_Library FontFreeType::_FTlibrary;
 bool       FontFreeType::_FTInitialized = false;
+std::mutex FontFreeType::_FTlibraryMutex;
 const int  FontFreeType::DistanceMapSpread = 3;
 
 typedef struct _DataRef
@@ -65,6 +66,7 @@ FontFreeType * FontFreeType::create(const std::string &fontName, int fontSize, G
 
 bool FontFreeType::initFreeType()
 {
+    std::lock_guard<std::mutex> lock(_FTlibraryMutex);
     if (_FTInitialized == false)
     {
         // begin freetype
@@ -79,6 +81,7 @@ bool FontFreeType::initFreeType()
 
 void FontFreeType::shutdownFreeType()
 {
+    std::lock_guard<std::mutex> lock(_FTlibraryMutex);
     if (_FTInitialized == true)
     {
         FT_Done_FreeType(_FTlibrary);
@@ -101,7 +104,9 @@ FontFreeType::FontFreeType(bool distanceFieldEnabled /* = false */,int outline /
     if (outline > 0)
     {
         _outlineSize = outline * CC_CONTENT_SCALE_FACTOR();
-        FT_Stroker_New(FontFreeType::getFTLibrary(), &_stroker);
+        auto library = FontFreeType::getFTLibrary();
+        std::lock_guard<std::mutex> lock(_FTlibraryMutex);
+        FT_Stroker_New(library, &_stroker);
         FT_Stroker_Set(_stroker,
             (int)(_outlineSize * 64),
             FT_STROKER_LINECAP_ROUND,
@@ -132,8 +137,11 @@ bool FontFreeType::createFontObject(const std::string &fontName, int fontSize)
         }
     }
 
-    if (FT_New_Memory_Face(getFTLibrary(), s_cacheFontData[fontName].data.getBytes(), s_cacheFontData[fontName].data.getSize(), 0, &face ))
+    auto library = getFTLibrary();
+    std::unique_lock<std::mutex> lock(_FTlibraryMutex);
+    if (FT_New_Memory_Face(library, s_cacheFontData[fontName].data.getBytes(), s_cacheFontData[fontName].data.getSize(), 0, &face ))
         return false;
+    lock.unlock();
     
     //we want to use unicode
     if (FT_Select_Charmap(face, FT_ENCODING_UNICODE))
@@ -154,13 +162,16 @@ bool FontFreeType::createFontObject(const std::string &fontName, int fontSize)
 
 FontFreeType::~FontFreeType()
 {
-    if (_stroker)
     {
-        FT_Stroker_Done(_stroker);
-    }
-    if (_fontRef)
-    {
-        FT_Done_Face(_fontRef);
+        std::lock_guard<std::mutex> lock(_FTlibraryMutex);
+        if (_stroker)
+        {
+            FT_Stroker_Done(_stroker);
+        }
+        if (_fontRef)
+        {
+            FT_Done_Face(_fontRef);
+        }
     }
 
     s_cacheFontData[_fontName].referenceCount -= 1;
@@ -200,6 +211,7 @@ int * FontFreeType::getHorizontalKerningForTextUTF16(const std::u16string& text,
         return nullptr;
     memset(sizes,0,outNumLetters * sizeof(int));
 
+    std::lock_guard<std::mutex> lock(_faceMutex);
     bool hasKerning = FT_HAS_KERNING( _fontRef ) != 0;
     if (hasKerning)
     {
@@ -248,6 +260,8 @@ unsigned char* FontFreeType::getGlyphBitmap(unsigned short theChar, long &outWid
 {
     bool invalidChar = true;
     unsigned char * ret = nullptr;
+    // loading a glyph renders it with the rasterizer of the library, the outline is stroked and rendered with it too
+    std::lock_guard<std::mutex> lock(_FTlibraryMutex);
 
     do 
     {
@@ -484,7 +498,47 @@ unsigned char * makeDistanceMap( unsigned char *img, long width, long height)
     return out;
 }
 
+unsigned char* FontFreeType::rasterizeGlyph(unsigned short theChar, long &outWidth, long &outHeight, Rect &outRect,int &xAdvance)
+{
+    std::lock_guard<std::mutex> lock(_faceMutex);
+
+    // the bitmap lives in the glyph slot of the face, it must be copied before the lock is released
+    auto bitmap = getGlyphBitmap(theChar, outWidth, outHeight, outRect, xAdvance);
+    if (bitmap == nullptr)
+    {
+        return nullptr;
+    }
+
+    long width = outWidth;
+    long height = outHeight;
+    if (_distanceFieldEnabled)
+    {
+        width += 2 * DistanceMapSpread;
+        height += 2 * DistanceMapSpread;
+    }
+    auto bytesPerPixel = _outlineSize > 0 ? 2 : 1;
+
+    auto glyph = new (std::nothrow) unsigned char[width * height * bytesPerPixel];
+    if (glyph)
+    {
+        renderCharAt(glyph, 0, 0, bitmap, outWidth, outHeight, width);
+    }
+    else if (_outlineSize > 0)
+    {
+        delete [] bitmap;
+    }
+
+    outWidth = width;
+    outHeight = height;
+    return glyph;
+}
+
 void FontFreeType::renderCharAt(unsigned char *dest,int posX, int posY, unsigned char* bitmap,long bitmapWidth,long bitmapHeight)
+{
+    renderCharAt(dest, posX, posY, bitmap, bitmapWidth, bitmapHeight, FontAtlas::CacheTextureWidth);
+}
+
+void FontFreeType::renderCharAt(unsigned char *dest,int posX, int posY, unsigned char* bitmap,long bitmapWidth,long bitmapHeight,long destWidth)
 {
     int iX = posX;
     int iY = posY;
@@ -510,7 +564,7 @@ void FontFreeType::renderCharAt(unsigned char *dest,int posX, int posY, unsigned
                 dest[index + 2] = out[index2 + 2];*/
 
                 //Single channel 8-bit output 
-                dest[iX + ( iY * FontAtlas::CacheTextureWidth )] = distanceMap[bitmap_y + x];
+                dest[iX + ( iY * destWidth )] = distanceMap[bitmap_y + x];
 
                 iX += 1;
             }
@@ -530,9 +584,9 @@ void FontFreeType::renderCharAt(unsigned char *dest,int posX, int posY, unsigned
             for (int x = 0; x < bitmapWidth; ++x)
             {
                 tempChar = bitmap[(bitmap_y + x) * 2];
-                dest[(iX + ( iY * FontAtlas::CacheTextureWidth ) ) * 2] = tempChar;
+                dest[(iX + ( iY * destWidth ) ) * 2] = tempChar;
                 tempChar = bitmap[(bitmap_y + x) * 2 + 1];
-                dest[(iX + ( iY * FontAtlas::CacheTextureWidth ) ) * 2 + 1] = tempChar;
+                dest[(iX + ( iY * destWidth ) ) * 2 + 1] = tempChar;
 
                 iX += 1;
             }
@@ -553,7 +607,7 @@ void FontFreeType::renderCharAt(unsigned char *dest,int posX, int posY, unsigned
                 unsigned char cTemp = bitmap[bitmap_y + x];
 
                 // the final pixel
-                dest[(iX + ( iY * FontAtlas::CacheTextureWidth ) )] = cTemp;
+                dest[(iX + ( iY * destWidth ) )] = cTemp;
 
                 iX += 1;
             }
@@ -31,6 +31,7 @@
 #include "CCFont.h"
 
 #include <string>
+#include <mutex>
 #include <ft2build.h>
 
 #if (CC_TARGET_PLATFORM == CC_PLATFORM_WP8) || (CC_TARGET_PLATFORM == CC_PLATFORM_WINRT)
@@ -60,11 +61,18 @@ public:
     bool     isDistanceFieldEnabled() const { return _distanceFieldEnabled;}
     float    getOutlineSize() const { return _outlineSize; }
     void     renderCharAt(unsigned char *dest,int posX, int posY, unsigned char* bitmap,long bitmapWidth,long bitmapHeight); 
+    void     renderCharAt(unsigned char *dest,int posX, int posY, unsigned char* bitmap,long bitmapWidth,long bitmapHeight,long destWidth);
 
     virtual FontAtlas   * createFontAtlas() override;
     virtual int         * getHorizontalKerningForTextUTF16(const std::u16string& text, int &outNumLetters) const override;
     
     unsigned char       * getGlyphBitmap(unsigned short theChar, long &outWidth, long &outHeight, Rect &outRect,int &xAdvance);
+
+    /** Renders a glyph in the pixel format of the atlas pages, distance map and outline included.
+     The returned buffer is outWidth x outHeight pixels, the caller deletes it with delete[].
+     It returns nullptr for the glyphs without bitmap. Unlike getGlyphBitmap(), it can be called from any thread.
+     */
+    unsigned char       * rasterizeGlyph(unsigned short theChar, long &outWidth, long &outHeight, Rect &outRect,int &xAdvance);
     
     virtual int           getFontMaxHeight() const override;  
     virtual int           getFontAscender() const;
@@ -85,11 +93,16 @@ private:
     
     static FT_Library _FTlibrary;
     static bool       _FTInitialized;
+    // the library, and the rasterizer and strokers it owns, can't be used by several threads at once.
+    // Lock it after _faceMutex, never before
+    static std::mutex _FTlibraryMutex;
     FT_Face           _fontRef;
     FT_Stroker        _stroker;
     std::string       _fontName;
     bool              _distanceFieldEnabled;
     float             _outlineSize;
+    // a FreeType face can't be used by several threads at once
+    mutable std::mutex _faceMutex;
 };
 
 /// @endcond
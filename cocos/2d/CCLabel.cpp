@@ -33,6 +33,7 @@
 #include "renderer/CCRenderer.h"
 #include "renderer/ccGLStateCache.h"
 #include "base/CCDirector.h"
+#include "base/CCFrameArena.h"
 #include "base/CCEventListenerCustom.h"
 #include "base/CCEventDispatcher.h"
 #include "base/CCEventCustom.h"
@@ -972,7 +973,7 @@ void Label::draw(Renderer *renderer, const Mat4 &transform, uint32_t flags)
 #endif
     {
         _customCommand.init(_globalZOrder, transform, flags);
-        _customCommand.func = CC_CALLBACK_0(Label::onDraw, this, transform, transformUpdated);
+        _customCommand.func = _director->getFrameArena()->makeCallback(CC_CALLBACK_0(Label::onDraw, this, transform, transformUpdated));
 
         renderer->addCommand(&_customCommand);
     }
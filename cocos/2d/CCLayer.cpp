@@ -33,6 +33,7 @@ THE SOFTWARE.
 #include "renderer/ccGLStateCache.h"
 #include "renderer/CCGLProgramState.h"
 #include "base/CCDirector.h"
+#include "base/CCFrameArena.h"
 #include "base/CCEventDispatcher.h"
 #include "base/CCEventListenerTouch.h"
 #include "base/CCEventTouch.h"
@@ -577,7 +578,7 @@ void LayerColor::updateColor()
 void LayerColor::draw(Renderer *renderer, const Mat4 &transform, uint32_t flags)
 {
     _customCommand.init(_globalZOrder, transform, flags);
-    _customCommand.func = CC_CALLBACK_0(LayerColor::onDraw, this, transform, flags);
+    _customCommand.func = _director->getFrameArena()->makeCallback(CC_CALLBACK_0(LayerColor::onDraw, this, transform, flags));
     renderer->addCommand(&_customCommand);
     
     for(int i = 0; i < 4; ++i)
@@ -27,6 +27,7 @@ THE SOFTWARE.
 #include "2d/CCMotionStreak.h"
 #include "math/CCVertex.h"
 #include "base/CCDirector.h"
+#include "base/CCFrameArena.h"
 #include "renderer/CCTextureCache.h"
 #include "renderer/ccGLStateCache.h"
 #include "renderer/CCTexture2D.h"
@@ -411,7 +412,7 @@ void MotionStreak::draw(Renderer *renderer, const Mat4 &transform, uint32_t flag
     if(_nuPoints <= 1)
         return;
     _customCommand.init(_globalZOrder, transform, flags);
-    _customCommand.func = CC_CALLBACK_0(MotionStreak::onDraw, this, transform, flags);
+    _customCommand.func = _director->getFrameArena()->makeCallback(CC_CALLBACK_0(MotionStreak::onDraw, this, transform, flags));
     renderer->addCommand(&_customCommand);
 }
 
@@ -78,6 +78,12 @@ bool nodeComparisonLess(Node* n1, Node* n2)
 // FIXME:: Yes, nodes might have a sort problem once every 15 days if the game runs at 60 FPS and each frame sprites are reordered.
 int Node::s_globalOrderOfArrival = 1;
 
+// Children added or reordered since the last sort are re-inserted one by one while there are at most
+// 1/16 of the children; above that a full std::sort is faster (measured on 100 to 5000 children).
+static const size_t INCREMENTAL_SORT_RATIO = 16;
+// Past this many tracked children the list is dropped and the next sort is a full one.
+static const size_t MAX_REORDERED_CHILDREN = 256;
+
 // MARK: Constructor, Destructor, Init
 
 Node::Node(void)
@@ -99,6 +105,7 @@ Node::Node(void)
 , _inverseDirty(true)
 , _useAdditionalTransform(false)
 , _transformUpdated(true)
+, _touchBoundsTracked(false)
 // children (lazy allocs)
 // lazy alloc
 , _localZOrder(0)
@@ -117,6 +124,7 @@ Node::Node(void)
 , _visible(true)
 , _ignoreAnchorPointForPosition(false)
 , _reorderChildDirty(false)
+, _reorderedChildrenOverflow(false)
 , _isTransitionFinished(false)
 #if CC_ENABLE_SCRIPT_BINDING
 , _updateScriptHandler(0)
@@ -128,6 +136,7 @@ Node::Node(void)
 , _physicsScaleStartY(1.0f)
 , _physicsRotation(0.0f)
 , _physicsTransformDirty(true)
+, _physicsTransformQueued(false)
 , _updateTransformFromPhysics(true)
 , _physicsWorld(nullptr)
 , _physicsBodyAssociatedWith(0)
@@ -201,6 +210,13 @@ Node::~Node()
         child->_parent = nullptr;
     }
 
+#if CC_USE_PHYSICS
+    if (_physicsTransformQueued && _physicsWorld)
+    {
+        _physicsWorld->unmarkBodyTransformDirty(this);
+    }
+#endif
+
     removeAllComponents();
     
     CC_SAFE_DELETE(_componentContainer);
@@ -308,10 +324,13 @@ void Node::setLocalZOrder(int z)
     _localZOrder = z;
     if (_parent)
     {
+        // also marks the listeners of this node dirty
         _parent->reorderChild(this, z);
     }
-
-    _eventDispatcher->setDirtyForNode(this);
+    else
+    {
+        _eventDispatcher->setDirtyForNode(this);
+    }
 }
 
 /// zOrder setter : private method
@@ -348,7 +367,7 @@ void Node::setRotation(float rotation)
 #if CC_USE_PHYSICS
     if (_physicsWorld && _physicsBodyAssociatedWith > 0)
     {
-        _physicsWorld->_updateBodyTransform = true;
+        _physicsWorld->markBodyTransformDirty(this);
     }
 #endif
     
@@ -490,7 +509,7 @@ void Node::setScale(float scale)
 #if CC_USE_PHYSICS
     if (_physicsWorld && _physicsBodyAssociatedWith > 0)
     {
-        _physicsWorld->_updateBodyTransform = true;
+        _physicsWorld->markBodyTransformDirty(this);
     }
 #endif
 }
@@ -513,7 +532,7 @@ void Node::setScale(float scaleX,float scaleY)
 #if CC_USE_PHYSICS
     if (_physicsWorld && _physicsBodyAssociatedWith > 0)
     {
-        _physicsWorld->_updateBodyTransform = true;
+        _physicsWorld->markBodyTransformDirty(this);
     }
 #endif
 }
@@ -529,7 +548,7 @@ void Node::setScaleX(float scaleX)
 #if CC_USE_PHYSICS
     if (_physicsWorld && _physicsBodyAssociatedWith > 0)
     {
-        _physicsWorld->_updateBodyTransform = true;
+        _physicsWorld->markBodyTransformDirty(this);
     }
 #endif
 }
@@ -574,7 +593,7 @@ void Node::setScaleY(float scaleY)
 #if CC_USE_PHYSICS
     if (_physicsWorld && _physicsBodyAssociatedWith > 0)
     {
-        _physicsWorld->_updateBodyTransform = true;
+        _physicsWorld->markBodyTransformDirty(this);
     }
 #endif
 }
@@ -611,7 +630,7 @@ void Node::setPosition(float x, float y)
 #if CC_USE_PHYSICS
     if (_physicsWorld && _physicsBodyAssociatedWith > 0)
     {
-        _physicsWorld->_updateBodyTransform = true;
+        _physicsWorld->markBodyTransformDirty(this);
     }
 #endif
 }
@@ -681,7 +700,7 @@ void Node::setNormalizedPosition(const Vec2& position)
 #if CC_USE_PHYSICS
     if (_physicsWorld && _physicsBodyAssociatedWith > 0)
     {
-        _physicsWorld->_updateBodyTransform = true;
+        _physicsWorld->markBodyTransformDirty(this);
     }
 #endif
 }
@@ -1195,6 +1214,11 @@ void Node::removeFromPhysicsWorld()
         _physicsBody->removeFromWorld();
     }
 
+    if (_physicsTransformQueued && _physicsWorld)
+    {
+        _physicsWorld->unmarkBodyTransformDirty(this);
+    }
+
     for (auto child : _children)
     {
         child->removeFromPhysicsWorld();
@@ -1229,6 +1253,8 @@ void Node::removeAllChildrenWithCleanup(bool cleanup)
     }
     
     _children.clear();
+    _reorderedChildren.clear();
+    _reorderedChildrenOverflow = false;
 }
 
 void Node::detachChild(Node *child, ssize_t childIndex, bool doCleanup)
@@ -1278,6 +1304,7 @@ void Node::insertChild(Node* child, int z)
     //_children是cocos为Ref量身定制的向量Vector<T>，这个向量只能给继承了Ref的类来使用。
     _children.pushBack(child);//调用CCVector.h里封装的Vector容器进行存储。
     child->_localZOrder = z;
+    addReorderedChild(child);
 }
 
 void Node::reorderChild(Node *child, int zOrder)
@@ -1286,17 +1313,90 @@ void Node::reorderChild(Node *child, int zOrder)
     _reorderChildDirty = true;
     child->setOrderOfArrival(s_globalOrderOfArrival++);
     child->_localZOrder = zOrder;
+    addReorderedChild(child);
+
+    // the listeners of the subtree change their place in the scene graph priority order
+    _eventDispatcher->setDirtyForNode(child);
 }
 
 void Node::sortAllChildren()
 {
     if (_reorderChildDirty)
     {
-        std::sort(std::begin(_children), std::end(_children), nodeComparisonLess);
+        sortChildrenByLocalZOrder();
         _reorderChildDirty = false;
     }
 }
 
+void Node::addReorderedChild(Node* child)
+{
+    if (_reorderedChildrenOverflow)
+        return;
+
+    if (_reorderedChildren.size() >= MAX_REORDERED_CHILDREN)
+    {
+        _reorderedChildren.clear();
+        _reorderedChildrenOverflow = true;
+        return;
+    }
+
+    _reorderedChildren.push_back(child);
+}
+
+void Node::sortChildrenByLocalZOrder()
+{
+    auto& reordered = _reorderedChildren;
+    const size_t count = _children.size();
+
+    // Nothing tracked means the dirty flag was set by a subclass directly, so don't trust the order.
+    if (_reorderedChildrenOverflow || reordered.empty() || reordered.size() * INCREMENTAL_SORT_RATIO > count)
+    {
+        std::sort(std::begin(_children), std::end(_children), nodeComparisonLess);
+    }
+    else
+    {
+        // The children that were not reordered are still sorted relative to each other.
+        // Pull the reordered ones out, keeping the rest packed at the front...
+        std::sort(reordered.begin(), reordered.end());
+        reordered.erase(std::unique(reordered.begin(), reordered.end()), reordered.end());
+
+        std::vector<Node*> moved;
+        moved.reserve(reordered.size());
+        auto cleanEnd = std::begin(_children);
+        for (auto it = std::begin(_children); it != std::end(_children); ++it)
+        {
+            if (std::binary_search(reordered.begin(), reordered.end(), *it))
+                moved.push_back(*it);
+            else
+                *cleanEnd++ = *it;
+        }
+
+        // ...then find where each one goes with a binary search and shift the clean runs into
+        // place from the back, so every pointer moves at most once.
+        std::sort(moved.begin(), moved.end(), nodeComparisonLess);
+
+        std::vector<decltype(cleanEnd)> positions(moved.size());
+        auto from = std::begin(_children);
+        for (size_t i = 0; i < moved.size(); ++i)
+        {
+            from = std::upper_bound(from, cleanEnd, moved[i], nodeComparisonLess);
+            positions[i] = from;
+        }
+
+        auto src = cleanEnd;
+        auto dst = std::end(_children);
+        for (size_t i = moved.size(); i-- > 0; )
+        {
+            dst = std::move_backward(positions[i], src, dst);
+            src = positions[i];
+            *--dst = moved[i];
+        }
+    }
+
+    reordered.clear();
+    _reorderedChildrenOverflow = false;
+}
+
 // MARK: draw / visit
 
 void Node::draw()
@@ -1321,7 +1421,7 @@ void Node::visit()
 uint32_t Node::processParentFlags(const Mat4& parentTransform, uint32_t parentFlags)
 {
 #if CC_USE_PHYSICS
-    if (_physicsBody && _updateTransformFromPhysics)
+    if (_physicsBody && _updateTransformFromPhysics && ((parentFlags & FLAGS_DIRTY_MASK) || _physicsBody->_nodeTransformDirty))
     {
         updateTransformFromPhysics(parentTransform, parentFlags);
     }
@@ -1340,7 +1440,13 @@ uint32_t Node::processParentFlags(const Mat4& parentTransform, uint32_t parentFl
     }
     
     if (!isVisitableByVisitingCamera())
+    {
+        if (_touchBoundsTracked && (parentFlags & FLAGS_DIRTY_MASK))
+        {
+            _eventDispatcher->setTouchBoundsDirty(this);
+        }
         return parentFlags;
+    }
     
     uint32_t flags = parentFlags;
     flags |= (_transformUpdated ? FLAGS_TRANSFORM_DIRTY : 0);
@@ -1360,6 +1466,11 @@ uint32_t Node::processParentFlags(const Mat4& parentTransform, uint32_t parentFl
     _contentSizeDirty = false;
 #endif
 
+    if (_touchBoundsTracked && (flags & FLAGS_DIRTY_MASK))
+    {
+        _eventDispatcher->setTouchBoundsDirty(this);
+    }
+
     return flags;
 }
 
@@ -2156,25 +2267,39 @@ void Node::updatePhysicsBodyTransform(const Mat4& parentTransform, uint32_t pare
     if (_physicsBody && ((flags & FLAGS_DIRTY_MASK) || _physicsTransformDirty))
     {
         _physicsTransformDirty = false;
-        Vec3 vec3(_position.x, _position.y, 0);
-        Vec3 ret;
-        parentTransform.transformPoint(vec3, &ret);
-        _physicsBody->setPosition(Vec2(ret.x, ret.y));
+        // a node showing an interpolated state of its body would move the body back in time
+        bool showsStepTransform = _physicsBody->_nodeShowsStepTransform && !(parentFlags & FLAGS_DIRTY_MASK)
+            && _position == _physicsBody->_stepNodePosition && _rotationZ_X == _physicsBody->_stepNodeRotation;
+        if (!showsStepTransform)
+        {
+            Vec3 vec3(_position.x, _position.y, 0);
+            Vec3 ret;
+            parentTransform.transformPoint(vec3, &ret);
+            _physicsBody->setPosition(Vec2(ret.x, ret.y));
+            _physicsBody->setRotation(_physicsRotation - _physicsRotationOffset);
+        }
         _physicsBody->setScale(scaleX / _physicsScaleStartX, scaleY / _physicsScaleStartY);
-        _physicsBody->setRotation(_physicsRotation - _physicsRotationOffset);
     }
 
     for (auto node : _children)
     {
-        node->updatePhysicsBodyTransform(_modelViewTransform, flags, scaleX, scaleY);
+        // no body below this child, nothing to sync
+        if (node->_physicsBodyAssociatedWith > 0)
+        {
+            node->updatePhysicsBodyTransform(_modelViewTransform, flags, scaleX, scaleY);
+        }
     }
 }
 
 void Node::updateTransformFromPhysics(const Mat4& parentTransform, uint32_t parentFlags)
 {
-    auto& newPosition = _physicsBody->getPosition();
+    Vec2 newPosition;
+    float newRotation;
+    _physicsBody->getStepTransform(&newPosition, &newRotation);
     auto& recordedPosition = _physicsBody->_recordedPosition;
-    auto updateBodyTransform = _physicsWorld->_updateBodyTransform;
+    // the node follows its body here, it doesn't need to be synced back to the body
+    auto transformQueued = _physicsTransformQueued;
+    _physicsTransformQueued = true;
     if (parentFlags || recordedPosition.x != newPosition.x || recordedPosition.y != newPosition.y)
     {
         recordedPosition = newPosition;
@@ -2183,9 +2308,14 @@ void Node::updateTransformFromPhysics(const Mat4& parentTransform, uint32_t pare
         parentTransform.getInversed().transformPoint(vec3, &ret);
         setPosition(ret.x, ret.y);
     }
-    _physicsRotation = _physicsBody->getRotation();
+    _physicsRotation = newRotation;
     setRotation(_physicsRotation - _parent->_physicsRotation + _physicsRotationOffset);
-    _physicsWorld->_updateBodyTransform = updateBodyTransform;
+    _physicsTransformQueued = transformQueued;
+    _physicsBody->_nodeTransformDirty = false;
+    
+    _physicsBody->_nodeShowsStepTransform = _physicsWorld->isInterpolatingSteps();
+    _physicsBody->_stepNodePosition = _position;
+    _physicsBody->_stepNodeRotation = _rotationZ_X;
 }
 
 #endif //CC_USE_PHYSICS
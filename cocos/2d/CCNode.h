@@ -1723,6 +1723,13 @@ protected:
     /// Removes a child, call child->onExit(), do cleanup, remove it from children array.
     void detachChild(Node *child, ssize_t index, bool doCleanup);
 
+    /// Remembers a child whose position in the children array may be wrong until the next sort.
+    void addReorderedChild(Node* child);
+
+    /// Sorts the children with nodeComparisonLess. When only a few children were added or reordered since the
+    /// last sort, only those are re-inserted, otherwise the whole array is sorted.
+    void sortChildrenByLocalZOrder();
+
     /// Convert cocos2d coordinates to UI windows coordinate.
     Vec2 convertToWindowSpace(const Vec2& nodePoint) const;
 
@@ -1790,6 +1797,8 @@ protected:
     bool _useAdditionalTransform;   ///< The flag to check whether the additional transform is dirty
     bool _transformUpdated;         ///< Whether or not the Transform object was updated since the last frame
 
+    bool _touchBoundsTracked;       ///< whether the event dispatcher's touch spatial index holds this node's bounds
+
     int _localZOrder;               ///< Local order (relative to its siblings) used to sort the node
     float _globalZOrder;            ///< Global order used to sort the node
 
@@ -1822,6 +1831,8 @@ protected:
                                           ///< Used by Layer and Scene.
 
     bool _reorderChildDirty;          ///< children order dirty flag
+    std::vector<Node*> _reorderedChildren;  ///< children added or reordered since the last sort
+    bool _reorderedChildrenOverflow;  ///< too many children were reordered to track them, do a full sort
     bool _isTransitionFinished;       ///< flag to indicate whether the transition was finished
 
 #if CC_ENABLE_SCRIPT_BINDING
@@ -1838,6 +1849,7 @@ protected:
     float _physicsScaleStartY;         ///< the scale y value when setPhysicsBody
     float _physicsRotation;
     bool _physicsTransformDirty;
+    bool _physicsTransformQueued;     ///< waiting in the PhysicsWorld to sync its bodies
     bool _updateTransformFromPhysics;
 
     PhysicsWorld* _physicsWorld; /** The PhysicsWorld associated with the node.*/
@@ -1865,9 +1877,12 @@ protected:
 
 private:
     CC_DISALLOW_COPY_AND_ASSIGN(Node);
+
+    friend class EventDispatcher;
     
 #if CC_USE_PHYSICS
     friend class Scene;
+    friend class PhysicsWorld;
 #endif //CC_USTPS
 };
 
@@ -33,6 +33,7 @@
 #include "2d/CCParticleSystem.h"
 #include "renderer/CCTextureCache.h"
 #include "renderer/CCQuadCommand.h"
+#include "base/CCProfiling.h"
 #include "renderer/CCRenderer.h"
 #include "renderer/CCTextureAtlas.h"
 #include "deprecated/CCString.h"
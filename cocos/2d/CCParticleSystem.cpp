@@ -45,12 +45,18 @@ THE SOFTWARE.
 #include "2d/CCParticleSystem.h"
 
 #include <string>
+#include <algorithm>
 
 #include "2d/CCParticleBatchNode.h"
 #include "renderer/CCTextureAtlas.h"
+#include "renderer/CCRenderer.h"
+#include "renderer/CCRenderWorkerPool.h"
 #include "base/base64.h"
 #include "base/ZipUtils.h"
 #include "base/CCDirector.h"
+#include "base/CCProfiling.h"
+#include "base/CCScheduler.h"
+#include "math/MathUtil.h"
 #include "renderer/CCTextureCache.h"
 #include "deprecated/CCString.h"
 #include "platform/CCFileUtils.h"
@@ -77,15 +83,248 @@ NS_CC_BEGIN
 //  cocos2d uses a another approach, but the results are almost identical. 
 //
 
+ParticleData::ParticleData()
+: posx(nullptr)
+, posy(nullptr)
+, startPosX(nullptr)
+, startPosY(nullptr)
+, colorR(nullptr)
+, colorG(nullptr)
+, colorB(nullptr)
+, colorA(nullptr)
+, deltaColorR(nullptr)
+, deltaColorG(nullptr)
+, deltaColorB(nullptr)
+, deltaColorA(nullptr)
+, size(nullptr)
+, deltaSize(nullptr)
+, rotation(nullptr)
+, deltaRotation(nullptr)
+, timeToLive(nullptr)
+, atlasIndex(nullptr)
+, modeA()
+, modeB()
+, maxCount(0)
+, _buffer(nullptr)
+{
+}
+
+bool ParticleData::init(int count)
+{
+    release();
+
+    // pad every array to a multiple of four elements so each one starts 16 bytes aligned
+    // relative to the buffer, which keeps the SIMD kernels on their fast path
+    const size_t stride = (count + 3) & ~3;
+    float** arrays[] = {
+        &posx, &posy, &startPosX, &startPosY,
+        &colorR, &colorG, &colorB, &colorA,
+        &deltaColorR, &deltaColorG, &deltaColorB, &deltaColorA,
+        &size, &deltaSize, &rotation, &deltaRotation, &timeToLive,
+        &modeA.dirX, &modeA.dirY, &modeA.radialAccel, &modeA.tangentialAccel,
+        &modeB.angle, &modeB.degreesPerSecond, &modeB.radius, &modeB.deltaRadius,
+    };
+    const size_t arrayCount = sizeof(arrays) / sizeof(arrays[0]);
+
+    static_assert(sizeof(unsigned int) == sizeof(float), "atlasIndex shares the float buffer layout");
+    _buffer = calloc(stride * (arrayCount + 1), sizeof(float));
+    if (!_buffer)
+    {
+        return false;
+    }
+
+    float* slice = static_cast<float*>(_buffer);
+    for (size_t i = 0; i < arrayCount; ++i)
+    {
+        *arrays[i] = slice;
+        slice += stride;
+    }
+    atlasIndex = reinterpret_cast<unsigned int*>(slice);
+
+    maxCount = count;
+    return true;
+}
+
+void ParticleData::release()
+{
+    CC_SAFE_FREE(_buffer);
+    *this = ParticleData();
+}
+
+void ParticleData::copyParticle(int p1, int p2)
+{
+    posx[p1] = posx[p2];
+    posy[p1] = posy[p2];
+    startPosX[p1] = startPosX[p2];
+    startPosY[p1] = startPosY[p2];
+
+    colorR[p1] = colorR[p2];
+    colorG[p1] = colorG[p2];
+    colorB[p1] = colorB[p2];
+    colorA[p1] = colorA[p2];
+
+    deltaColorR[p1] = deltaColorR[p2];
+    deltaColorG[p1] = deltaColorG[p2];
+    deltaColorB[p1] = deltaColorB[p2];
+    deltaColorA[p1] = deltaColorA[p2];
+
+    size[p1] = size[p2];
+    deltaSize[p1] = deltaSize[p2];
+    rotation[p1] = rotation[p2];
+    deltaRotation[p1] = deltaRotation[p2];
+    timeToLive[p1] = timeToLive[p2];
+    atlasIndex[p1] = atlasIndex[p2];
+
+    modeA.dirX[p1] = modeA.dirX[p2];
+    modeA.dirY[p1] = modeA.dirY[p2];
+    modeA.radialAccel[p1] = modeA.radialAccel[p2];
+    modeA.tangentialAccel[p1] = modeA.tangentialAccel[p2];
+
+    modeB.angle[p1] = modeB.angle[p2];
+    modeB.degreesPerSecond[p1] = modeB.degreesPerSecond[p2];
+    modeB.radius[p1] = modeB.radius[p2];
+    modeB.deltaRadius[p1] = modeB.deltaRadius[p2];
+}
+
+// Collects the particle systems updated during a frame and simulates them together once the
+// scheduler has run all the updates. Systems sharing a batch node write to the same texture atlas,
+// so they form one group that is simulated in atlas order; the groups run on the renderer's worker pool.
+class ParallelParticleUpdater
+{
+public:
+    static ParallelParticleUpdater* getInstance()
+    {
+        static ParallelParticleUpdater instance;
+        return &instance;
+    }
+
+    void add(ParticleSystem* system, float dt)
+    {
+        // a system updated again before the flush, e.g. by updateWithNoTime(), is simulated once
+        if (system->_parallelUpdateIndex >= 0)
+        {
+            _pending[system->_parallelUpdateIndex].dt += dt;
+            return;
+        }
+
+        auto director = Director::getInstance();
+        if (_pending.empty() || _flushFrame != director->getTotalFrames())
+        {
+            // the functions performed in the cocos thread run right after the scheduled updates
+            _flushFrame = director->getTotalFrames();
+            director->getScheduler()->performFunctionInCocosThread([this](){ flush(); });
+        }
+
+        system->retain();
+        system->_parallelUpdateIndex = (int)_pending.size();
+        PendingUpdate update = { system, dt, false };
+        _pending.push_back(update);
+    }
+
+private:
+    struct PendingUpdate
+    {
+        ParticleSystem* system;
+        float dt;
+        bool lastParticleDied;
+    };
+
+    ParallelParticleUpdater()
+    : _flushFrame(0)
+    {
+    }
+
+    void flush()
+    {
+        if (_pending.empty())
+            return;
+
+        // updates added by the callbacks below go to the next flush
+        std::vector<PendingUpdate> pending;
+        pending.swap(_pending);
+
+        for (auto& update : pending)
+        {
+            update.system->_parallelUpdateIndex = -1;
+        }
+
+        // systems without a batch node are groups of their own, in the order they were updated
+        std::stable_sort(pending.begin(), pending.end(), [](const PendingUpdate& a, const PendingUpdate& b){
+            ParticleBatchNode* batchA = a.system->getBatchNode();
+            ParticleBatchNode* batchB = b.system->getBatchNode();
+            if (batchA != batchB)
+                return std::less<ParticleBatchNode*>()(batchA, batchB);
+            return batchA && a.system->getAtlasIndex() < b.system->getAtlasIndex();
+        });
+
+        _groups.clear();
+        for (size_t i = 0; i < pending.size(); ++i)
+        {
+            ParticleBatchNode* batchNode = pending[i].system->getBatchNode();
+            if (i == 0 || batchNode == nullptr || batchNode != pending[i - 1].system->getBatchNode())
+            {
+                _groups.push_back(i);
+            }
+        }
+        _groups.push_back(pending.size());
+
+        auto simulateGroups = [&](ssize_t begin, ssize_t end){
+            for (ssize_t group = begin; group < end; ++group)
+            {
+                for (size_t i = _groups[group]; i < _groups[group + 1]; ++i)
+                {
+                    pending[i].lastParticleDied = pending[i].system->simulateParticles(pending[i].dt);
+                }
+            }
+        };
+
+        ssize_t groupCount = (ssize_t)_groups.size() - 1;
+        // shared with the renderer's parallel fill, which only runs while the scene is drawn
+        RenderWorkerPool* workers = Director::getInstance()->getRenderer()->getWorkerPool();
+        if (workers && workers->getConcurrency() > 1 && groupCount > 1)
+        {
+            CC_PROFILER_SCOPE("ParticleSystem - parallel update");
+            workers->parallelFor(groupCount, 1, simulateGroups);
+        }
+        else
+        {
+            simulateGroups(0, groupCount);
+        }
+
+        for (auto& update : pending)
+        {
+            update.system->finishUpdate(update.lastParticleDied);
+            update.system->release();
+        }
+    }
+
+    std::vector<PendingUpdate> _pending;
+    // start of every group in the sorted pending list, plus the end of the last one
+    std::vector<size_t> _groups;
+    unsigned int _flushFrame;
+};
+
+static bool s_parallelUpdateEnabled = false;
+
+void ParticleSystem::setParallelUpdateEnabled(bool enabled)
+{
+    s_parallelUpdateEnabled = enabled;
+}
+
+bool ParticleSystem::isParallelUpdateEnabled()
+{
+    return s_parallelUpdateEnabled;
+}
+
 ParticleSystem::ParticleSystem()
 : _isBlendAdditive(false)
 , _isAutoRemoveOnFinish(false)
 , _plistFile("")
 , _elapsed(0)
-, _particles(nullptr)
 , _configName("")
 , _emitCounter(0)
 , _particleIdx(0)
+, _parallelUpdateIndex(-1)
 , _batchNode(nullptr)
 , _atlasIndex(0)
 , _transformSystemDirty(false)
@@ -114,6 +353,7 @@ ParticleSystem::ParticleSystem()
 , _yCoordFlipped(1)
 , _positionType(PositionType::FREE)
 {
+    memset(_emitterOffsetTransform, 0, sizeof(_emitterOffsetTransform));
     modeA.gravity.setZero();
     modeA.speed = 0;
     modeA.speedVar = 0;
@@ -427,11 +667,7 @@ bool ParticleSystem::initWithTotalParticles(int numberOfParticles)
 {
     _totalParticles = numberOfParticles;
 
-    CC_SAFE_FREE(_particles);
-    
-    _particles = (tParticle*)calloc(_totalParticles, sizeof(tParticle));
-
-    if( ! _particles )
+    if( ! _particleData.init(_totalParticles) )
     {
         CCLOG("Particle system: not enough memory");
         this->release();
@@ -443,7 +679,7 @@ bool ParticleSystem::initWithTotalParticles(int numberOfParticles)
     {
         for (int i = 0; i < _totalParticles; i++)
         {
-            _particles[i].atlasIndex=i;
+            _particleData.atlasIndex[i] = i;
         }
     }
     // default, active
@@ -478,7 +714,7 @@ ParticleSystem::~ParticleSystem()
     // Since the scheduler retains the "target (in this case the ParticleSystem)
 	// it is not needed to call "unscheduleUpdate" here. In fact, it will be called in "cleanup"
     //unscheduleUpdate();
-    CC_SAFE_FREE(_particles);
+    _particleData.release();
     CC_SAFE_RELEASE(_texture);
 }
 
@@ -489,123 +725,190 @@ bool ParticleSystem::addParticle()
         return false;
     }
 
-    tParticle * particle = &_particles[ _particleCount ];
-    this->initParticle(particle);
-    ++_particleCount;
+    addParticles(1);
 
     return true;
 }
 
-void ParticleSystem::initParticle(tParticle* particle)
+void ParticleSystem::addParticles(int count)
 {
+    count = MIN(count, _totalParticles - _particleCount);
+    if (count <= 0)
+    {
+        return;
+    }
+
+    const int start = _particleCount;
+    const int end = start + count;
+    ParticleData& p = _particleData;
+
     // timeToLive
     // no negative life. prevent division by 0
-    particle->timeToLive = _life + _lifeVar * CCRANDOM_MINUS1_1();
-    particle->timeToLive = MAX(0, particle->timeToLive);
+    for (int i = start; i < end; ++i)
+    {
+        p.timeToLive[i] = MAX(0, _life + _lifeVar * CCRANDOM_MINUS1_1());
+    }
 
     // position
-    particle->pos.x = _sourcePosition.x + _posVar.x * CCRANDOM_MINUS1_1();
-
-    particle->pos.y = _sourcePosition.y + _posVar.y * CCRANDOM_MINUS1_1();
-
+    for (int i = start; i < end; ++i)
+    {
+        p.posx[i] = _sourcePosition.x + _posVar.x * CCRANDOM_MINUS1_1();
+    }
+    for (int i = start; i < end; ++i)
+    {
+        p.posy[i] = _sourcePosition.y + _posVar.y * CCRANDOM_MINUS1_1();
+    }
 
-    // Color
-    Color4F start;
-    start.r = clampf(_startColor.r + _startColorVar.r * CCRANDOM_MINUS1_1(), 0, 1);
-    start.g = clampf(_startColor.g + _startColorVar.g * CCRANDOM_MINUS1_1(), 0, 1);
-    start.b = clampf(_startColor.b + _startColorVar.b * CCRANDOM_MINUS1_1(), 0, 1);
-    start.a = clampf(_startColor.a + _startColorVar.a * CCRANDOM_MINUS1_1(), 0, 1);
+    // color
+#define SET_COLOR(c, b, v)                                                      \
+    for (int i = start; i < end; ++i)                                          \
+    {                                                                           \
+        c[i] = clampf(b + v * CCRANDOM_MINUS1_1(), 0, 1);                       \
+    }
 
-    Color4F end;
-    end.r = clampf(_endColor.r + _endColorVar.r * CCRANDOM_MINUS1_1(), 0, 1);
-    end.g = clampf(_endColor.g + _endColorVar.g * CCRANDOM_MINUS1_1(), 0, 1);
-    end.b = clampf(_endColor.b + _endColorVar.b * CCRANDOM_MINUS1_1(), 0, 1);
-    end.a = clampf(_endColor.a + _endColorVar.a * CCRANDOM_MINUS1_1(), 0, 1);
+    SET_COLOR(p.colorR, _startColor.r, _startColorVar.r);
+    SET_COLOR(p.colorG, _startColor.g, _startColorVar.g);
+    SET_COLOR(p.colorB, _startColor.b, _startColorVar.b);
+    SET_COLOR(p.colorA, _startColor.a, _startColorVar.a);
+
+    // the end color is staged in the delta arrays and turned into a delta below
+    SET_COLOR(p.deltaColorR, _endColor.r, _endColorVar.r);
+    SET_COLOR(p.deltaColorG, _endColor.g, _endColorVar.g);
+    SET_COLOR(p.deltaColorB, _endColor.b, _endColorVar.b);
+    SET_COLOR(p.deltaColorA, _endColor.a, _endColorVar.a);
+#undef SET_COLOR
+
+#define SET_DELTA_COLOR(c, dc)                                                  \
+    for (int i = start; i < end; ++i)                                          \
+    {                                                                           \
+        dc[i] = (dc[i] - c[i]) / p.timeToLive[i];                               \
+    }
 
-    particle->color = start;
-    particle->deltaColor.r = (end.r - start.r) / particle->timeToLive;
-    particle->deltaColor.g = (end.g - start.g) / particle->timeToLive;
-    particle->deltaColor.b = (end.b - start.b) / particle->timeToLive;
-    particle->deltaColor.a = (end.a - start.a) / particle->timeToLive;
+    SET_DELTA_COLOR(p.colorR, p.deltaColorR);
+    SET_DELTA_COLOR(p.colorG, p.deltaColorG);
+    SET_DELTA_COLOR(p.colorB, p.deltaColorB);
+    SET_DELTA_COLOR(p.colorA, p.deltaColorA);
+#undef SET_DELTA_COLOR
 
     // size
-    float startS = _startSize + _startSizeVar * CCRANDOM_MINUS1_1();
-    startS = MAX(0, startS); // No negative value
-
-    particle->size = startS;
+    for (int i = start; i < end; ++i)
+    {
+        p.size[i] = MAX(0, _startSize + _startSizeVar * CCRANDOM_MINUS1_1()); // No negative value
+    }
 
     if (_endSize == START_SIZE_EQUAL_TO_END_SIZE)
     {
-        particle->deltaSize = 0;
+        for (int i = start; i < end; ++i)
+        {
+            p.deltaSize[i] = 0;
+        }
     }
     else
     {
-        float endS = _endSize + _endSizeVar * CCRANDOM_MINUS1_1();
-        endS = MAX(0, endS); // No negative values
-        particle->deltaSize = (endS - startS) / particle->timeToLive;
+        for (int i = start; i < end; ++i)
+        {
+            float endS = MAX(0, _endSize + _endSizeVar * CCRANDOM_MINUS1_1()); // No negative values
+            p.deltaSize[i] = (endS - p.size[i]) / p.timeToLive[i];
+        }
     }
 
     // rotation
-    float startA = _startSpin + _startSpinVar * CCRANDOM_MINUS1_1();
-    float endA = _endSpin + _endSpinVar * CCRANDOM_MINUS1_1();
-    particle->rotation = startA;
-    particle->deltaRotation = (endA - startA) / particle->timeToLive;
+    for (int i = start; i < end; ++i)
+    {
+        p.rotation[i] = _startSpin + _startSpinVar * CCRANDOM_MINUS1_1();
+    }
+    for (int i = start; i < end; ++i)
+    {
+        float endA = _endSpin + _endSpinVar * CCRANDOM_MINUS1_1();
+        p.deltaRotation[i] = (endA - p.rotation[i]) / p.timeToLive[i];
+    }
 
     // position
+    Vec2 startPos;
     if (_positionType == PositionType::FREE)
     {
-        particle->startPos = this->convertToWorldSpace(Vec2::ZERO);
+        startPos = this->convertToWorldSpace(Vec2::ZERO);
     }
     else if (_positionType == PositionType::RELATIVE)
     {
-        particle->startPos = _position;
+        startPos = _position;
+    }
+    for (int i = start; i < end; ++i)
+    {
+        p.startPosX[i] = startPos.x;
+        p.startPosY[i] = startPos.y;
     }
-
-    // direction
-    float a = CC_DEGREES_TO_RADIANS( _angle + _angleVar * CCRANDOM_MINUS1_1() );    
 
     // Mode Gravity: A
     if (_emitterMode == Mode::GRAVITY)
     {
-        Vec2 v(cosf( a ), sinf( a ));
-        float s = modeA.speed + modeA.speedVar * CCRANDOM_MINUS1_1();
-
         // direction
-        particle->modeA.dir = v * s ;
+        for (int i = start; i < end; ++i)
+        {
+            float a = CC_DEGREES_TO_RADIANS( _angle + _angleVar * CCRANDOM_MINUS1_1() );
+            float s = modeA.speed + modeA.speedVar * CCRANDOM_MINUS1_1();
+            p.modeA.dirX[i] = cosf( a ) * s;
+            p.modeA.dirY[i] = sinf( a ) * s;
+        }
 
         // radial accel
-        particle->modeA.radialAccel = modeA.radialAccel + modeA.radialAccelVar * CCRANDOM_MINUS1_1();
- 
+        for (int i = start; i < end; ++i)
+        {
+            p.modeA.radialAccel[i] = modeA.radialAccel + modeA.radialAccelVar * CCRANDOM_MINUS1_1();
+        }
 
         // tangential accel
-        particle->modeA.tangentialAccel = modeA.tangentialAccel + modeA.tangentialAccelVar * CCRANDOM_MINUS1_1();
+        for (int i = start; i < end; ++i)
+        {
+            p.modeA.tangentialAccel[i] = modeA.tangentialAccel + modeA.tangentialAccelVar * CCRANDOM_MINUS1_1();
+        }
 
         // rotation is dir
-        if(modeA.rotationIsDir)
-            particle->rotation = -CC_RADIANS_TO_DEGREES(particle->modeA.dir.getAngle());
+        if (modeA.rotationIsDir)
+        {
+            for (int i = start; i < end; ++i)
+            {
+                p.rotation[i] = -CC_RADIANS_TO_DEGREES(atan2f(p.modeA.dirY[i], p.modeA.dirX[i]));
+            }
+        }
     }
 
     // Mode Radius: B
-    else 
+    else
     {
         // Set the default diameter of the particle from the source position
-        float startRadius = modeB.startRadius + modeB.startRadiusVar * CCRANDOM_MINUS1_1();
-        float endRadius = modeB.endRadius + modeB.endRadiusVar * CCRANDOM_MINUS1_1();
-
-        particle->modeB.radius = startRadius;
+        for (int i = start; i < end; ++i)
+        {
+            p.modeB.radius[i] = modeB.startRadius + modeB.startRadiusVar * CCRANDOM_MINUS1_1();
+        }
 
         if (modeB.endRadius == START_RADIUS_EQUAL_TO_END_RADIUS)
         {
-            particle->modeB.deltaRadius = 0;
+            for (int i = start; i < end; ++i)
+            {
+                p.modeB.deltaRadius[i] = 0;
+            }
         }
         else
         {
-            particle->modeB.deltaRadius = (endRadius - startRadius) / particle->timeToLive;
+            for (int i = start; i < end; ++i)
+            {
+                float endRadius = modeB.endRadius + modeB.endRadiusVar * CCRANDOM_MINUS1_1();
+                p.modeB.deltaRadius[i] = (endRadius - p.modeB.radius[i]) / p.timeToLive[i];
+            }
         }
 
-        particle->modeB.angle = a;
-        particle->modeB.degreesPerSecond = CC_DEGREES_TO_RADIANS(modeB.rotatePerSecond + modeB.rotatePerSecondVar * CCRANDOM_MINUS1_1());
-    }    
+        for (int i = start; i < end; ++i)
+        {
+            p.modeB.angle[i] = CC_DEGREES_TO_RADIANS( _angle + _angleVar * CCRANDOM_MINUS1_1() );
+        }
+        for (int i = start; i < end; ++i)
+        {
+            p.modeB.degreesPerSecond[i] = CC_DEGREES_TO_RADIANS(modeB.rotatePerSecond + modeB.rotatePerSecondVar * CCRANDOM_MINUS1_1());
+        }
+    }
+
+    _particleCount = end;
 }
 
 void ParticleSystem::onEnter()
@@ -641,10 +944,9 @@ void ParticleSystem::resetSystem()
 {
     _isActive = true;
     _elapsed = 0;
-    for (_particleIdx = 0; _particleIdx < _particleCount; ++_particleIdx)
+    for (int i = 0; i < _particleCount; ++i)
     {
-        tParticle *p = &_particles[_particleIdx];
-        p->timeToLive = 0;
+        _particleData.timeToLive[i] = 0;
     }
 }
 bool ParticleSystem::isFull()
@@ -657,6 +959,24 @@ void ParticleSystem::update(float dt)
 {
     CC_PROFILER_START_CATEGORY(kProfilerCategoryParticles , "CCParticleSystem - update");
 
+    emitParticles(dt);
+    updateEmitterTransform();
+
+    if (s_parallelUpdateEnabled && _scheduler == Director::getInstance()->getScheduler())
+    {
+        // simulated with the other systems once all the updates of the frame have run
+        ParallelParticleUpdater::getInstance()->add(this, dt);
+    }
+    else
+    {
+        finishUpdate(simulateParticles(dt));
+    }
+
+    CC_PROFILER_STOP_CATEGORY(kProfilerCategoryParticles , "CCParticleSystem - update");
+}
+
+void ParticleSystem::emitParticles(float dt)
+{
     if (_isActive && _emissionRate)
     {
         float rate = 1.0f / _emissionRate;
@@ -666,11 +986,13 @@ void ParticleSystem::update(float dt)
             _emitCounter += dt;
         }
         
-        while (_particleCount < _totalParticles && _emitCounter > rate) 
+        int emitCount = 0;
+        while (_particleCount + emitCount < _totalParticles && _emitCounter > rate)
         {
-            this->addParticle();
+            ++emitCount;
             _emitCounter -= rate;
         }
+        this->addParticles(emitCount);
 
         _elapsed += dt;
         if (_duration != -1 && _duration < _elapsed)
@@ -678,164 +1000,161 @@ void ParticleSystem::update(float dt)
             this->stopSystem();
         }
     }
+}
 
-    _particleIdx = 0;
-
-    Vec2 currentPosition;
+void ParticleSystem::updateEmitterTransform()
+{
+    // Only the translation between the emitter and the particles' start positions
+    // is needed, so the linear part of the world to node transform is enough
     if (_positionType == PositionType::FREE)
     {
-        currentPosition = this->convertToWorldSpace(Vec2::ZERO);
+        _emitterPosition = this->convertToWorldSpace(Vec2::ZERO);
+        const Mat4& worldToNodeTM = getWorldToNodeTransform();
+        _emitterOffsetTransform[0] = worldToNodeTM.m[0];
+        _emitterOffsetTransform[1] = worldToNodeTM.m[4];
+        _emitterOffsetTransform[2] = worldToNodeTM.m[1];
+        _emitterOffsetTransform[3] = worldToNodeTM.m[5];
     }
     else if (_positionType == PositionType::RELATIVE)
     {
-        currentPosition = _position;
+        _emitterPosition = _position;
+        _emitterOffsetTransform[0] = 1;
+        _emitterOffsetTransform[1] = 0;
+        _emitterOffsetTransform[2] = 0;
+        _emitterOffsetTransform[3] = 1;
     }
-
+    else
     {
-        Mat4 worldToNodeTM = getWorldToNodeTransform();
-        
-        while (_particleIdx < _particleCount)
-        {
-            tParticle *p = &_particles[_particleIdx];
-
-            // life
-            p->timeToLive -= dt;
-
-            if (p->timeToLive > 0) 
-            {
-                // Mode A: gravity, direction, tangential accel & radial accel
-                if (_emitterMode == Mode::GRAVITY)
-                {
-                    Vec2 tmp, radial, tangential;
+        _emitterPosition.setZero();
+        memset(_emitterOffsetTransform, 0, sizeof(_emitterOffsetTransform));
+    }
+}
 
-                    // radial acceleration
-                    if (p->pos.x || p->pos.y)
-                    {
-                        radial = p->pos.getNormalized();
-                    }
-                    tangential = radial;
-                    radial = radial * p->modeA.radialAccel;
-
-                    // tangential acceleration
-                    float newy = tangential.x;
-                    tangential.x = -tangential.y;
-                    tangential.y = newy;
-                    tangential = tangential * p->modeA.tangentialAccel;
-
-                    // (gravity + radial + tangential) * dt
-                    tmp = radial + tangential + modeA.gravity;
-                    tmp = tmp * dt;
-                    p->modeA.dir = p->modeA.dir + tmp;
-                    
-                    // this is cocos2d-x v3.0
-//                    if (_configName.length()>0 && _yCoordFlipped != -1)
+bool ParticleSystem::simulateParticles(float dt)
+{
+    ParticleData& p = _particleData;
 
-                    // this is cocos2d-x v3.0
-                    tmp = p->modeA.dir * dt * _yCoordFlipped;
-                    p->pos = p->pos + tmp;
-                }
+    // life
+    for (int i = 0; i < _particleCount; ++i)
+    {
+        p.timeToLive[i] -= dt;
+    }
 
-                // Mode B: radius movement
-                else 
-                {                
-                    // Update the angle and radius of the particle.
-                    p->modeB.angle += p->modeB.degreesPerSecond * dt;
-                    p->modeB.radius += p->modeB.deltaRadius * dt;
+    // remove dead particles by moving the last living one into their slot
+    const bool hadParticles = _particleCount > 0;
+    for (int i = 0; i < _particleCount; )
+    {
+        if (p.timeToLive[i] > 0)
+        {
+            ++i;
+            continue;
+        }
 
-                    p->pos.x = - cosf(p->modeB.angle) * p->modeB.radius;
-                    p->pos.y = - sinf(p->modeB.angle) * p->modeB.radius;
-                    p->pos.y *= _yCoordFlipped;
-				}
+        int currentIndex = p.atlasIndex[i];
+        if( i != _particleCount-1 )
+        {
+            p.copyParticle(i, _particleCount-1);
+        }
+        if (_batchNode)
+        {
+            //disable the switched particle
+            _batchNode->disableParticle(_atlasIndex+currentIndex);
 
-                // color
-                p->color.r += (p->deltaColor.r * dt);
-                p->color.g += (p->deltaColor.g * dt);
-                p->color.b += (p->deltaColor.b * dt);
-                p->color.a += (p->deltaColor.a * dt);
+            //switch indexes
+            p.atlasIndex[_particleCount-1] = currentIndex;
+        }
 
-                // size
-                p->size += (p->deltaSize * dt);
-                p->size = MAX( 0, p->size );
+        --_particleCount;
+    }
 
-                // angle
-                p->rotation += (p->deltaRotation * dt);
+    // Mode A: gravity, direction, tangential accel & radial accel
+    if (_emitterMode == Mode::GRAVITY)
+    {
+        // the radial direction is computed for a block of particles at a time so the
+        // normalize kernel can run vectorized without a heap allocated scratch buffer
+        static const int BLOCK_SIZE = 64;
+        float radialX[BLOCK_SIZE];
+        float radialY[BLOCK_SIZE];
 
-                //
-                // update values in quad
-                //
+        for (int blockStart = 0; blockStart < _particleCount; blockStart += BLOCK_SIZE)
+        {
+            const int blockCount = MIN(BLOCK_SIZE, _particleCount - blockStart);
+            MathUtil::normalizeVec2Array(p.posx + blockStart, p.posy + blockStart, radialX, radialY, blockCount);
+
+            float* dirX = p.modeA.dirX + blockStart;
+            float* dirY = p.modeA.dirY + blockStart;
+            const float* radialAccel = p.modeA.radialAccel + blockStart;
+            const float* tangentialAccel = p.modeA.tangentialAccel + blockStart;
+            for (int i = 0; i < blockCount; ++i)
+            {
+                // (gravity + radial + tangential) * dt, the tangent being the radial direction rotated by 90 degrees
+                dirX[i] += (radialX[i] * radialAccel[i] - radialY[i] * tangentialAccel[i] + modeA.gravity.x) * dt;
+                dirY[i] += (radialY[i] * radialAccel[i] + radialX[i] * tangentialAccel[i] + modeA.gravity.y) * dt;
+            }
+        }
 
-                Vec2    newPos;
+        // this is cocos2d-x v3.0
+        MathUtil::addScaledArray(p.posx, p.modeA.dirX, dt * _yCoordFlipped, _particleCount);
+        MathUtil::addScaledArray(p.posy, p.modeA.dirY, dt * _yCoordFlipped, _particleCount);
+    }
 
-                if (_positionType == PositionType::FREE)
-                {
-                    Vec3 p1(currentPosition.x,currentPosition.y,0),p2(p->startPos.x,p->startPos.y,0);
-                    worldToNodeTM.transformPoint(&p1);
-                    worldToNodeTM.transformPoint(&p2);
-                    p1 = p1 - p2;
-                    newPos = p->pos - Vec2(p1.x,p1.y);
-                }
-                else if(_positionType == PositionType::RELATIVE)
-                {
-                    Vec2 diff = currentPosition - p->startPos;
-                    newPos = p->pos - diff;
-                } 
-                else
-                {
-                    newPos = p->pos;
-                }
+    // Mode B: radius movement
+    else
+    {
+        // Update the angle and radius of the particle.
+        MathUtil::addScaledArray(p.modeB.angle, p.modeB.degreesPerSecond, dt, _particleCount);
+        MathUtil::addScaledArray(p.modeB.radius, p.modeB.deltaRadius, dt, _particleCount);
 
-                // translate newPos to correct position, since matrix transform isn't performed in batchnode
-                // don't update the particle with the new position information, it will interfere with the radius and tangential calculations
-                if (_batchNode)
-                {
-                    newPos.x+=_position.x;
-                    newPos.y+=_position.y;
-                }
+        for (int i = 0; i < _particleCount; ++i)
+        {
+            p.posx[i] = - cosf(p.modeB.angle[i]) * p.modeB.radius[i];
+            p.posy[i] = - sinf(p.modeB.angle[i]) * p.modeB.radius[i] * _yCoordFlipped;
+        }
+    }
 
-                updateQuadWithParticle(p, newPos);
-                //updateParticleImp(self, updateParticleSel, p, newPos);
+    // color
+    MathUtil::addScaledArray(p.colorR, p.deltaColorR, dt, _particleCount);
+    MathUtil::addScaledArray(p.colorG, p.deltaColorG, dt, _particleCount);
+    MathUtil::addScaledArray(p.colorB, p.deltaColorB, dt, _particleCount);
+    MathUtil::addScaledArray(p.colorA, p.deltaColorA, dt, _particleCount);
 
-                // update particle counter
-                ++_particleIdx;
-            } 
-            else 
-            {
-                // life < 0
-                int currentIndex = p->atlasIndex;
-                if( _particleIdx != _particleCount-1 )
-                {
-                    _particles[_particleIdx] = _particles[_particleCount-1];
-                }
-                if (_batchNode)
-                {
-                    //disable the switched particle
-                    _batchNode->disableParticle(_atlasIndex+currentIndex);
+    // size
+    MathUtil::addScaledArray(p.size, p.deltaSize, dt, _particleCount);
+    for (int i = 0; i < _particleCount; ++i)
+    {
+        p.size[i] = MAX( 0, p.size[i] );
+    }
 
-                    //switch indexes
-                    _particles[_particleCount-1].atlasIndex = currentIndex;
-                }
+    // angle
+    MathUtil::addScaledArray(p.rotation, p.deltaRotation, dt, _particleCount);
 
+    //
+    // update values in quads
+    //
+    _particleIdx = _particleCount;
+    updateParticleQuads();
+    _transformSystemDirty = false;
 
-                --_particleCount;
+    return hadParticles && _particleCount == 0;
+}
 
-                if( _particleCount == 0 && _isAutoRemoveOnFinish )
-                {
-                    this->unscheduleUpdate();
-                    _parent->removeChild(this, true);
-                    return;
-                }
-            }
-        } //while
-        _transformSystemDirty = false;
+void ParticleSystem::finishUpdate(bool lastParticleDied)
+{
+    if( lastParticleDied && _isAutoRemoveOnFinish )
+    {
+        this->unscheduleUpdate();
+        if (_parent)
+        {
+            _parent->removeChild(this, true);
+        }
+        return;
     }
-    
+
     // only update gl buffer when visible
     if (_visible && ! _batchNode)
     {
         postStep();
     }
-
-    CC_PROFILER_STOP_CATEGORY(kProfilerCategoryParticles , "CCParticleSystem - update");
 }
 
 void ParticleSystem::updateWithNoTime(void)
@@ -843,10 +1162,8 @@ void ParticleSystem::updateWithNoTime(void)
     this->update(0.0f);
 }
 
-void ParticleSystem::updateQuadWithParticle(tParticle* particle, const Vec2& newPosition)
+void ParticleSystem::updateParticleQuads()
 {
-    CC_UNUSED_PARAM(particle);
-    CC_UNUSED_PARAM(newPosition);
     // should be overridden
 }
 
@@ -1144,7 +1461,7 @@ void ParticleSystem::setBatchNode(ParticleBatchNode* batchNode)
             //each particle needs a unique index
             for (int i = 0; i < _totalParticles; i++)
             {
-                _particles[i].atlasIndex=i;
+                _particleData.atlasIndex[i] = i;
             }
         }
     }
@@ -39,49 +39,70 @@ NS_CC_BEGIN
  */
 
 class ParticleBatchNode;
+class ParallelParticleUpdater;
 
-/** @struct sParticle
-Structure that contains the values of each particle.
-*/
-typedef struct sParticle {
-    Vec2     pos;
-    Vec2     startPos;
-
-    Color4F    color;
-    Color4F    deltaColor;
-
-    float        size;
-    float        deltaSize;
-
-    float        rotation;
-    float        deltaRotation;
+/** @class ParticleData
+ * @brief Structure of arrays that holds the values of every particle of a ParticleSystem.
+ * Each attribute is stored in its own contiguous array, indexed by particle, so that
+ * the update loops can process one attribute for all particles at a time.
+ */
+class CC_DLL ParticleData
+{
+public:
+    float* posx;
+    float* posy;
+    float* startPosX;
+    float* startPosY;
+
+    float* colorR;
+    float* colorG;
+    float* colorB;
+    float* colorA;
+
+    float* deltaColorR;
+    float* deltaColorG;
+    float* deltaColorB;
+    float* deltaColorA;
+
+    float* size;
+    float* deltaSize;
+    float* rotation;
+    float* deltaRotation;
+    float* timeToLive;
+    unsigned int* atlasIndex;
+
+    //! Mode A: gravity, direction, radial accel, tangential accel
+    struct{
+        float* dirX;
+        float* dirY;
+        float* radialAccel;
+        float* tangentialAccel;
+    } modeA;
 
-    float        timeToLive;
+    //! Mode B: radius mode
+    struct{
+        float* angle;
+        float* degreesPerSecond;
+        float* radius;
+        float* deltaRadius;
+    } modeB;
 
-    unsigned int    atlasIndex;
+    unsigned int maxCount;
 
-    /** @struct modeA
-     Mode A: gravity, direction, radial accel, tangential accel.
-     */
-    struct {
-        Vec2        dir;
-        float        radialAccel;
-        float        tangentialAccel;
-    } modeA;
+    ParticleData();
+    /** Allocates zeroed storage for the given number of particles, releasing any previous storage. */
+    bool init(int count);
+    void release();
+    unsigned int getMaxCount() const { return maxCount; }
 
-    /** @struct modeB
-     Mode B: radius mode.
-     */
-    struct {
-        float        angle;
-        float        degreesPerSecond;
-        float        radius;
-        float        deltaRadius;
-    } modeB;
+    /** Copies every attribute of particle p2 into particle p1. */
+    void copyParticle(int p1, int p2);
 
-}tParticle;
+private:
+    // all attribute arrays are slices of this single allocation
+    void* _buffer;
+};
 
-//typedef void (*CC_UPDATE_PARTICLE_IMP)(id, SEL, tParticle*, Vec2);
 
 class Texture2D;
 
@@ -199,11 +220,12 @@ public:
      * @js ctor
      */
     bool addParticle();
-    /** Initializes a particle.
-     * 
-     * @param particle A given particle pointer.
+    /** Add several particles to the emitter at once.
+     * The new particles are initialized attribute by attribute.
+     *
+     * @param count The number of particles to add, clamped to the free space in the system.
      */
-    void initParticle(tParticle* particle);
+    void addParticles(int count);
     /** Stop emitting particles. Running particles will continue to run until they die.
      */
     void stopSystem();
@@ -216,13 +238,10 @@ public:
      */
     bool isFull();
 
-    /** Update the verts position data of particle,
-     should be overridden by subclasses. 
-     *
-     * @param particle A certain particle.
-     * @param newPosition A new position.
+    /** Update the verts data of all living particles in one pass,
+     should be overridden by subclasses.
      */
-    virtual void updateQuadWithParticle(tParticle* particle, const Vec2& newPosition);
+    virtual void updateParticleQuads();
     /** Update the VBO verts buffer which does not use batch node,
      should be overridden by subclasses. */
     virtual void postStep();
@@ -231,6 +250,21 @@ public:
      */
     virtual void updateWithNoTime();
 
+    /** Enables or disables the parallel update of particle systems. Disabled by default.
+     When it is enabled, update() only emits the new particles of a system. The particles of all the
+     systems updated by the Director's scheduler are then moved and turned into quads together on worker
+     threads, once every scheduled update of the frame has run, and the work is joined before the scene
+     is drawn. Systems sharing a ParticleBatchNode are simulated one after the other, in atlas order.
+     *
+     * @param enabled True to update the particle systems in parallel.
+     */
+    static void setParallelUpdateEnabled(bool enabled);
+    /** Whether or not the particle systems are updated in parallel.
+     *
+     * @return True if the particle systems are updated in parallel.
+     */
+    static bool isParallelUpdateEnabled();
+
     /** Whether or not the particle system removed self on finish.
      *
      * @return True if the particle system removed self on finish.
@@ -753,6 +787,21 @@ CC_CONSTRUCTOR_ACCESS:
 protected:
     virtual void updateBlendFunc();
 
+    /** Emits the particles due for this update. Must be called in the cocos thread. */
+    void emitParticles(float dt);
+    /** Samples the emitter position and transform used by updateParticleQuads. Must be called in the cocos thread. */
+    void updateEmitterTransform();
+    /** Moves the living particles, removes the dead ones and updates the quads.
+     Only touches this system's own data, so different systems can be simulated on different threads.
+     *
+     * @return True if the last living particle died in this step.
+     */
+    bool simulateParticles(float dt);
+    /** Removes the system if it has finished, otherwise uploads its quads. Must be called in the cocos thread. */
+    void finishUpdate(bool lastParticleDied);
+
+    friend class ParallelParticleUpdater;
+
     /** whether or not the particles are using blend additive.
      If enabled, the following blending function will be used.
      @code
@@ -809,8 +858,8 @@ protected:
         float rotatePerSecondVar;
     } modeB;
 
-    //! Array of particles
-    tParticle *_particles;
+    //! Particle storage, one array per attribute
+    ParticleData _particleData;
 
     //Emitter name
     std::string _configName;
@@ -824,6 +873,13 @@ protected:
     //!  particle idx
     int _particleIdx;
 
+    //! emitter position sampled by updateEmitterTransform, in the space of the particles' start positions
+    Vec2 _emitterPosition;
+    //! linear part of the transform applied to the offset between the emitter and a particle's start position
+    float _emitterOffsetTransform[4];
+    //! index in the pending parallel update list, -1 if the system isn't waiting for one
+    int _parallelUpdateIndex;
+
     // Optimization
     //CC_UPDATE_PARTICLE_IMP    updateParticleImp;
     //SEL                        updateParticleSel;
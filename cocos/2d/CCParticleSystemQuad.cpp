@@ -263,87 +263,109 @@ void ParticleSystemQuad::initIndices()
     }
 }
 
-void ParticleSystemQuad::updateQuadWithParticle(tParticle* particle, const Vec2& newPosition)
+void ParticleSystemQuad::updateParticleQuads()
 {
-    V3F_C4B_T2F_Quad *quad;
-
-    if (_batchNode)
+    if (_particleCount <= 0)
     {
-        V3F_C4B_T2F_Quad *batchQuads = _batchNode->getTextureAtlas()->getQuads();
-        quad = &(batchQuads[_atlasIndex+particle->atlasIndex]);
+        return;
     }
-    else
+
+    const ParticleData& p = _particleData;
+
+    // sampled in the cocos thread, this pass may run on a worker thread
+    const Vec2 currentPosition = _emitterPosition;
+    const float offsetScaleXX = _emitterOffsetTransform[0];
+    const float offsetScaleXY = _emitterOffsetTransform[1];
+    const float offsetScaleYX = _emitterOffsetTransform[2];
+    const float offsetScaleYY = _emitterOffsetTransform[3];
+
+    // translate newPos to correct position, since matrix transform isn't performed in batchnode
+    // don't update the particle with the new position information, it will interfere with the radius and tangential calculations
+    Vec2 batchOffset;
+    V3F_C4B_T2F_Quad* quads = _quads;
+    if (_batchNode)
     {
-        quad = &(_quads[_particleIdx]);
+        batchOffset = _position;
+        quads = _batchNode->getTextureAtlas()->getQuads() + _atlasIndex;
     }
-    Color4B color = (_opacityModifyRGB)
-        ? Color4B( particle->color.r*particle->color.a*255, particle->color.g*particle->color.a*255, particle->color.b*particle->color.a*255, particle->color.a*255)
-        : Color4B( particle->color.r*255, particle->color.g*255, particle->color.b*255, particle->color.a*255);
-
-    quad->bl.colors = color;
-    quad->br.colors = color;
-    quad->tl.colors = color;
-    quad->tr.colors = color;
 
-    // vertices
-    GLfloat size_2 = particle->size/2;
-    if (particle->rotation) 
+    for (int i = 0; i < _particleCount; ++i)
     {
-        GLfloat x1 = -size_2;
-        GLfloat y1 = -size_2;
-
-        GLfloat x2 = size_2;
-        GLfloat y2 = size_2;
-        GLfloat x = newPosition.x;
-        GLfloat y = newPosition.y;
-
-        GLfloat r = (GLfloat)-CC_DEGREES_TO_RADIANS(particle->rotation);
-        GLfloat cr = cosf(r);
-        GLfloat sr = sinf(r);
-        GLfloat ax = x1 * cr - y1 * sr + x;
-        GLfloat ay = x1 * sr + y1 * cr + y;
-        GLfloat bx = x2 * cr - y1 * sr + x;
-        GLfloat by = x2 * sr + y1 * cr + y;
-        GLfloat cx = x2 * cr - y2 * sr + x;
-        GLfloat cy = x2 * sr + y2 * cr + y;
-        GLfloat dx = x1 * cr - y2 * sr + x;
-        GLfloat dy = x1 * sr + y2 * cr + y;
-
-        // bottom-left
-        quad->bl.vertices.x = ax;
-        quad->bl.vertices.y = ay;
+        V3F_C4B_T2F_Quad* quad = _batchNode ? &quads[p.atlasIndex[i]] : &quads[i];
 
-        // bottom-right vertex:
-        quad->br.vertices.x = bx;
-        quad->br.vertices.y = by;
+        float diffX = currentPosition.x - p.startPosX[i];
+        float diffY = currentPosition.y - p.startPosY[i];
+        GLfloat x = p.posx[i] - (offsetScaleXX * diffX + offsetScaleXY * diffY) + batchOffset.x;
+        GLfloat y = p.posy[i] - (offsetScaleYX * diffX + offsetScaleYY * diffY) + batchOffset.y;
 
-        // top-left vertex:
-        quad->tl.vertices.x = dx;
-        quad->tl.vertices.y = dy;
+        float alpha = p.colorA[i];
+        float rgbScale = _opacityModifyRGB ? alpha : 1.0f;
+        Color4B color(p.colorR[i] * rgbScale * 255, p.colorG[i] * rgbScale * 255, p.colorB[i] * rgbScale * 255, alpha * 255);
 
-        // top-right vertex:
-        quad->tr.vertices.x = cx;
-        quad->tr.vertices.y = cy;
-    } 
-    else 
-    {
-        // bottom-left vertex:
-        quad->bl.vertices.x = newPosition.x - size_2;
-        quad->bl.vertices.y = newPosition.y - size_2;
+        quad->bl.colors = color;
+        quad->br.colors = color;
+        quad->tl.colors = color;
+        quad->tr.colors = color;
 
-        // bottom-right vertex:
-        quad->br.vertices.x = newPosition.x + size_2;
-        quad->br.vertices.y = newPosition.y - size_2;
+        // vertices
+        GLfloat size_2 = p.size[i]/2;
+        if (p.rotation[i])
+        {
+            GLfloat x1 = -size_2;
+            GLfloat y1 = -size_2;
+
+            GLfloat x2 = size_2;
+            GLfloat y2 = size_2;
+
+            GLfloat r = (GLfloat)-CC_DEGREES_TO_RADIANS(p.rotation[i]);
+            GLfloat cr = cosf(r);
+            GLfloat sr = sinf(r);
+            GLfloat ax = x1 * cr - y1 * sr + x;
+            GLfloat ay = x1 * sr + y1 * cr + y;
+            GLfloat bx = x2 * cr - y1 * sr + x;
+            GLfloat by = x2 * sr + y1 * cr + y;
+            GLfloat cx = x2 * cr - y2 * sr + x;
+            GLfloat cy = x2 * sr + y2 * cr + y;
+            GLfloat dx = x1 * cr - y2 * sr + x;
+            GLfloat dy = x1 * sr + y2 * cr + y;
+
+            // bottom-left
+            quad->bl.vertices.x = ax;
+            quad->bl.vertices.y = ay;
+
+            // bottom-right vertex:
+            quad->br.vertices.x = bx;
+            quad->br.vertices.y = by;
+
+            // top-left vertex:
+            quad->tl.vertices.x = dx;
+            quad->tl.vertices.y = dy;
+
+            // top-right vertex:
+            quad->tr.vertices.x = cx;
+            quad->tr.vertices.y = cy;
+        }
+        else
+        {
+            // bottom-left vertex:
+            quad->bl.vertices.x = x - size_2;
+            quad->bl.vertices.y = y - size_2;
 
-        // top-left vertex:
-        quad->tl.vertices.x = newPosition.x - size_2;
-        quad->tl.vertices.y = newPosition.y + size_2;
+            // bottom-right vertex:
+            quad->br.vertices.x = x + size_2;
+            quad->br.vertices.y = y - size_2;
 
-        // top-right vertex:
-        quad->tr.vertices.x = newPosition.x + size_2;
-        quad->tr.vertices.y = newPosition.y + size_2;                
+            // top-left vertex:
+            quad->tl.vertices.x = x - size_2;
+            quad->tl.vertices.y = y + size_2;
+
+            // top-right vertex:
+            quad->tr.vertices.x = x + size_2;
+            quad->tr.vertices.y = y + size_2;
+        }
     }
 }
+
 void ParticleSystemQuad::postStep()
 {
     glBindBuffer(GL_ARRAY_BUFFER, _buffersVBO[0]);
@@ -384,23 +406,21 @@ void ParticleSystemQuad::setTotalParticles(int tp)
     if( tp > _allocatedParticles )
     {
         // Allocate new memory
-        size_t particlesSize = tp * sizeof(tParticle);
         size_t quadsSize = sizeof(_quads[0]) * tp * 1;
         size_t indicesSize = sizeof(_indices[0]) * tp * 6 * 1;
 
-        tParticle* particlesNew = (tParticle*)realloc(_particles, particlesSize);
+        // ParticleData::init releases the previous storage and returns it zeroed
+        bool particlesOk = _particleData.init(tp);
         V3F_C4B_T2F_Quad* quadsNew = (V3F_C4B_T2F_Quad*)realloc(_quads, quadsSize);
         GLushort* indicesNew = (GLushort*)realloc(_indices, indicesSize);
 
-        if (particlesNew && quadsNew && indicesNew)
+        if (particlesOk && quadsNew && indicesNew)
         {
             // Assign pointers
-            _particles = particlesNew;
             _quads = quadsNew;
             _indices = indicesNew;
 
             // Clear the memory
-            memset(_particles, 0, particlesSize);
             memset(_quads, 0, quadsSize);
             memset(_indices, 0, indicesSize);
             
@@ -409,7 +429,6 @@ void ParticleSystemQuad::setTotalParticles(int tp)
         else
         {
             // Out of memory, failed to resize some array
-            if (particlesNew) _particles = particlesNew;
             if (quadsNew) _quads = quadsNew;
             if (indicesNew) _indices = indicesNew;
 
@@ -424,7 +443,7 @@ void ParticleSystemQuad::setTotalParticles(int tp)
         {
             for (int i = 0; i < _totalParticles; i++)
             {
-                _particles[i].atlasIndex=i;
+                _particleData.atlasIndex[i] = i;
             }
         }
 
@@ -29,6 +29,7 @@ THE SOFTWARE.
 
 #include "base/ccMacros.h"
 #include "base/CCDirector.h"
+#include "base/CCFrameArena.h"
 #include "2d/CCSprite.h"
 #include "renderer/ccGLStateCache.h"
 #include "renderer/CCRenderer.h"
@@ -538,7 +539,7 @@ void ProgressTimer::draw(Renderer *renderer, const Mat4 &transform, uint32_t fla
         return;
 
     _customCommand.init(_globalZOrder, transform, flags);
-    _customCommand.func = CC_CALLBACK_0(ProgressTimer::onDraw, this, transform, flags);
+    _customCommand.func = _director->getFrameArena()->makeCallback(CC_CALLBACK_0(ProgressTimer::onDraw, this, transform, flags));
     renderer->addCommand(&_customCommand);
 }
 
@@ -37,6 +37,7 @@ THE SOFTWARE.
 #include "renderer/CCTexture2D.h"
 #include "renderer/CCRenderer.h"
 #include "base/CCDirector.h"
+#include "base/allocator/CCAllocatorStrategySlab.h"
 
 #include "deprecated/CCString.h"
 
@@ -49,6 +50,8 @@ NS_CC_BEGIN
 #define RENDER_IN_SUBPIXEL(__ARGS__) (ceil(__ARGS__))
 #endif
 
+CC_IMPLEMENT_ALLOCATOR_SLAB(Sprite)
+
 // MARK: create, init, dealloc
 Sprite* Sprite::createWithTexture(Texture2D *texture)
 {
@@ -702,7 +705,7 @@ void Sprite::sortAllChildren()
 {
     if (_reorderChildDirty)
     {
-        std::sort(std::begin(_children), std::end(_children), nodeComparisonLess);
+        sortChildrenByLocalZOrder();
 
         if ( _batchNode)
         {
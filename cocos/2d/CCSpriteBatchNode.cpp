@@ -32,6 +32,7 @@ THE SOFTWARE.
 #include "renderer/CCTextureCache.h"
 #include "renderer/CCRenderer.h"
 #include "renderer/CCQuadCommand.h"
+#include "base/CCProfiling.h"
 
 #include "deprecated/CCString.h" // For StringUtils::format
 
@@ -245,7 +246,7 @@ void SpriteBatchNode::sortAllChildren()
 {
     if (_reorderChildDirty)
     {
-        std::sort(std::begin(_children), std::end(_children), nodeComparisonLess);
+        sortChildrenByLocalZOrder();
 
         //sorted now check all children
         if (!_children.empty())
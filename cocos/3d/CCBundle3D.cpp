@@ -1007,7 +1007,7 @@ bool Bundle3D::loadJson(const std::string& path)
 {
     clear();
 
-    Data data = FileUtils::getInstance()->getDataFromFile(path);
+    MappedData data = FileUtils::getInstance()->getMappedDataFromFile(path);
     ssize_t size = data.getSize();
 
     // json need null-terminated string.
@@ -1037,8 +1037,8 @@ bool Bundle3D::loadBinary(const std::string& path)
     
     // get file data
     CC_SAFE_DELETE(_binaryBuffer);
-    _binaryBuffer = new (std::nothrow) Data();
-    *_binaryBuffer = FileUtils::getInstance()->getDataFromFile(path);
+    _binaryBuffer = new (std::nothrow) MappedData();
+    *_binaryBuffer = FileUtils::getInstance()->getMappedDataFromFile(path, MappedData::Access::NORMAL);
     if (_binaryBuffer->isNull())
     {
         clear();
@@ -37,7 +37,7 @@ NS_CC_BEGIN
  */
 
 class Animation3D;
-class Data;
+class MappedData;
 
 /**
  * @brief Defines a bundle file that contains a collection of assets. Mesh, Material, MeshSkin, Animation
@@ -175,7 +175,7 @@ protected:
     rapidjson::Document _jsonReader;
 
     // for binary reading
-    Data* _binaryBuffer;
+    MappedData* _binaryBuffer;
     BundleReader _binaryReader;
     unsigned int _referenceCount;
     Reference* _references;
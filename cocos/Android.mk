@@ -127,7 +127,9 @@ base/CCEventListenerMouse.cpp \
 base/CCEventListenerTouch.cpp \
 base/CCEventMouse.cpp \
 base/CCEventTouch.cpp \
+base/CCFrameArena.cpp \
 base/CCIMEDispatcher.cpp \
+base/CCMappedData.cpp \
 base/CCNS.cpp \
 base/CCProfiling.cpp \
 base/ccRandom.cpp \
@@ -135,6 +137,7 @@ base/CCRef.cpp \
 base/CCScheduler.cpp \
 base/CCScriptSupport.cpp \
 base/CCTouch.cpp \
+base/CCTouchSpatialIndex.cpp \
 base/CCUserDefault.cpp \
 base/CCUserDefault-android.cpp \
 base/CCValue.cpp \
@@ -163,10 +166,13 @@ renderer/CCGLProgramCache.cpp \
 renderer/CCGLProgramState.cpp \
 renderer/CCGLProgramStateCache.cpp \
 renderer/CCGroupCommand.cpp \
+renderer/CCMaterialIDCache.cpp \
 renderer/CCQuadCommand.cpp \
 renderer/CCMeshCommand.cpp \
 renderer/CCRenderCommand.cpp \
 renderer/CCRenderer.cpp \
+renderer/CCRenderWorkerPool.cpp \
+renderer/CCStreamingVertexBuffer.cpp \
 renderer/CCTexture2D.cpp \
 renderer/CCTextureAtlas.cpp \
 renderer/CCTextureCache.cpp \
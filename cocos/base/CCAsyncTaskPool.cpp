@@ -24,9 +24,154 @@ THE SOFTWARE.
 ****************************************************************************/
 
 #include "base/CCAsyncTaskPool.h"
+#include "base/CCProfiling.h"
+
+#include <algorithm>
 
 NS_CC_BEGIN
 
+// A worker thread with a work stealing deque (Chase-Lev): the owner pushes and pops ready
+// tasks at the bottom without locking, idle workers steal the oldest ones from the top.
+class AsyncTaskPool::Worker
+{
+public:
+    explicit Worker(int index)
+    : _index(index)
+    , _top(0)
+    , _bottom(0)
+    , _ring(new Ring(64))
+    {
+    }
+
+    ~Worker()
+    {
+        delete _ring.load();
+        for (auto ring : _retiredRings)
+        {
+            delete ring;
+        }
+    }
+
+    int getIndex() const { return _index; }
+
+    void start(AsyncTaskPool* pool)
+    {
+        _thread = std::thread(&AsyncTaskPool::run, pool, this);
+    }
+
+    void join()
+    {
+        if (_thread.joinable())
+            _thread.join();
+    }
+
+    // only called from the worker's thread
+    void push(Task* task)
+    {
+        int64_t b = _bottom.load(std::memory_order_relaxed);
+        int64_t t = _top.load(std::memory_order_acquire);
+        Ring* ring = _ring.load(std::memory_order_relaxed);
+        if (b - t > ring->capacity - 1)
+        {
+            ring = grow(ring, t, b);
+        }
+        ring->put(b, task);
+        std::atomic_thread_fence(std::memory_order_release);
+        _bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    // only called from the worker's thread, returns the most recently pushed task
+    Task* pop()
+    {
+        int64_t b = _bottom.load(std::memory_order_relaxed) - 1;
+        Ring* ring = _ring.load(std::memory_order_relaxed);
+        _bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = _top.load(std::memory_order_relaxed);
+
+        Task* task = nullptr;
+        if (t <= b)
+        {
+            task = ring->get(b);
+            if (t == b)
+            {
+                // the last task, thieves may be after it too
+                if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                {
+                    task = nullptr;
+                }
+                _bottom.store(b + 1, std::memory_order_relaxed);
+            }
+        }
+        else
+        {
+            _bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return task;
+    }
+
+    // called from the other workers, returns the oldest task or nullptr if empty or lost a race
+    Task* steal()
+    {
+        int64_t t = _top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = _bottom.load(std::memory_order_acquire);
+
+        if (t < b)
+        {
+            Ring* ring = _ring.load(std::memory_order_acquire);
+            Task* task = ring->get(t);
+            if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            {
+                return nullptr;
+            }
+            return task;
+        }
+        return nullptr;
+    }
+
+private:
+    struct Ring
+    {
+        explicit Ring(int64_t size)
+        : capacity(size)
+        , slots(new std::atomic<Task*>[size])
+        {
+        }
+
+        ~Ring()
+        {
+            delete [] slots;
+        }
+
+        Task* get(int64_t i) const { return slots[i & (capacity - 1)].load(std::memory_order_relaxed); }
+        void put(int64_t i, Task* task) { slots[i & (capacity - 1)].store(task, std::memory_order_relaxed); }
+
+        int64_t capacity;
+        std::atomic<Task*>* slots;
+    };
+
+    Ring* grow(Ring* ring, int64_t top, int64_t bottom)
+    {
+        Ring* bigger = new Ring(ring->capacity * 2);
+        for (int64_t i = top; i < bottom; ++i)
+        {
+            bigger->put(i, ring->get(i));
+        }
+        // thieves may still be reading the old ring, it is freed with the worker
+        _retiredRings.push_back(ring);
+        _ring.store(bigger, std::memory_order_release);
+        return bigger;
+    }
+
+    int _index;
+    std::thread _thread;
+    std::atomic<int64_t> _top;
+    std::atomic<int64_t> _bottom;
+    std::atomic<Ring*> _ring;
+    std::vector<Ring*> _retiredRings;
+};
+
 AsyncTaskPool* AsyncTaskPool::s_asyncTaskPool = nullptr;
 
 AsyncTaskPool* AsyncTaskPool::getInstance()
@@ -45,11 +190,293 @@ void AsyncTaskPool::destoryInstance()
 }
 
 AsyncTaskPool::AsyncTaskPool()
+: _queuedCount(0)
+, _nextTaskID(1)
+, _readyCount(0)
+, _sleepingCount(0)
+, _stop(false)
 {
+    for (auto& generation : _generations)
+    {
+        generation = 0;
+    }
+
+    // the main thread keeps a core, but every type gets a worker preferring it
+    int count = std::max((int)std::thread::hardware_concurrency() - 1, (int)TaskType::TASK_MAX_TYPE);
+    for (int i = 0; i < count; ++i)
+    {
+        _workers.push_back(new Worker(i));
+    }
+    // start the threads once _workers is complete, they read it to steal
+    for (auto worker : _workers)
+    {
+        worker->start(this);
+    }
 }
 
 AsyncTaskPool::~AsyncTaskPool()
 {
+    // let the tasks enqueued so far run, including the ones waiting for dependencies
+    {
+        std::unique_lock<std::mutex> lock(_tasksMutex);
+        _drainedCondition.wait(lock, [this]{ return _tasks.empty(); });
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_sleepMutex);
+        _stop = true;
+    }
+    _sleepCondition.notify_all();
+
+    for (auto worker : _workers)
+    {
+        worker->join();
+        delete worker;
+    }
+    _workers.clear();
+
+    // the pending dispatch finds no pool anymore, hand the callbacks over directly
+    std::vector<AsyncTaskCallBack> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(_callbacksMutex);
+        callbacks.swap(_finishedCallbacks);
+    }
+    if (!callbacks.empty())
+    {
+        Director::getInstance()->getScheduler()->performFunctionInCocosThread([callbacks]{
+            for (auto& callback : callbacks)
+            {
+                callback.callback(callback.callbackParam);
+            }
+        });
+    }
+}
+
+void AsyncTaskPool::stopTasks(TaskType type)
+{
+    // queued tasks are dropped now, the ones already handed to workers when they are picked
+    ++_generations[(int)type];
+
+    std::deque<Task*> dropped;
+    {
+        std::lock_guard<std::mutex> lock(_queueMutex);
+        dropped.swap(_queues[(int)type]);
+        _queuedCount -= (int)dropped.size();
+    }
+    _readyCount -= (int)dropped.size();
+
+    for (auto task : dropped)
+    {
+        finishTask(task, true, nullptr);
+    }
+}
+
+AsyncTaskPool::TaskID AsyncTaskPool::enqueueTask(TaskType type, const TaskCallBack& callback, void* callbackParam, std::function<void()>&& f, const std::vector<TaskID>* dependencies)
+{
+    // don't allow enqueueing after stopping the pool
+    if (_stop)
+    {
+        CC_ASSERT(0 && "already stop");
+        return 0;
+    }
+
+    Task* task = new Task();
+    const TaskID id = _nextTaskID++;
+    task->id = id;
+    task->type = type;
+    task->generation = _generations[(int)type];
+    task->function = std::move(f);
+    task->callback = callback;
+    task->callbackParam = callbackParam;
+    task->pendingDependencies = 0;
+    task->stopped = false;
+
+    bool ready;
+    {
+        std::lock_guard<std::mutex> lock(_tasksMutex);
+        _tasks[id] = task;
+
+        if (dependencies)
+        {
+            for (auto dependency : *dependencies)
+            {
+                // finished tasks are no longer registered
+                auto iter = _tasks.find(dependency);
+                if (iter != _tasks.end() && iter->second != task)
+                {
+                    iter->second->dependents.push_back(task);
+                    ++task->pendingDependencies;
+                }
+            }
+        }
+        // once unlocked, the last dependency to finish schedules the task
+        ready = task->pendingDependencies == 0;
+    }
+
+    // the task may be finished and deleted as soon as it is scheduled
+    if (ready)
+    {
+        schedule(task, nullptr);
+    }
+    return id;
+}
+
+void AsyncTaskPool::schedule(Task* task, Worker* worker)
+{
+    if (worker)
+    {
+        // released by a task that just finished on this worker, keep it local
+        worker->push(task);
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock(_queueMutex);
+        _queues[(int)task->type].push_back(task);
+        ++_queuedCount;
+    }
+
+    ++_readyCount;
+    if (_sleepingCount > 0)
+    {
+        std::lock_guard<std::mutex> lock(_sleepMutex);
+        _sleepCondition.notify_one();
+    }
+}
+
+AsyncTaskPool::Task* AsyncTaskPool::findTask(Worker* worker)
+{
+    Task* task = worker->pop();
+
+    if (!task && _queuedCount > 0)
+    {
+        std::lock_guard<std::mutex> lock(_queueMutex);
+        const int typeCount = (int)TaskType::TASK_MAX_TYPE;
+        for (int i = 0; i < typeCount; ++i)
+        {
+            // start with the type this worker prefers
+            auto& queue = _queues[(worker->getIndex() + i) % typeCount];
+            if (!queue.empty())
+            {
+                task = queue.front();
+                queue.pop_front();
+                --_queuedCount;
+                break;
+            }
+        }
+    }
+
+    if (!task)
+    {
+        const int workerCount = (int)_workers.size();
+        for (int i = 1; i < workerCount && !task; ++i)
+        {
+            task = _workers[(worker->getIndex() + i) % workerCount]->steal();
+        }
+    }
+
+    if (task)
+    {
+        --_readyCount;
+    }
+    return task;
+}
+
+void AsyncTaskPool::run(Worker* worker)
+{
+    while (!_stop)
+    {
+        Task* task = findTask(worker);
+        if (task)
+        {
+            bool stopped = task->generation != _generations[(int)task->type];
+            if (!stopped)
+            {
+                CC_PROFILER_SCOPE("AsyncTaskPool - task");
+                task->function();
+            }
+            finishTask(task, stopped, worker);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(_sleepMutex);
+        ++_sleepingCount;
+        _sleepCondition.wait(lock, [this]{ return _stop || _readyCount > 0; });
+        --_sleepingCount;
+    }
+}
+
+void AsyncTaskPool::finishTask(Task* task, bool stopped, Worker* worker)
+{
+    std::vector<Task*> ready;
+    {
+        std::lock_guard<std::mutex> lock(_tasksMutex);
+        _tasks.erase(task->id);
+        if (_tasks.empty())
+        {
+            _drainedCondition.notify_all();
+        }
+        for (auto dependent : task->dependents)
+        {
+            if (stopped)
+            {
+                dependent->stopped = true;
+            }
+            if (--dependent->pendingDependencies == 0)
+            {
+                ready.push_back(dependent);
+            }
+        }
+    }
+
+    if (!stopped && task->callback)
+    {
+        bool first;
+        {
+            std::lock_guard<std::mutex> lock(_callbacksMutex);
+            first = _finishedCallbacks.empty();
+            AsyncTaskCallBack taskCallBack;
+            taskCallBack.callback = std::move(task->callback);
+            taskCallBack.callbackParam = task->callbackParam;
+            _finishedCallbacks.push_back(std::move(taskCallBack));
+        }
+        // one call in the cocos thread delivers every callback queued until it runs
+        if (first)
+        {
+            Director::getInstance()->getScheduler()->performFunctionInCocosThread([]{
+                if (s_asyncTaskPool)
+                {
+                    s_asyncTaskPool->dispatchCallbacks();
+                }
+            });
+        }
+    }
+    delete task;
+
+    for (auto dependent : ready)
+    {
+        if (dependent->stopped)
+        {
+            finishTask(dependent, true, worker);
+        }
+        else
+        {
+            schedule(dependent, worker);
+        }
+    }
+}
+
+void AsyncTaskPool::dispatchCallbacks()
+{
+    std::vector<AsyncTaskCallBack> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(_callbacksMutex);
+        callbacks.swap(_finishedCallbacks);
+    }
+
+    for (auto& callback : callbacks)
+    {
+        callback.callback(callback.callbackParam);
+    }
 }
 
 NS_CC_END
@@ -28,15 +28,16 @@ THE SOFTWARE.
 #include "platform/CCPlatformMacros.h"
 #include "base/CCDirector.h"
 #include "base/CCScheduler.h"
+#include <stdint.h>
 #include <vector>
-#include <queue>
+#include <deque>
+#include <unordered_map>
+#include <atomic>
 #include <memory>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
-#include <future>
 #include <functional>
-#include <stdexcept>
 
 /**
 * @addtogroup base
@@ -48,12 +49,23 @@ NS_CC_BEGIN
 /**
  * @class AsyncTaskPool
  * @brief This class allows to perform background operations without having to manipulate threads.
+ *
+ * Tasks run on a pool of worker threads sized to the hardware concurrency. Each worker keeps its own
+ * deque of ready tasks and steals from the others when it runs out, so tasks of every type run in parallel.
+ * The task type is a hint: every worker prefers one type when picking new tasks, so a flood of tasks of
+ * one type doesn't starve the others.
+ *
+ * A task can depend on other tasks, it then starts on a worker thread as soon as they have all finished,
+ * without going through the main loop. Completion callbacks are batched and called in the cocos thread.
  * @js NA
  */
 class CC_DLL AsyncTaskPool
 {
 public:
     typedef std::function<void(void*)> TaskCallBack;
+
+    /** Identifies an enqueued task, 0 is never a valid id. */
+    typedef uint64_t TaskID;
     
     enum class TaskType
     {
@@ -70,11 +82,14 @@ public:
 
     /**
      * Destroys the async task pool.
+     * It waits for the tasks enqueued so far to finish, their callbacks are still called from the cocos thread.
      */
     static void destoryInstance();
     
     /**
      * Stop tasks.
+     * The tasks of this type that haven't started yet are dropped without calling their callbacks,
+     * and so are the tasks depending on them.
      *
      * @param type Task type you want to stop.
      */
@@ -83,134 +98,110 @@ public:
     /**
      * Enqueue a asynchronous task.
      *
-     * @param type task type is io task, network task or others, each type of task has a thread to deal with it.
+     * @param type task type is io task, network task or others, used to balance the types across the worker threads.
      * @param callback callback when the task is finished. The callback is called in the main thread instead of task thread.
      * @param callbackParam parameter used by the callback.
      * @param f task can be lambda function.
+     * @return The id of the task, to make other tasks depend on it.
+     * @lua NA
+     */
+    template<class F>
+    inline TaskID enqueue(TaskType type, const TaskCallBack& callback, void* callbackParam, F&& f);
+
+    /**
+     * Enqueue a asynchronous task that starts once the given tasks have finished.
+     * Dependencies that have already finished are ignored. If one of them is stopped, this task is stopped too.
+     *
+     * @param type task type is io task, network task or others.
+     * @param callback callback when the task is finished, it can be empty. The callback is called in the main thread.
+     * @param callbackParam parameter used by the callback.
+     * @param f task can be lambda function.
+     * @param dependencies The ids returned when the tasks this one depends on were enqueued.
+     * @return The id of the task.
      * @lua NA
      */
     template<class F>
-    inline void enqueue(TaskType type, const TaskCallBack& callback, void* callbackParam, F&& f);
+    inline TaskID enqueue(TaskType type, const TaskCallBack& callback, void* callbackParam, F&& f, const std::vector<TaskID>& dependencies);
+
+    /** Returns the number of worker threads. */
+    int getWorkerCount() const { return (int)_workers.size(); }
     
 CC_CONSTRUCTOR_ACCESS:
     AsyncTaskPool();
     ~AsyncTaskPool();
     
 protected:
-    
-    // thread tasks internally used
-    class ThreadTasks {
-        struct AsyncTaskCallBack
-        {
-            TaskCallBack          callback;
-            void*                 callbackParam;
-        };
-    public:
-        ThreadTasks()
-        : _stop(false)
-        {
-            _thread = std::thread(
-                                  [this]
-                                  {
-                                      for(;;)
-                                      {
-                                          std::function<void()> task;
-                                          AsyncTaskCallBack callback;
-                                          {
-                                              std::unique_lock<std::mutex> lock(this->_queueMutex);
-                                              this->_condition.wait(lock,
-                                                                    [this]{ return this->_stop || !this->_tasks.empty(); });
-                                              if(this->_stop && this->_tasks.empty())
-                                                  return;
-                                              task = std::move(this->_tasks.front());
-                                              callback = std::move(this->_taskCallBacks.front());
-                                              this->_tasks.pop();
-                                              this->_taskCallBacks.pop();
-                                          }
-                                          
-                                          task();
-                                          Director::getInstance()->getScheduler()->performFunctionInCocosThread([&, callback]{ callback.callback(callback.callbackParam); });
-                                      }
-                                  }
-                                  );
-        }
-        ~ThreadTasks()
-        {
-            {
-                std::unique_lock<std::mutex> lock(_queueMutex);
-                _stop = true;
-                
-                while(_tasks.size())
-                    _tasks.pop();
-                while (_taskCallBacks.size())
-                    _taskCallBacks.pop();
-            }
-            _condition.notify_all();
-            _thread.join();
-        }
-        void clear()
-        {
-            std::unique_lock<std::mutex> lock(_queueMutex);
-            while(_tasks.size())
-                _tasks.pop();
-            while (_taskCallBacks.size())
-                _taskCallBacks.pop();
-        }
-        template<class F>
-        void enqueue(const TaskCallBack& callback, void* callbackParam, F&& f)
-        {
-            auto task = f;//std::bind(std::forward<F>(f), std::forward<Args>(args)...);
-            
-            {
-                std::unique_lock<std::mutex> lock(_queueMutex);
-                
-                // don't allow enqueueing after stopping the pool
-                if(_stop)
-                {
-                    CC_ASSERT(0 && "already stop");
-                    return;
-                }
-                
-                AsyncTaskCallBack taskCallBack;
-                taskCallBack.callback = callback;
-                taskCallBack.callbackParam = callbackParam;
-                _tasks.emplace([task](){ task(); });
-                _taskCallBacks.emplace(taskCallBack);
-            }
-            _condition.notify_one();
-        }
-    private:
-        
-        // need to keep track of thread so we can join them
-        std::thread _thread;
-        // the task queue
-        std::queue< std::function<void()> > _tasks;
-        std::queue<AsyncTaskCallBack>            _taskCallBacks;
-        
-        // synchronization
-        std::mutex _queueMutex;
-        std::condition_variable _condition;
-        bool _stop;
+
+    struct Task
+    {
+        TaskID id;
+        TaskType type;
+        unsigned int generation;
+        std::function<void()> function;
+        TaskCallBack callback;
+        void* callbackParam;
+        int pendingDependencies;
+        bool stopped;
+        std::vector<Task*> dependents;
     };
-    
-    //tasks
-    ThreadTasks _threadTasks[int(TaskType::TASK_MAX_TYPE)];
+
+    struct AsyncTaskCallBack
+    {
+        TaskCallBack          callback;
+        void*                 callbackParam;
+    };
+
+    // a worker thread and its deque of ready tasks, defined in the source file
+    class Worker;
+
+    TaskID enqueueTask(TaskType type, const TaskCallBack& callback, void* callbackParam, std::function<void()>&& f, const std::vector<TaskID>* dependencies);
+    void schedule(Task* task, Worker* worker);
+    Task* findTask(Worker* worker);
+    void run(Worker* worker);
+    void finishTask(Task* task, bool stopped, Worker* worker);
+    void dispatchCallbacks();
+
+    std::vector<Worker*> _workers;
+
+    // tasks enqueued from outside the workers, one queue per type
+    std::deque<Task*> _queues[int(TaskType::TASK_MAX_TYPE)];
+    std::mutex _queueMutex;
+    std::atomic<int> _queuedCount;
+
+    // tasks that haven't finished, by id, and the tasks waiting for them
+    std::unordered_map<TaskID, Task*> _tasks;
+    std::mutex _tasksMutex;
+    // notified when _tasks becomes empty, the destructor waits for it
+    std::condition_variable _drainedCondition;
+    std::atomic<TaskID> _nextTaskID;
+
+    // stopTasks() bumps the generation of a type, older tasks of that type are dropped
+    std::atomic<unsigned int> _generations[int(TaskType::TASK_MAX_TYPE)];
+
+    // sleeping workers, woken up when a task becomes ready
+    std::mutex _sleepMutex;
+    std::condition_variable _sleepCondition;
+    std::atomic<int> _readyCount;
+    std::atomic<int> _sleepingCount;
+    std::atomic<bool> _stop;
+
+    // callbacks of the finished tasks, handed to the cocos thread in batches
+    std::vector<AsyncTaskCallBack> _finishedCallbacks;
+    std::mutex _callbacksMutex;
     
     static AsyncTaskPool* s_asyncTaskPool;
 };
 
-inline void AsyncTaskPool::stopTasks(TaskType type)
+template<class F>
+inline AsyncTaskPool::TaskID AsyncTaskPool::enqueue(AsyncTaskPool::TaskType type, const TaskCallBack& callback, void* callbackParam, F&& f)
 {
-    auto& threadTask = _threadTasks[(int)type];
-    threadTask.clear();
+    return enqueueTask(type, callback, callbackParam, std::function<void()>(std::forward<F>(f)), nullptr);
 }
 
 template<class F>
-inline void AsyncTaskPool::enqueue(AsyncTaskPool::TaskType type, const TaskCallBack& callback, void* callbackParam, F&& f)
+inline AsyncTaskPool::TaskID AsyncTaskPool::enqueue(AsyncTaskPool::TaskType type, const TaskCallBack& callback, void* callbackParam, F&& f, const std::vector<TaskID>& dependencies)
 {
-    auto& threadTask = _threadTasks[(int)type];
-    
-    threadTask.enqueue(callback, callbackParam, f);
+    return enqueueTask(type, callback, callbackParam, std::function<void()>(std::forward<F>(f)), &dependencies);
 }
 
 
@@ -33,6 +33,19 @@ extern const char* cocos2dVersion();
 
 Configuration* Configuration::s_sharedConfiguration = nullptr;
 
+// major and minor number of GL_VERSION, "4.1 ..." on desktop and "OpenGL ES 3.0 ..." on mobile
+static void getGLVersion(int* major, int* minor)
+{
+    *major = *minor = 0;
+    const char* version = (const char*)glGetString(GL_VERSION);
+    if (version == nullptr)
+        return;
+
+    while (*version && (*version < '0' || *version > '9'))
+        ++version;
+    sscanf(version, "%d.%d", major, minor);
+}
+
 Configuration::Configuration()
 : _maxTextureSize(0) 
 , _maxModelviewStackDepth(0)
@@ -44,6 +57,9 @@ Configuration::Configuration()
 , _supportsBGRA8888(false)
 , _supportsDiscardFramebuffer(false)
 , _supportsShareableVAO(false)
+, _supportsMapBufferRange(false)
+, _supportsFenceSync(false)
+, _supportsElementIndexUint(false)
 , _maxSamplesAllowed(0)
 , _maxTextureUnits(0)
 , _glExtensions(nullptr)
@@ -143,6 +159,28 @@ void Configuration::gatherGPUInfo()
     _supportsShareableVAO = checkForGLExtension("vertex_array_object");
 	_valueDict["gl.supports_vertex_array_object"] = Value(_supportsShareableVAO);
 
+    _supportsMapBufferRange = checkForGLExtension("map_buffer_range");
+    _valueDict["gl.supports_map_buffer_range"] = Value(_supportsMapBufferRange);
+
+    // the renderer calls the core glFenceSync/glClientWaitSync, GL_APPLE_sync only has the *APPLE entry points
+    int major, minor;
+    getGLVersion(&major, &minor);
+#if (CC_TARGET_PLATFORM == CC_PLATFORM_MAC || CC_TARGET_PLATFORM == CC_PLATFORM_WIN32 || CC_TARGET_PLATFORM == CC_PLATFORM_LINUX)
+    bool coreFenceSync = major > 3 || (major == 3 && minor >= 2);
+#else
+    bool coreFenceSync = major >= 3;
+#endif
+    _supportsFenceSync = coreFenceSync || checkForGLExtension("GL_ARB_sync");
+    _valueDict["gl.supports_fence_sync"] = Value(_supportsFenceSync);
+
+#if (CC_TARGET_PLATFORM == CC_PLATFORM_MAC || CC_TARGET_PLATFORM == CC_PLATFORM_WIN32 || CC_TARGET_PLATFORM == CC_PLATFORM_LINUX)
+    // part of desktop OpenGL, it is only an extension on OpenGL ES 2.0
+    _supportsElementIndexUint = true;
+#else
+    _supportsElementIndexUint = checkForGLExtension("GL_OES_element_index_uint");
+#endif
+    _valueDict["gl.supports_element_index_uint"] = Value(_supportsElementIndexUint);
+
     CHECK_GL_ERROR_DEBUG();
 }
 
@@ -248,6 +286,21 @@ bool Configuration::supportsShareableVAO() const
 #endif
 }
 
+bool Configuration::supportsMapBufferRange() const
+{
+    return _supportsMapBufferRange;
+}
+
+bool Configuration::supportsFenceSync() const
+{
+    return _supportsFenceSync;
+}
+
+bool Configuration::supportsElementIndexUint() const
+{
+    return _supportsElementIndexUint;
+}
+
 int Configuration::getMaxSupportDirLightInShader() const
 {
     return _maxDirLightInShader;
@@ -276,7 +329,7 @@ const Value& Configuration::getValue(const std::string& key, const Value& defaul
     auto iter = _valueDict.find(key);
     if (iter != _valueDict.cend())
         return _valueDict.at(key);
-	return defaultValue;
+    return defaultValue;
 }
 
 void Configuration::setValue(const std::string& key, const Value& value)
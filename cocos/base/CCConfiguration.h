@@ -143,6 +143,27 @@ public:
      * @since v2.0.0
      */
 	bool supportsShareableVAO() const;
+
+    /** Whether or not glMapBufferRange is supported.
+     *
+     * @return Is true if supports glMapBufferRange.
+     * @since v3.6
+     */
+    bool supportsMapBufferRange() const;
+
+    /** Whether or not sync objects (glFenceSync/glClientWaitSync) are supported.
+     *
+     * @return Is true if supports sync objects.
+     * @since v3.6
+     */
+    bool supportsFenceSync() const;
+
+    /** Whether or not 32 bits indices (GL_UNSIGNED_INT) can be used with glDrawElements.
+     *
+     * @return Is true if supports 32 bits indices.
+     * @since v3.6
+     */
+    bool supportsElementIndexUint() const;
     
     /** Max support directional light in shader, for Sprite3D.
      *
@@ -228,6 +249,9 @@ protected:
     bool            _supportsBGRA8888;
     bool            _supportsDiscardFramebuffer;
     bool            _supportsShareableVAO;
+    bool            _supportsMapBufferRange;
+    bool            _supportsFenceSync;
+    bool            _supportsElementIndexUint;
     GLint           _maxSamplesAllowed;
     GLint           _maxTextureUnits;
     char *          _glExtensions;
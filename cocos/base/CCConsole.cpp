@@ -68,6 +68,7 @@
 #include "base/base64.h"
 #include "base/ccUtils.h"
 #include "base/allocator/CCAllocatorDiagnostics.h"
+#include "base/CCProfiling.h"
 NS_CC_BEGIN
 
 extern const char* cocos2dVersion(void);
@@ -313,6 +314,7 @@ Console::Console()
             }
         } },
         { "help", "Print this message", std::bind(&Console::commandHelp, this, std::placeholders::_1, std::placeholders::_2) },
+        { "profiler", "Print, reset or capture the profiler data, type -h or [profiler help] to list supported directives", std::bind(&Console::commandProfiler, this, std::placeholders::_1, std::placeholders::_2) },
         { "projection", "Change or print the current projection. Args: [2d | 3d]", std::bind(&Console::commandProjection, this, std::placeholders::_1, std::placeholders::_2) },
         { "resolution", "Change or print the window resolution. Args: [width height resolution_policy | ]", std::bind(&Console::commandResolution, this, std::placeholders::_1, std::placeholders::_2) },
         { "scenegraph", "Print the scene graph", std::bind(&Console::commandSceneGraph, this, std::placeholders::_1, std::placeholders::_2) },
@@ -828,6 +830,71 @@ void Console::commandAllocator(int fd, const std::string& args)
 #endif
 }
 
+void Console::commandProfiler(int fd, const std::string& args)
+{
+#if CC_ENABLE_PROFILERS
+    Scheduler *sched = Director::getInstance()->getScheduler();
+    auto argv = split(args, ' ');
+
+    if(args == "help" || args == "-h")
+    {
+        const char help[] = "available profiler directives:\n"
+                            "\t[none], print the call tree of every thread for the last frame\n"
+                            "\treset, reset the timers and the call trees\n"
+                            "\tcapture start, start recording the timed blocks\n"
+                            "\tcapture stop [filename], write the recorded blocks as Chrome trace JSON in the writable path (default: profile.json)\n";
+        send(fd, help, sizeof(help) - 1,0);
+    }
+    else if(args.length() == 0)
+    {
+        sched->performFunctionInCocosThread( [=](){
+            mydprintf(fd, "%s", Profiler::getInstance()->getFrameReport().c_str());
+            sendPrompt(fd);
+        }
+                                            );
+    }
+    else if(args == "reset")
+    {
+        sched->performFunctionInCocosThread( [](){
+            Profiler::getInstance()->releaseAllTimers();
+        }
+                                            );
+    }
+    else if(argv.size() >= 2 && argv[0] == "capture" && argv[1] == "start")
+    {
+        sched->performFunctionInCocosThread( [](){
+            Profiler::getInstance()->startCapture();
+        }
+                                            );
+    }
+    else if(argv.size() >= 2 && argv[0] == "capture" && argv[1] == "stop")
+    {
+        std::string name = argv.size() > 2 ? argv[2] : "profile.json";
+        if (name.find_first_of("/\\") != std::string::npos)
+        {
+            mydprintf(fd, "Invalid filename: '%s'. The capture is written in the writable path\n", name.c_str());
+            return;
+        }
+
+        std::string filename = _writablePath + name;
+        sched->performFunctionInCocosThread( [=](){
+            if (Profiler::getInstance()->stopCapture(filename))
+                mydprintf(fd, "capture written to %s\n", filename.c_str());
+            else
+                mydprintf(fd, "failed to write the capture to %s\n", filename.c_str());
+            sendPrompt(fd);
+        }
+                                            );
+    }
+    else
+    {
+        mydprintf(fd, "Unsupported argument: '%s'. Type [profiler help] to list supported directives\n", args.c_str());
+    }
+#else
+    mydprintf(fd, "profiler not available. CC_ENABLE_PROFILERS must be set to 1 in ccConfig.h");
+#endif
+}
+
 static char invalid_filename_char[] = {':', '/', '\\', '?', '%', '*', '<', '>', '"', '|', '\r', '\n', '\t'};
 
 void Console::commandUpload(int fd)
@@ -129,6 +129,7 @@ protected:
     void commandTouch(int fd, const std::string &args);
     void commandUpload(int fd);
     void commandAllocator(int fd, const std::string &args);
+    void commandProfiler(int fd, const std::string &args);
     // file descriptor: socket, console, etc.
     int _listenfd;
     int _maxfd;
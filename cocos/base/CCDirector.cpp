@@ -58,6 +58,8 @@ THE SOFTWARE.
 #include "base/CCAutoreleasePool.h"
 #include "base/CCConfiguration.h"
 #include "base/CCAsyncTaskPool.h"
+#include "base/CCFrameArena.h"
+#include "base/CCProfiling.h"
 #include "platform/CCApplication.h"
 //#include "platform/CCGLViewImpl.h"
 
@@ -173,6 +175,8 @@ bool Director::init(void)
     //初始化渲染类
     _renderer = new (std::nothrow) Renderer;
 
+    _frameArena = new (std::nothrow) FrameArena();
+
     return true;
 }
 
@@ -196,6 +200,8 @@ Director::~Director(void)
 
     delete _renderer;
 
+    delete _frameArena;
+
     delete _console;
 
 
@@ -261,6 +267,8 @@ void Director::setGLDefaultValues()
 // Draw the Scene
 void Director::drawScene()
 {
+    CC_PROFILER_SCOPE("Director - drawScene");
+
     // calculate "global" dt
     //更新_deltaTime（上次调用该函数到这次调用的间隔时间）
     //更新_lastUpdate（记录上次调用的时间点）
@@ -325,6 +333,9 @@ void Director::drawScene()
         showStats(); //屏幕上显示帧率
     }
     _renderer->render();
+    // everything queued so far has been drawn. Frame data allocated from now on is only
+    // read by the next render(), which happens before the next reset
+    _frameArena->reset();
     //TODO: 渲染结束了我要发一个消息
     _eventDispatcher->dispatchEvent(_eventAfterDraw);
     //从当前OpenGL变换矩阵栈Pop元素
@@ -1376,6 +1387,8 @@ void DisplayLinkDirector::mainLoop()
     else if (! _invalid)//调用StartAnimation时，设置为false，这里开启主线程绘制
     {
         drawScene();//OpenGL 主循环 绘制场景
+        // aggregates the blocks timed during the frame, drawScene() included
+        CC_PROFILER_END_FRAME();
      
         // release the objects        
         //在每一次循环中都会清理一次内存池,整个内存管理的动力所在。
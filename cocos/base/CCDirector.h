@@ -65,6 +65,7 @@ class EventListenerCustom;
 class TextureCache;
 class Renderer;
 class Camera;
+class FrameArena;
 
 class Console;
 
@@ -437,6 +438,13 @@ public:
      */
     Renderer* getRenderer() const { return _renderer; }
 
+    /** Returns the arena for data that only lives until the current frame has been rendered,
+     * such as the arguments of render commands. It is reset after each frame is drawn.
+     * @js NA
+     * @lua NA
+     */
+    FrameArena* getFrameArena() const { return _frameArena; }
+
     /** Returns the Console associated with this director.
      * @since v3.0
      * @js NA
@@ -602,6 +610,9 @@ protected:
     /* Renderer for the Director */
     Renderer *_renderer;
 
+    /* Per frame scratch memory, reset after rendering */
+    FrameArena *_frameArena;
+
     /* Console for the director */
     Console *_console;
 
@@ -24,9 +24,12 @@
 
 #include "base/CCEventCustom.h"
 #include "base/CCEvent.h"
+#include "base/allocator/CCAllocatorStrategySlab.h"
 
 NS_CC_BEGIN
 
+CC_IMPLEMENT_ALLOCATOR_SLAB(EventCustom)
+
 EventCustom::EventCustom(const std::string& eventName)
 : Event(Type::CUSTOM)
 , _userData(nullptr)
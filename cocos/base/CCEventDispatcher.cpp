@@ -37,6 +37,7 @@
 #include "2d/CCScene.h"
 #include "base/CCDirector.h"
 #include "base/CCEventType.h"
+#include "base/CCTouchSpatialIndex.h"
 
 
 #define DUMP_LISTENER_ITEM_PRIORITY_INFO 0
@@ -200,9 +201,15 @@ void EventDispatcher::EventListenerVector::clear()
 
 
 EventDispatcher::EventDispatcher()
-: _inDispatch(0)
+: _sceneGraphRootNode(nullptr)
+, _sceneGraphPriorityRebuildCount(0)
+, _rebuildRateCount(0)
+, _rebuildRate(0)
+, _rebuildRateStart(std::chrono::steady_clock::now())
+, _inDispatch(0)
 , _isEnabled(false)
 , _nodePriorityIndex(0)
+, _touchSpatialIndex(nullptr)
 {
     _toAddedListeners.reserve(50);
     
@@ -219,10 +226,14 @@ EventDispatcher::~EventDispatcher()
     // so removeAllEventListeners would clean internal custom listeners.
     _internalCustomListenerIDs.clear();
     removeAllEventListeners();
+    setTouchSpatialIndexEnabled(false);
 }
 
 void EventDispatcher::visitTarget(Node* node, bool isRootNode)
 {    
+    // the incremental updates compare siblings in sorted order, walk them the same way
+    node->sortAllChildren();
+
     int i = 0;
     auto& children = node->getChildren();
     
@@ -298,6 +309,9 @@ void EventDispatcher::pauseEventListenersForTarget(Node* target, bool recursive/
         {
             l->setPaused(true);
         }
+
+        // A node leaving the scene drops to the lowest scene graph priority
+        _dirtyNodes.insert(target);
     }
 
     for (auto& listener : _toAddedListeners)
@@ -358,6 +372,10 @@ void EventDispatcher::removeEventListenersForTarget(Node* target, bool recursive
     // Don't want any dangling pointers or the possibility of dealing with deleted objects..
     _nodePriorityMap.erase(target);
     _dirtyNodes.erase(target);
+    for (auto& dirtyNodes : _sceneGraphDirtyNodes)
+    {
+        dirtyNodes.second.erase(target);
+    }
 
     auto listenerIter = _nodeListenersMap.find(target);
     if (listenerIter != _nodeListenersMap.end())
@@ -414,6 +432,12 @@ void EventDispatcher::associateNodeAndEventListener(Node* node, EventListener* l
     {
         listeners = new std::vector<EventListener*>();
         _nodeListenersMap.insert(std::make_pair(node, listeners));
+
+        if (_touchSpatialIndex)
+        {
+            _touchSpatialIndex->insert(node);
+            node->_touchBoundsTracked = true;
+        }
     }
     
     listeners->push_back(listener);
@@ -436,6 +460,12 @@ void EventDispatcher::dissociateNodeAndEventListener(Node* node, EventListener*
         {
             _nodeListenersMap.erase(found);
             delete listeners;
+
+            if (_touchSpatialIndex)
+            {
+                _touchSpatialIndex->remove(node);
+                node->_touchBoundsTracked = false;
+            }
         }
     }
 }
@@ -479,11 +509,6 @@ void EventDispatcher::forceAddEventListener(EventListener* listener)
      //如果优先级是0，则设置为graph。
     if (listener->getFixedPriority() == 0)
     {   
-        //设置该listenerID的DirtyFlag  
-        //(setDirty函数可以这样理解，每个ListenerID都有特定的dirtyFlag，
-        //每次进行add操作后，都要更新该ID的flag)
-        setDirty(listenerID, DirtyFlag::SCENE_GRAPH_PRIORITY);
-        
         //如果是sceneGraph类的事件，则需要处理两个方面：  
         //1.将node 与event 关联  
         //2.如果该node是运行中的，则需要恢复其事件（因为默认的sceneGraph listener的状态时pause）  
@@ -492,6 +517,9 @@ void EventDispatcher::forceAddEventListener(EventListener* listener)
         CCASSERT(node != nullptr, "Invalid scene graph priority!");
         
         associateNodeAndEventListener(node, listener);
+
+        // The listener was appended, move it to its place before the next dispatch
+        _sceneGraphDirtyNodes[listenerID].insert(node);
         
         if (node->isRunning())
         {
@@ -655,13 +683,9 @@ void EventDispatcher::removeEventListener(EventListener* listener)
         auto fixedPriorityListeners = listeners->getFixedPriorityListeners();
         auto sceneGraphPriorityListeners = listeners->getSceneGraphPriorityListeners();
         //从graphList中寻找。找到后需要更新该listenerID的dirty flag。  
+        // Removing a listener keeps the others sorted, no need to sort them again
         removeListenerInVector(sceneGraphPriorityListeners);
-        if (isFound)
-        {
-            // fixed #4160: Dirty flag need to be updated after listeners were removed.
-            setDirty(listener->getListenerID(), DirtyFlag::SCENE_GRAPH_PRIORITY);
-        }
-        else
+        if (!isFound)
         {
             removeListenerInVector(fixedPriorityListeners);
             if (isFound)
@@ -686,6 +710,7 @@ void EventDispatcher::removeEventListener(EventListener* listener)
         if (iter->second->empty())
         {
             _priorityDirtyFlagMap.erase(listener->getListenerID());
+            _sceneGraphDirtyNodes.erase(listener->getListenerID());
             auto list = iter->second;
             iter = _listenerMap.erase(iter);
             CC_SAFE_DELETE(list);
@@ -745,10 +770,14 @@ void EventDispatcher::setPriority(EventListener* listener, int fixedPriority)
 }
 
 void EventDispatcher::dispatchEventToListeners(EventListenerVector* listeners, const std::function<bool(EventListener*)>& onEvent)
+{
+    dispatchEventToListeners(listeners, listeners->getSceneGraphPriorityListeners(), onEvent);
+}
+
+void EventDispatcher::dispatchEventToListeners(EventListenerVector* listeners, std::vector<EventListener*>* sceneGraphPriorityListeners, const std::function<bool(EventListener*)>& onEvent)
 {
     bool shouldStopPropagation = false;
     auto fixedPriorityListeners = listeners->getFixedPriorityListeners();
-    auto sceneGraphPriorityListeners = listeners->getSceneGraphPriorityListeners();
     
      //整体操作流程分为三个部分，处理优先级<0，=0,>0三个部分  
     ssize_t i = 0;
@@ -981,8 +1010,18 @@ void EventDispatcher::dispatchTouchEvent(EventTouch* event)
                 return false;
             };
             
-            //
-            dispatchEventToListeners(oneByOneListeners, onTouchEvent);
+            // only the listeners whose node contains the touch can claim it
+            if (_touchSpatialIndex && event->getEventCode() == EventTouch::EventCode::BEGAN
+                && oneByOneListeners->getSceneGraphPriorityListeners())
+            {
+                std::vector<EventListener*> hitListeners;
+                getTouchListenersAtPoint((*touchesIter)->getLocation(), hitListeners);
+                dispatchEventToListeners(oneByOneListeners, &hitListeners, onTouchEvent);
+            }
+            else
+            {
+                dispatchEventToListeners(oneByOneListeners, onTouchEvent);
+            }
             if (event->isStopped())
             {
                 return;
@@ -1059,6 +1098,33 @@ void EventDispatcher::dispatchTouchEvent(EventTouch* event)
     updateListeners(event);
 }
 
+void EventDispatcher::getTouchListenersAtPoint(const Vec2& point, std::vector<EventListener*>& listeners)
+{
+    std::vector<Node*> nodes;
+    _touchSpatialIndex->query(point, nodes);
+
+    for (auto node : nodes)
+    {
+        auto iter = _nodeListenersMap.find(node);
+        if (iter == _nodeListenersMap.end())
+            continue;
+
+        for (auto l : *iter->second)
+        {
+            if (l->getFixedPriority() == 0 && l->getListenerID() == EventListenerTouchOneByOne::LISTENER_ID)
+            {
+                listeners.push_back(l);
+            }
+        }
+    }
+
+    // Same order as the sorted scene graph priority listeners
+    auto rootNode = Director::getInstance()->getRunningScene();
+    std::stable_sort(listeners.begin(), listeners.end(), [this, rootNode](const EventListener* l1, const EventListener* l2) {
+        return isSceneGraphPriorityHigher(l1->getAssociatedNode(), l2->getAssociatedNode(), rootNode);
+    });
+}
+
 void EventDispatcher::updateListeners(Event* event)
 {
     CCASSERT(_inDispatch > 0, "If program goes here, there should be event in dispatch.");
@@ -1139,6 +1205,7 @@ void EventDispatcher::updateListeners(Event* event)
         if (iter->second->empty())
         {
             _priorityDirtyFlagMap.erase(iter->first);
+            _sceneGraphDirtyNodes.erase(iter->first);
             delete iter->second;
             iter = _listenerMap.erase(iter);
         }
@@ -1160,6 +1227,20 @@ void EventDispatcher::updateListeners(Event* event)
 
 void EventDispatcher::updateDirtyFlagForSceneGraph()
 {
+    // Listeners sorted against another scene, e.g. the one that ran a transition, need a full walk
+    auto rootNode = Director::getInstance()->getRunningScene();
+    if (rootNode != _sceneGraphRootNode)
+    {
+        _sceneGraphRootNode = rootNode;
+        for (auto& e : _listenerMap)
+        {
+            if (e.second->getSceneGraphPriorityListeners())
+            {
+                setDirty(e.first, DirtyFlag::SCENE_GRAPH_PRIORITY);
+            }
+        }
+    }
+
     if (!_dirtyNodes.empty())
     {
         for (auto& node : _dirtyNodes)
@@ -1169,7 +1250,7 @@ void EventDispatcher::updateDirtyFlagForSceneGraph()
             {
                 for (auto& l : *iter->second)
                 {
-                    setDirty(l->getListenerID(), DirtyFlag::SCENE_GRAPH_PRIORITY);
+                    _sceneGraphDirtyNodes[l->getListenerID()].insert(node);
                 }
             }
         }
@@ -1211,6 +1292,16 @@ void EventDispatcher::sortEventListeners(const EventListener::ListenerID& listen
             }
         }
     }
+
+    auto dirtyNodesIter = _sceneGraphDirtyNodes.find(listenerID);
+    if (dirtyNodesIter != _sceneGraphDirtyNodes.end() && !dirtyNodesIter->second.empty())
+    {
+        auto rootNode = Director::getInstance()->getRunningScene();
+        if (rootNode && !updateSceneGraphPriorityOfDirtyNodes(listenerID, rootNode))
+        {
+            sortEventListenersOfSceneGraphPriority(listenerID, rootNode);
+        }
+    }
 }
 
 void EventDispatcher::sortEventListenersOfSceneGraphPriority(const EventListener::ListenerID& listenerID, Node* rootNode)
@@ -1224,6 +1315,13 @@ void EventDispatcher::sortEventListenersOfSceneGraphPriority(const EventListener
     if (sceneGraphListeners == nullptr)
         return;
 
+    // The full sort places the dirty nodes too
+    _sceneGraphDirtyNodes.erase(listenerID);
+
+    ++_sceneGraphPriorityRebuildCount;
+    ++_rebuildRateCount;
+    getSceneGraphPriorityRebuildRate();
+
     // Reset priority index
     _nodePriorityIndex = 0;
     _nodePriorityMap.clear();
@@ -1244,6 +1342,128 @@ void EventDispatcher::sortEventListenersOfSceneGraphPriority(const EventListener
 #endif
 }
 
+bool EventDispatcher::updateSceneGraphPriorityOfDirtyNodes(const EventListener::ListenerID& listenerID, Node* rootNode)
+{
+    auto dirtyNodesIter = _sceneGraphDirtyNodes.find(listenerID);
+    std::set<Node*> dirtyNodes;
+    dirtyNodes.swap(dirtyNodesIter->second);
+
+    auto listeners = getListeners(listenerID);
+    if (listeners == nullptr)
+        return true;
+
+    auto sceneGraphListeners = listeners->getSceneGraphPriorityListeners();
+    if (sceneGraphListeners == nullptr)
+        return true;
+
+    std::vector<EventListener*> dirtyListeners;
+    for (auto node : dirtyNodes)
+    {
+        auto iter = _nodeListenersMap.find(node);
+        if (iter == _nodeListenersMap.end())
+            continue;
+
+        for (auto l : *iter->second)
+        {
+            if (l->getFixedPriority() == 0 && l->getListenerID() == listenerID)
+            {
+                dirtyListeners.push_back(l);
+            }
+        }
+    }
+
+    if (dirtyListeners.empty())
+        return true;
+
+    // Walking the scene is cheaper when most listeners moved. Listeners removed during a dispatch
+    // lost their node and sit out of order until updateListeners() erases them, so sort them all.
+    if (dirtyListeners.size() * 4 > sceneGraphListeners->size())
+        return false;
+
+    for (auto l : *sceneGraphListeners)
+    {
+        if (l->getAssociatedNode() == nullptr)
+            return false;
+    }
+
+    std::set<EventListener*> dirtySet(dirtyListeners.begin(), dirtyListeners.end());
+    sceneGraphListeners->erase(std::remove_if(sceneGraphListeners->begin(), sceneGraphListeners->end(), [&dirtySet](EventListener* l) {
+        return dirtySet.find(l) != dirtySet.end();
+    }), sceneGraphListeners->end());
+
+    for (auto l : dirtyListeners)
+    {
+        auto pos = std::upper_bound(sceneGraphListeners->begin(), sceneGraphListeners->end(), l, [this, rootNode](const EventListener* l1, const EventListener* l2) {
+            return isSceneGraphPriorityHigher(l1->getAssociatedNode(), l2->getAssociatedNode(), rootNode);
+        });
+        sceneGraphListeners->insert(pos, l);
+    }
+
+    return true;
+}
+
+bool EventDispatcher::isSceneGraphPriorityHigher(Node* node1, Node* node2, Node* rootNode)
+{
+    if (node1 == node2)
+        return false;
+
+    auto collectAncestors = [rootNode](Node* node, std::vector<Node*>& ancestors) -> bool {
+        ancestors.clear();
+        for (; node; node = node->getParent())
+        {
+            ancestors.push_back(node);
+        }
+        return !ancestors.empty() && ancestors.back() == rootNode;
+    };
+
+    // Nodes outside of the running scene come last, like in visitTarget
+    bool inScene1 = collectAncestors(node1, _ancestors1);
+    bool inScene2 = collectAncestors(node2, _ancestors2);
+    if (!inScene1 || !inScene2)
+        return inScene1 && !inScene2;
+
+    if (node1->getGlobalZOrder() != node2->getGlobalZOrder())
+        return node1->getGlobalZOrder() > node2->getGlobalZOrder();
+
+    // Find the common ancestor, the later visited node has the higher priority
+    ssize_t i1 = _ancestors1.size() - 1;
+    ssize_t i2 = _ancestors2.size() - 1;
+    while (i1 > 0 && i2 > 0 && _ancestors1[i1 - 1] == _ancestors2[i2 - 1])
+    {
+        --i1;
+        --i2;
+    }
+
+    if (i1 == 0)
+    {
+        // node1 is an ancestor of node2, it is visited after the children with negative z order
+        return _ancestors2[i2 - 1]->getLocalZOrder() < 0;
+    }
+    if (i2 == 0)
+    {
+        return _ancestors1[i1 - 1]->getLocalZOrder() >= 0;
+    }
+
+    Node* child1 = _ancestors1[i1 - 1];
+    Node* child2 = _ancestors2[i2 - 1];
+    if (child1->getLocalZOrder() != child2->getLocalZOrder())
+        return child1->getLocalZOrder() > child2->getLocalZOrder();
+    return child1->getOrderOfArrival() > child2->getOrderOfArrival();
+}
+
+float EventDispatcher::getSceneGraphPriorityRebuildRate() const
+{
+    auto now = std::chrono::steady_clock::now();
+    float elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - _rebuildRateStart).count() / 1000.0f;
+    if (elapsed >= 1.0f)
+    {
+        _rebuildRate = _rebuildRateCount / elapsed;
+        _rebuildRateCount = 0;
+        _rebuildRateStart = now;
+    }
+    return _rebuildRate;
+}
+
 void EventDispatcher::sortEventListenersOfFixedPriority(const EventListener::ListenerID& listenerID)
 {
     auto listeners = getListeners(listenerID);
@@ -1333,6 +1553,7 @@ void EventDispatcher::removeEventListenersForListenerID(const EventListener::Lis
         // Remove the dirty flag according the 'listenerID'.
         // No need to check whether the dispatcher is dispatching event.
         _priorityDirtyFlagMap.erase(listenerID);
+        _sceneGraphDirtyNodes.erase(listenerID);
         
         if (!_inDispatch)
         {
@@ -1428,6 +1649,38 @@ bool EventDispatcher::isEnabled() const
     return _isEnabled;
 }
 
+void EventDispatcher::setTouchSpatialIndexEnabled(bool enabled)
+{
+    if (enabled == (_touchSpatialIndex != nullptr))
+        return;
+
+    if (enabled)
+    {
+        _touchSpatialIndex = new (std::nothrow) TouchSpatialIndex();
+        for (auto& e : _nodeListenersMap)
+        {
+            _touchSpatialIndex->insert(e.first);
+            e.first->_touchBoundsTracked = true;
+        }
+    }
+    else
+    {
+        for (auto& e : _nodeListenersMap)
+        {
+            e.first->_touchBoundsTracked = false;
+        }
+        CC_SAFE_DELETE(_touchSpatialIndex);
+    }
+}
+
+void EventDispatcher::setTouchBoundsDirty(Node* node)
+{
+    if (_touchSpatialIndex)
+    {
+        _touchSpatialIndex->setDirty(node);
+    }
+}
+
 void EventDispatcher::setDirtyForNode(Node* node)
 {
     // Mark the node dirty only when there is an eventlistener associated with it. 
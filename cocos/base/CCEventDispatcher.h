@@ -30,11 +30,13 @@
 #include <unordered_map>
 #include <vector>
 #include <set>
+#include <chrono>
 
 #include "platform/CCPlatformMacros.h"
 #include "base/CCEventListener.h"
 #include "base/CCEvent.h"
 #include "platform/CCStdC.h"
+#include "math/Vec2.h"
 
 /**
  * @addtogroup base
@@ -48,6 +50,7 @@ class EventTouch;
 class Node;
 class EventCustom;
 class EventListenerCustom;
+class TouchSpatialIndex;
 
 /** @class EventDispatcher
 * @brief This class manages event listener subscriptions
@@ -171,6 +174,38 @@ public:
      */
     bool isEnabled() const;
 
+    /** Whether to use a spatial index to find the touch listeners a touch may hit.
+     * When enabled, onTouchBegan of a one by one listener with scene graph priority is only called if the touch
+     * lies inside the world space bounding box of the listener's node, and the listeners are still called in
+     * scene graph priority order. Nodes with an empty content size are always called.
+     * Only enable it when such listeners never claim touches outside their node, and when the touchable nodes
+     * are drawn by the default camera, since bounds are compared with the touch location in world space.
+     * Default is false.
+     *
+     * @param enabled True to enable the spatial index.
+     */
+    void setTouchSpatialIndexEnabled(bool enabled);
+
+    /** Checks whether the touch spatial index is enabled.
+     *
+     * @return True if the touch spatial index is enabled.
+     */
+    bool isTouchSpatialIndexEnabled() const { return _touchSpatialIndex != nullptr; }
+
+    /** Gets how many times the scene graph priority listeners were sorted by walking the whole running scene.
+     * Adding or removing listeners and reordering nodes only reposition the affected listeners; a full walk happens
+     * when the running scene changes or when most listeners of a type are affected at once.
+     *
+     * @return The number of full rebuilds since the dispatcher was created.
+     */
+    unsigned int getSceneGraphPriorityRebuildCount() const { return _sceneGraphPriorityRebuildCount; }
+
+    /** Gets the number of full scene graph priority rebuilds per second, measured over the last second.
+     *
+     * @return The number of full rebuilds per second.
+     */
+    float getSceneGraphPriorityRebuildRate() const;
+
     /////////////////////////////////////////////
     
     /** Dispatches the event.
@@ -212,6 +247,9 @@ protected:
     
     /** Sets the dirty flag for a node. */
     void setDirtyForNode(Node* node);
+
+    /** Marks the touch bounds of a node stale, called by the node when its transform changes. */
+    void setTouchBoundsDirty(Node* node);
     
     /**
      *  The vector to store event listeners with scene graph based priority and fixed priority.
@@ -265,6 +303,14 @@ protected:
     
     /** Sorts the listeners of specified type by scene graph priority */
     void sortEventListenersOfSceneGraphPriority(const EventListener::ListenerID& listenerID, Node* rootNode);
+
+    /** Moves the listeners of the dirty nodes of a specified type to their place in the sorted listeners.
+     *  @return False if a full sort is needed instead.
+     */
+    bool updateSceneGraphPriorityOfDirtyNodes(const EventListener::ListenerID& listenerID, Node* rootNode);
+
+    /** Whether node1 receives events before node2, following the order set by visitTarget. */
+    bool isSceneGraphPriorityHigher(Node* node1, Node* node2, Node* rootNode);
     
     /** Sorts the listeners of specified type by fixed priority */
     void sortEventListenersOfFixedPriority(const EventListener::ListenerID& listenerID);
@@ -286,6 +332,12 @@ protected:
     
     /** Dispatches event to listeners with a specified listener type */
     void dispatchEventToListeners(EventListenerVector* listeners, const std::function<bool(EventListener*)>& onEvent);
+
+    /** Dispatches event to the fixed priority listeners of a listener type, and to the given scene graph priority listeners */
+    void dispatchEventToListeners(EventListenerVector* listeners, std::vector<EventListener*>* sceneGraphPriorityListeners, const std::function<bool(EventListener*)>& onEvent);
+
+    /** Collects the one by one touch listeners with scene graph priority whose node may contain a point, sorted by priority */
+    void getTouchListenersAtPoint(const Vec2& point, std::vector<EventListener*>& listeners);
     
     /// Priority dirty flag
     enum class DirtyFlag
@@ -324,6 +376,21 @@ protected:
     
     /** The nodes were associated with scene graph based priority listeners */
     std::set<Node*> _dirtyNodes;
+
+    /** The nodes whose scene graph priority listeners need to be repositioned, by listener ID */
+    std::unordered_map<EventListener::ListenerID, std::set<Node*>> _sceneGraphDirtyNodes;
+
+    /** The running scene the scene graph priority listeners were sorted against */
+    Node* _sceneGraphRootNode;
+
+    /** Scratch ancestor chains for isSceneGraphPriorityHigher */
+    std::vector<Node*> _ancestors1;
+    std::vector<Node*> _ancestors2;
+
+    unsigned int _sceneGraphPriorityRebuildCount;
+    mutable unsigned int _rebuildRateCount;
+    mutable float _rebuildRate;
+    mutable std::chrono::steady_clock::time_point _rebuildRateStart;
     
     /** Whether the dispatcher is dispatching event */
     int _inDispatch;
@@ -334,6 +401,9 @@ protected:
     int _nodePriorityIndex;
     
     std::set<std::string> _internalCustomListenerIDs;
+
+    /** The bounds of the nodes with listeners, or nullptr if the touch spatial index is disabled */
+    TouchSpatialIndex* _touchSpatialIndex;
 };
 
 
@@ -0,0 +1,134 @@
+/****************************************************************************
+ Copyright (c) 2015 Chukong Technologies Inc.
+
+ http://www.cocos2d-x.org
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ****************************************************************************/
+
+
+#include "base/CCFrameArena.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#include "base/ccMacros.h"
+
+NS_CC_BEGIN
+
+const size_t FrameArena::DEFAULT_CAPACITY = 64 * 1024;
+
+// the pattern written over released memory in debug builds
+#define CC_FRAME_ARENA_POISON 0xCD
+
+FrameArena::FrameArena(size_t capacity)
+: _buffer(nullptr)
+, _capacity(capacity)
+, _used(0)
+, _overflowUsed(0)
+, _overflowCount(0)
+, _highWaterMark(0)
+{
+    if (_capacity > 0)
+    {
+        _buffer = static_cast<uint8_t*>(malloc(_capacity));
+        CCASSERT(_buffer, "FrameArena: out of memory");
+    }
+}
+
+FrameArena::~FrameArena()
+{
+    for (auto block : _overflowBlocks)
+    {
+        free(block);
+    }
+    free(_buffer);
+}
+
+void* FrameArena::allocate(size_t size, size_t alignment)
+{
+    CCASSERT(alignment > 0 && (alignment & (alignment - 1)) == 0, "FrameArena: alignment must be a power of two");
+
+    uintptr_t base = reinterpret_cast<uintptr_t>(_buffer);
+    uintptr_t address = (base + _used + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    size_t end = address - base + size;
+    if (_buffer && end <= _capacity)
+    {
+        _used = end;
+        return reinterpret_cast<void*>(address);
+    }
+
+    return allocateOverflow(size, alignment);
+}
+
+void* FrameArena::allocateOverflow(size_t size, size_t alignment)
+{
+    // each overflow gets its own block, the next reset makes room for all of them
+    uint8_t* block = static_cast<uint8_t*>(malloc(size + alignment));
+    CCASSERT(block, "FrameArena: out of memory");
+    _overflowBlocks.push_back(block);
+    _overflowUsed += size + alignment;
+    ++_overflowCount;
+
+    uintptr_t address = (reinterpret_cast<uintptr_t>(block) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    return reinterpret_cast<void*>(address);
+}
+
+void FrameArena::reset()
+{
+    size_t used = _used + _overflowUsed;
+    _highWaterMark = std::max(_highWaterMark, used);
+
+    if (_overflowBlocks.empty())
+    {
+#if COCOS2D_DEBUG > 0
+        if (_buffer)
+        {
+            memset(_buffer, CC_FRAME_ARENA_POISON, _used);
+        }
+#endif
+        _used = 0;
+        return;
+    }
+
+    for (auto block : _overflowBlocks)
+    {
+        free(block);
+    }
+    _overflowBlocks.clear();
+
+    // grow to the high water mark plus a quarter, rounded to 4 KB, so that the next frames fit
+    size_t capacity = (_highWaterMark + _highWaterMark / 4 + 4095) & ~(size_t)4095;
+    CCLOG("cocos2d: FrameArena: %u bytes overflowed this frame, growing from %u to %u bytes",
+          (unsigned int)_overflowUsed, (unsigned int)_capacity, (unsigned int)capacity);
+
+    free(_buffer);
+    _buffer = static_cast<uint8_t*>(malloc(capacity));
+    CCASSERT(_buffer, "FrameArena: out of memory");
+    _capacity = capacity;
+#if COCOS2D_DEBUG > 0
+    memset(_buffer, CC_FRAME_ARENA_POISON, _capacity);
+#endif
+
+    _used = 0;
+    _overflowUsed = 0;
+}
+
+NS_CC_END
@@ -0,0 +1,145 @@
+/****************************************************************************
+ Copyright (c) 2015 Chukong Technologies Inc.
+
+ http://www.cocos2d-x.org
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ****************************************************************************/
+
+
+#ifndef __CCFRAMEARENA_H__
+#define __CCFRAMEARENA_H__
+
+#include <stdint.h>
+#include <new>
+#include <utility>
+#include <functional>
+#include <type_traits>
+#include <vector>
+
+#include "platform/CCPlatformMacros.h"
+
+/**
+ * @addtogroup base
+ * @js NA
+ * @lua NA
+ */
+NS_CC_BEGIN
+
+/**
+ FrameArena is a linear allocator for data that only lives until the end of the current frame,
+ such as the arguments of the render commands queued while visiting the scene.
+
+ Allocating is a pointer bump, and nothing is freed individually: Director resets the arena
+ once the frame has been rendered. When a frame needs more than the capacity, the extra requests
+ are served from overflow blocks, and the next reset grows the arena to the high water mark,
+ so steady-state frames don't allocate from the heap at all.
+
+ Destructors of the objects created in the arena are never called, so only use it for types
+ whose destructor has no effect. It must only be used from the main thread.
+
+ In debug builds, the memory is filled with a poison pattern on reset so that data used
+ after its frame is easy to spot, and overflows are logged.
+ */
+class CC_DLL FrameArena
+{
+public:
+    /** The capacity of the arena created by Director. */
+    static const size_t DEFAULT_CAPACITY;
+
+    /** Creates an arena with the given capacity in bytes. */
+    explicit FrameArena(size_t capacity = DEFAULT_CAPACITY);
+    ~FrameArena();
+
+    /**
+     * Allocates uninitialized memory for the rest of the frame.
+     *
+     * @param size The size in bytes.
+     * @param alignment The alignment in bytes, it must be a power of two.
+     */
+    void* allocate(size_t size, size_t alignment = 16);
+
+    /** Allocates an uninitialized array of count elements of type T. */
+    template <typename T>
+    T* allocateArray(size_t count)
+    {
+        return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    /** Constructs an object of type T in the arena. Its destructor won't be called. */
+    template <typename T, typename... Args>
+    T* create(Args&&... args)
+    {
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    /**
+     * Moves a callable into the arena and returns a function calling it.
+     * The returned function only holds a pointer, so storing it in a std::function doesn't
+     * allocate, unlike binding the arguments of a render callback directly. For instance:
+     * @code
+     * _customCommand.func = _director->getFrameArena()->makeCallback(CC_CALLBACK_0(MyNode::onDraw, this, transform, flags));
+     * @endcode
+     */
+    template <typename F>
+    std::function<void()> makeCallback(F&& callback)
+    {
+        typedef typename std::decay<F>::type Callable;
+        Callable* callable = create<Callable>(std::forward<F>(callback));
+        return [callable]() { (*callable)(); };
+    }
+
+    /**
+     * Releases everything allocated since the last reset.
+     * If the frame overflowed, the arena is reallocated to fit the high water mark.
+     */
+    void reset();
+
+    /** Returns the number of bytes allocated since the last reset, overflows included. */
+    size_t getUsedBytes() const { return _used + _overflowUsed; }
+
+    /** Returns the capacity of the arena in bytes. */
+    size_t getCapacity() const { return _capacity; }
+
+    /** Returns the most bytes used by a single frame. */
+    size_t getHighWaterMark() const { return _highWaterMark; }
+
+    /** Returns how many allocations had to be served from overflow blocks since the arena was created. */
+    unsigned int getOverflowCount() const { return _overflowCount; }
+
+protected:
+    void* allocateOverflow(size_t size, size_t alignment);
+
+    uint8_t* _buffer;
+    size_t _capacity;
+    size_t _used;
+
+    std::vector<uint8_t*> _overflowBlocks;
+    size_t _overflowUsed;
+    unsigned int _overflowCount;
+    size_t _highWaterMark;
+
+private:
+    CC_DISALLOW_COPY_AND_ASSIGN(FrameArena);
+};
+
+NS_CC_END
+
+/** @} */
+#endif // __CCFRAMEARENA_H__
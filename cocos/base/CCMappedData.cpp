@@ -0,0 +1,207 @@
+/****************************************************************************
+ Copyright (c) 2015 Chukong Technologies Inc.
+
+ http://www.cocos2d-x.org
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ****************************************************************************/
+
+
+#include "base/CCMappedData.h"
+
+#include <stdlib.h>
+
+#if (CC_TARGET_PLATFORM != CC_PLATFORM_WIN32) && (CC_TARGET_PLATFORM != CC_PLATFORM_WINRT) && (CC_TARGET_PLATFORM != CC_PLATFORM_WP8)
+#define CC_MAPPED_DATA_USE_MMAP 1
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#define CC_MAPPED_DATA_USE_MMAP 0
+#endif
+
+NS_CC_BEGIN
+
+const ssize_t MappedData::MIN_MAPPED_SIZE = 16 * 1024;
+
+#if CC_MAPPED_DATA_USE_MMAP
+static int toMadvise(MappedData::Access access)
+{
+    switch (access)
+    {
+        case MappedData::Access::SEQUENTIAL:
+            return MADV_SEQUENTIAL;
+        case MappedData::Access::RANDOM:
+            return MADV_RANDOM;
+        case MappedData::Access::WILLNEED:
+            return MADV_WILLNEED;
+        default:
+            return MADV_NORMAL;
+    }
+}
+#endif
+
+MappedData::MappedData()
+: _bytes(nullptr)
+, _size(0)
+, _mapAddress(nullptr)
+{
+}
+
+MappedData::MappedData(MappedData&& other)
+: _bytes(nullptr)
+, _size(0)
+, _mapAddress(nullptr)
+{
+    move(other);
+}
+
+MappedData::~MappedData()
+{
+    clear();
+}
+
+MappedData& MappedData::operator= (MappedData&& other)
+{
+    if (this != &other)
+    {
+        clear();
+        move(other);
+    }
+    return *this;
+}
+
+void MappedData::move(MappedData& other)
+{
+    _bytes = other._bytes;
+    _size = other._size;
+    _mapAddress = other._mapAddress;
+    _data = std::move(other._data);
+
+    other._bytes = nullptr;
+    other._size = 0;
+    other._mapAddress = nullptr;
+}
+
+bool MappedData::initWithFile(const std::string& fullPath, Access access)
+{
+    clear();
+
+#if CC_MAPPED_DATA_USE_MMAP
+    int fd = open(fullPath.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+    {
+        close(fd);
+        return false;
+    }
+
+    ssize_t size = static_cast<ssize_t>(st.st_size);
+    if (size < MIN_MAPPED_SIZE)
+    {
+        // a mapping costs more than copying a few pages
+        unsigned char* buffer = static_cast<unsigned char*>(malloc(size > 0 ? size : 1));
+        ssize_t total = 0;
+        while (buffer && total < size)
+        {
+            ssize_t count = read(fd, buffer + total, size - total);
+            if (count <= 0)
+                break;
+            total += count;
+        }
+        close(fd);
+
+        if (buffer == nullptr || total != size)
+        {
+            free(buffer);
+            return false;
+        }
+        _data.fastSet(buffer, size);
+        _bytes = _data.getBytes();
+        _size = size;
+        return true;
+    }
+
+    void* address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps the file alive
+    close(fd);
+    if (address == MAP_FAILED)
+        return false;
+
+    _mapAddress = address;
+    _bytes = static_cast<const unsigned char*>(address);
+    _size = size;
+    advise(access);
+    return true;
+#else
+    CC_UNUSED_PARAM(fullPath);
+    CC_UNUSED_PARAM(access);
+    return false;
+#endif
+}
+
+void MappedData::initWithData(Data&& data)
+{
+    clear();
+    _data = std::move(data);
+    _bytes = _data.getBytes();
+    _size = _data.getSize();
+}
+
+void MappedData::advise(Access access)
+{
+#if CC_MAPPED_DATA_USE_MMAP
+    if (_mapAddress)
+    {
+        madvise(_mapAddress, _size, toMadvise(access));
+    }
+#else
+    CC_UNUSED_PARAM(access);
+#endif
+}
+
+Data MappedData::copyToData() const
+{
+    Data ret;
+    if (!isNull())
+    {
+        ret.copy(_bytes, _size);
+    }
+    return ret;
+}
+
+void MappedData::clear()
+{
+#if CC_MAPPED_DATA_USE_MMAP
+    if (_mapAddress)
+    {
+        munmap(_mapAddress, _size);
+    }
+#endif
+    _mapAddress = nullptr;
+    _bytes = nullptr;
+    _size = 0;
+    _data.clear();
+}
+
+NS_CC_END
@@ -0,0 +1,124 @@
+/****************************************************************************
+ Copyright (c) 2015 Chukong Technologies Inc.
+
+ http://www.cocos2d-x.org
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ****************************************************************************/
+
+
+#ifndef __CCMAPPEDDATA_H__
+#define __CCMAPPEDDATA_H__
+
+#include "base/CCData.h"
+
+/**
+ * @addtogroup base
+ * @js NA
+ * @lua NA
+ */
+NS_CC_BEGIN
+
+/**
+ MappedData is a read-only view of a file's contents.
+
+ Where the platform supports it, large files are memory mapped, so reading them costs no copy and no
+ heap allocation; the pages are loaded on first access. Small files, and platforms or file systems
+ without mmap (Windows, files inside the Android apk), are read into an owned buffer instead.
+ Either way, the bytes stay valid until the MappedData is destroyed, cleared or moved from.
+
+ MappedData can be moved but not copied. Use copyToData() when a writable copy is needed.
+ */
+class CC_DLL MappedData
+{
+public:
+    /** Access pattern hints, passed to madvise for mapped files. */
+    enum class Access
+    {
+        /** No particular pattern. */
+        NORMAL,
+        /** Read once from start to end, e.g. decoding an image. Pages are read ahead aggressively. */
+        SEQUENTIAL,
+        /** Read at random offsets, e.g. an archive. Read ahead is disabled. */
+        RANDOM,
+        /** The whole file will be read soon, start loading it now. */
+        WILLNEED
+    };
+
+    /** Files smaller than this are read rather than mapped. */
+    static const ssize_t MIN_MAPPED_SIZE;
+
+    MappedData();
+    MappedData(MappedData&& other);
+    ~MappedData();
+
+    MappedData& operator= (MappedData&& other);
+
+    /**
+     * Maps or reads a file.
+     *
+     * @param fullPath The absolute path of the file.
+     * @param access The expected access pattern.
+     * @return False if the file can't be opened, or can't be mapped on this platform.
+     */
+    bool initWithFile(const std::string& fullPath, Access access = Access::SEQUENTIAL);
+
+    /**
+     * Takes over the buffer of a Data.
+     *
+     * @param data The data, left null after the call.
+     */
+    void initWithData(Data&& data);
+
+    /** Gets the bytes of the file. They must not be written to. */
+    const unsigned char* getBytes() const { return _bytes; }
+
+    /** Gets the size of the file. */
+    ssize_t getSize() const { return _size; }
+
+    /** Checks whether there is no content. */
+    bool isNull() const { return _bytes == nullptr || _size == 0; }
+
+    /** Checks whether the content is memory mapped rather than held in a buffer. */
+    bool isMapped() const { return _mapAddress != nullptr; }
+
+    /** Changes the access pattern hint of a mapped file. Does nothing for buffered content. */
+    void advise(Access access);
+
+    /** Returns a copy of the content in a Data. */
+    Data copyToData() const;
+
+    /** Unmaps the file or frees the buffer. */
+    void clear();
+
+private:
+    CC_DISALLOW_COPY_AND_ASSIGN(MappedData);
+
+    void move(MappedData& other);
+
+    const unsigned char* _bytes;
+    ssize_t _size;
+    void* _mapAddress;
+    Data _data;
+};
+
+NS_CC_END
+
+/** @} */
+#endif // __CCMAPPEDDATA_H__
@@ -25,8 +25,27 @@ THE SOFTWARE.
 ****************************************************************************/
 #include "base/CCProfiling.h"
 
+#include <thread>
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
 using namespace std;
 
+// Storage class of the ring buffer pointer of each thread. Without thread local storage
+// the buffer of a thread is looked up by thread id, under the profiler lock.
+#if defined(_MSC_VER)
+    #define CC_PROFILER_THREAD_LOCAL __declspec(thread)
+#elif defined(__clang__)
+    #if __has_feature(cxx_thread_local)
+        #define CC_PROFILER_THREAD_LOCAL __thread
+    #endif
+#elif defined(__GNUC__)
+    #define CC_PROFILER_THREAD_LOCAL __thread
+#endif
+
+static_assert((CC_PROFILER_RING_BUFFER_SIZE & (CC_PROFILER_RING_BUFFER_SIZE - 1)) == 0, "CC_PROFILER_RING_BUFFER_SIZE must be a power of two");
+
 NS_CC_BEGIN
 
 // Profiling Categories
@@ -35,18 +54,108 @@ bool kProfilerCategorySprite = false;
 bool kProfilerCategoryBatchSprite = false;
 bool kProfilerCategoryParticles = false;
 
+static const Profiler::MarkerID INVALID_MARKER = static_cast<Profiler::MarkerID>(-1);
+// the capture stops growing past this, about 24MB
+static const size_t MAX_CAPTURED_BLOCKS = 1 << 20;
+
+// The events recorded by one thread. The owner thread is the only producer and the cocos thread,
+// in Profiler::endFrame(), the only consumer, so the ring buffer needs no lock. When it is full
+// the new events are dropped and counted.
+class ProfilerThreadBuffer
+{
+public:
+    enum EventType : unsigned short
+    {
+        BEGIN,
+        END
+    };
+
+    struct Event
+    {
+        long long time;
+        Profiler::MarkerID marker;
+        unsigned short depth;
+        unsigned short type;
+    };
+
+    struct OpenBlock
+    {
+        int node;
+        Profiler::MarkerID marker;
+        long long start;
+    };
+
+    ProfilerThreadBuffer(unsigned int index_, std::thread::id threadID_)
+    : index(index_)
+    , threadID(threadID_)
+    , depth(0)
+    , root(-1)
+    , head(0)
+    , tail(0)
+    , dropped(0)
+    {
+        char name_[32];
+        snprintf(name_, sizeof(name_), "thread %u", index);
+        name = name_;
+    }
+
+    void push(EventType type, Profiler::MarkerID marker, unsigned int eventDepth, long long time)
+    {
+        unsigned int position = head.load(std::memory_order_relaxed);
+        if (position - tail.load(std::memory_order_acquire) >= CC_PROFILER_RING_BUFFER_SIZE)
+        {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        Event& event = events[position & (CC_PROFILER_RING_BUFFER_SIZE - 1)];
+        event.time = time;
+        event.marker = marker;
+        event.depth = static_cast<unsigned short>(std::min(eventDepth, 0xffffu));
+        event.type = type;
+        head.store(position + 1, std::memory_order_release);
+    }
+
+    const unsigned int index;
+    const std::thread::id threadID;
+    std::string name;
+
+    // producer side: number of blocks opened and not closed yet
+    unsigned int depth;
 
-static Profiler* g_sSharedProfiler = nullptr;
+    // consumer side: root of the call tree and the blocks whose end is not drained yet
+    int root;
+    std::vector<OpenBlock> open;
+
+    std::atomic<unsigned int> head;
+    std::atomic<unsigned int> tail;
+    std::atomic<unsigned int> dropped;
+    Event events[CC_PROFILER_RING_BUFFER_SIZE];
+};
+
+#if defined(CC_PROFILER_THREAD_LOCAL)
+static CC_PROFILER_THREAD_LOCAL ProfilerThreadBuffer* s_threadBuffer = nullptr;
+#endif
+
+static std::atomic<Profiler*> g_sSharedProfiler(nullptr);
+static std::mutex g_sSharedProfilerMutex;
 
 Profiler* Profiler::getInstance()
 {
-    if (! g_sSharedProfiler)
+    Profiler* profiler = g_sSharedProfiler.load(std::memory_order_acquire);
+    if (! profiler)
     {
-        g_sSharedProfiler = new (std::nothrow) Profiler();
-        g_sSharedProfiler->init();
+        std::lock_guard<std::mutex> lock(g_sSharedProfilerMutex);
+        profiler = g_sSharedProfiler.load(std::memory_order_relaxed);
+        if (! profiler)
+        {
+            profiler = new (std::nothrow) Profiler();
+            profiler->init();
+            g_sSharedProfiler.store(profiler, std::memory_order_release);
+        }
     }
 
-    return g_sSharedProfiler;
+    return profiler;
 }
 
 // FIXME:: deprecated
@@ -55,37 +164,430 @@ Profiler* Profiler::sharedProfiler(void)
     return Profiler::getInstance();
 }
 
-ProfilingTimer* Profiler::createAndAddTimerWithName(const char* timerName)
+Profiler::Profiler()
+: _frames(0)
+, _droppedEvents(0)
+, _capturing(false)
+, _epoch(std::chrono::steady_clock::now())
 {
+}
+
+Profiler::~Profiler(void)
+{
+    for (auto buffer : _threadBuffers)
+    {
+        delete buffer;
+    }
+}
+
+bool Profiler::init()
+{
+    return true;
+}
+
+static inline long long elapsedNanoseconds(const std::chrono::steady_clock::time_point& epoch)
+{
+    return static_cast<long long>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - epoch).count());
+}
+
+Profiler::MarkerID Profiler::registerMarker(const char* markerName)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    auto iter = _markerIDs.find(markerName);
+    if (iter != _markerIDs.end())
+    {
+        return iter->second;
+    }
+
+    MarkerID marker = static_cast<MarkerID>(_markerNames.size());
+    _markerNames.push_back(markerName);
+    _markerIDs.emplace(markerName, marker);
+
     ProfilingTimer *t = new (std::nothrow) ProfilingTimer();
-    t->initWithName(timerName);
-    _activeTimers.insert(timerName, t);
+    t->initWithName(markerName);
+    _activeTimers.insert(markerName, t);
+    _markerTimers.push_back(t);
     t->release();
 
-    return t;
+    return marker;
 }
 
-void Profiler::releaseTimer(const char* timerName)
+ProfilerThreadBuffer* Profiler::getThreadBuffer()
 {
-    _activeTimers.erase(timerName);
+#if defined(CC_PROFILER_THREAD_LOCAL)
+    if (s_threadBuffer)
+    {
+        return s_threadBuffer;
+    }
+#endif
+
+    auto threadID = std::this_thread::get_id();
+    std::lock_guard<std::mutex> lock(_mutex);
+
+#if !defined(CC_PROFILER_THREAD_LOCAL)
+    for (auto buffer : _threadBuffers)
+    {
+        if (buffer->threadID == threadID)
+        {
+            return buffer;
+        }
+    }
+#endif
+
+    auto buffer = new (std::nothrow) ProfilerThreadBuffer(static_cast<unsigned int>(_threadBuffers.size()), threadID);
+    _threadBuffers.push_back(buffer);
+#if defined(CC_PROFILER_THREAD_LOCAL)
+    s_threadBuffer = buffer;
+#endif
+    return buffer;
 }
 
-void Profiler::releaseAllTimers()
+void Profiler::beginBlock(MarkerID marker)
 {
-    _activeTimers.clear();
+    auto buffer = getThreadBuffer();
+    unsigned int depth = buffer->depth++;
+
+    // should be the last instruction in order to be more reliable
+    buffer->push(ProfilerThreadBuffer::BEGIN, marker, depth, elapsedNanoseconds(_epoch));
 }
 
-bool Profiler::init()
+void Profiler::endBlock(MarkerID marker)
 {
-    return true;
+    // should be the 1st instruction in order to be more reliable
+    long long time = elapsedNanoseconds(_epoch);
+
+    auto buffer = getThreadBuffer();
+    CCASSERT(buffer->depth > 0, "Profiler: endBlock without beginBlock");
+    if (buffer->depth > 0)
+    {
+        buffer->push(ProfilerThreadBuffer::END, marker, --buffer->depth, time);
+    }
 }
 
-Profiler::~Profiler(void)
+int Profiler::getChildNode(int parent, MarkerID marker)
+{
+    int last = -1;
+    for (int child = _callNodes[parent].firstChild; child >= 0; child = _callNodes[child].nextSibling)
+    {
+        if (_callNodes[child].marker == marker)
+        {
+            return child;
+        }
+        last = child;
+    }
+
+    CallNode node;
+    memset(&node, 0, sizeof(node));
+    node.marker = marker;
+    node.parent = parent;
+    node.firstChild = -1;
+    node.nextSibling = -1;
+    node.depth = _callNodes[parent].depth + 1;
+
+    int index = static_cast<int>(_callNodes.size());
+    _callNodes.push_back(node);
+    if (last >= 0)
+    {
+        _callNodes[last].nextSibling = index;
+    }
+    else
+    {
+        _callNodes[parent].firstChild = index;
+    }
+    return index;
+}
+
+void Profiler::closeBlock(ProfilerThreadBuffer* buffer, int node, long long start, long long end)
 {
+    long long duration = end - start;
+
+    CallNode& callNode = _callNodes[node];
+    callNode.frameCalls++;
+    callNode.frameTime += duration;
+    _callNodes[callNode.parent].frameChildTime += duration;
+
+    _markerTimers[callNode.marker]->addSample(static_cast<long>(duration / 1000));
+
+    if (_capturing)
+    {
+        if (_capturedBlocks.size() < MAX_CAPTURED_BLOCKS)
+        {
+            CapturedBlock block = { callNode.marker, buffer->index, start, duration };
+            _capturedBlocks.push_back(block);
+        }
+        else
+        {
+            ++_droppedEvents;
+        }
+    }
+}
+
+void Profiler::drainThreadBuffer(ProfilerThreadBuffer* buffer)
+{
+    if (buffer->root < 0)
+    {
+        CallNode root;
+        memset(&root, 0, sizeof(root));
+        root.marker = INVALID_MARKER;
+        root.parent = -1;
+        root.firstChild = -1;
+        root.nextSibling = -1;
+        root.depth = -1;
+
+        buffer->root = static_cast<int>(_callNodes.size());
+        _callNodes.push_back(root);
+    }
+
+    auto& open = buffer->open;
+    unsigned int tail = buffer->tail.load(std::memory_order_relaxed);
+    unsigned int head = buffer->head.load(std::memory_order_acquire);
+
+    for (; tail != head; ++tail)
+    {
+        const auto& event = buffer->events[tail & (CC_PROFILER_RING_BUFFER_SIZE - 1)];
+        size_t depth = event.depth;
+
+        if (event.type == ProfilerThreadBuffer::BEGIN)
+        {
+            // a deeper block lost its end, or an enclosing block lost its beginning, to a full buffer
+            if (open.size() > depth)
+            {
+                open.resize(depth);
+            }
+            while (open.size() < depth)
+            {
+                ProfilerThreadBuffer::OpenBlock missing = { open.empty() ? buffer->root : open.back().node, INVALID_MARKER, event.time };
+                open.push_back(missing);
+            }
+
+            int parent = open.empty() ? buffer->root : open.back().node;
+            ProfilerThreadBuffer::OpenBlock block = { getChildNode(parent, event.marker), event.marker, event.time };
+            open.push_back(block);
+        }
+        else
+        {
+            if (open.size() > depth)
+            {
+                if (open[depth].marker == event.marker)
+                {
+                    closeBlock(buffer, open[depth].node, open[depth].start, event.time);
+                }
+                open.resize(depth);
+            }
+        }
+    }
+
+    buffer->tail.store(tail, std::memory_order_release);
+    _droppedEvents += buffer->dropped.exchange(0, std::memory_order_relaxed);
+}
+
+void Profiler::endFrame()
+{
+    auto cocosThread = getThreadBuffer();
+
+    for (auto& node : _callNodes)
+    {
+        node.frameCalls = 0;
+        node.frameTime = 0;
+        node.frameChildTime = 0;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (cocosThread->name != "cocos thread")
+        {
+            cocosThread->name = "cocos thread";
+        }
+
+        for (auto buffer : _threadBuffers)
+        {
+            drainThreadBuffer(buffer);
+        }
+    }
+
+    for (auto& node : _callNodes)
+    {
+        node.totalTime += node.frameTime;
+        node.totalCalls += node.frameCalls;
+        node.maxFrameTime = std::max(node.maxFrameTime, node.frameTime);
+    }
+
+    ++_frames;
+}
+
+std::string Profiler::getFrameReport() const
+{
+    std::string report;
+    char line[256];
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    snprintf(line, sizeof(line), "Profiler: %u frames, %u threads, %u dropped events\n", _frames, (unsigned int)_threadBuffers.size(), _droppedEvents);
+    report += line;
+    snprintf(line, sizeof(line), "%-48s %8s %10s %10s %10s %10s\n", "block", "calls", "frame ms", "self ms", "avg ms", "max ms");
+    report += line;
+
+    const double frames = _frames > 0 ? _frames : 1;
+    for (auto buffer : _threadBuffers)
+    {
+        if (buffer->root < 0 || _callNodes[buffer->root].firstChild < 0)
+        {
+            continue;
+        }
+
+        snprintf(line, sizeof(line), "[%s]\n", buffer->name.c_str());
+        report += line;
+
+        // depth first, children after their parent
+        std::vector<int> pending(1, _callNodes[buffer->root].firstChild);
+        while (! pending.empty())
+        {
+            int index = pending.back();
+            pending.pop_back();
+
+            const CallNode& node = _callNodes[index];
+            if (node.nextSibling >= 0)
+            {
+                pending.push_back(node.nextSibling);
+            }
+            if (node.firstChild >= 0)
+            {
+                pending.push_back(node.firstChild);
+            }
+
+            int indent = std::min(node.depth * 2 + 2, 24);
+            snprintf(line, sizeof(line), "%*s%-*s %8u %10.3f %10.3f %10.3f %10.3f\n",
+                     indent, "", 48 - indent, _markerNames[node.marker].c_str(),
+                     node.frameCalls,
+                     node.frameTime / 1000000.0,
+                     (node.frameTime - node.frameChildTime) / 1000000.0,
+                     node.totalTime / 1000000.0 / frames,
+                     node.maxFrameTime / 1000000.0);
+            report += line;
+        }
+    }
+
+    return report;
+}
+
+void Profiler::startCapture()
+{
+    _capturedBlocks.clear();
+    _capturing = true;
+}
+
+static void writeJSONString(FILE* fp, const std::string& str)
+{
+    fputc('"', fp);
+    for (auto c : str)
+    {
+        if (c == '"' || c == '\\')
+        {
+            fputc('\\', fp);
+            fputc(c, fp);
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            fprintf(fp, "\\u%04x", c);
+        }
+        else
+        {
+            fputc(c, fp);
+        }
+    }
+    fputc('"', fp);
+}
+
+bool Profiler::stopCapture(const std::string& filename)
+{
+    _capturing = false;
+
+    FILE* fp = fopen(filename.c_str(), "w");
+    if (! fp)
+    {
+        CCLOG("Profiler: can't write the capture to %s", filename.c_str());
+        _capturedBlocks.clear();
+        return false;
+    }
+
+    fputs("{\"traceEvents\":[\n", fp);
+
+    bool first = true;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        for (auto buffer : _threadBuffers)
+        {
+            fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":", first ? "" : ",\n", buffer->index);
+            writeJSONString(fp, buffer->name);
+            fputs("}}", fp);
+            first = false;
+        }
+
+        // complete events, timestamps in microseconds
+        for (const auto& block : _capturedBlocks)
+        {
+            fputs(first ? "{\"name\":" : ",\n{\"name\":", fp);
+            writeJSONString(fp, _markerNames[block.marker]);
+            fprintf(fp, ",\"cat\":\"cocos2d\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                    block.thread, block.start / 1000.0, block.duration / 1000.0);
+            first = false;
+        }
+    }
+
+    fputs("\n],\"displayTimeUnit\":\"ms\"}\n", fp);
+    bool succeed = ferror(fp) == 0;
+    fclose(fp);
+
+    _capturedBlocks.clear();
+    _capturedBlocks.shrink_to_fit();
+    return succeed;
+}
+
+ProfilingTimer* Profiler::createAndAddTimerWithName(const char* timerName)
+{
+    MarkerID marker = registerMarker(timerName);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _markerTimers[marker];
+}
+
+void Profiler::releaseTimer(const char* timerName)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    ProfilingTimer* timer = _activeTimers.at(timerName);
+    if (timer)
+    {
+        timer->reset();
+    }
+}
+
+void Profiler::releaseAllTimers()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    for (auto timer : _markerTimers)
+    {
+        timer->reset();
+    }
+
+    // the blocks still open are forgotten, their ends are ignored
+    _callNodes.clear();
+    for (auto buffer : _threadBuffers)
+    {
+        buffer->root = -1;
+        buffer->open.clear();
+    }
+    _frames = 0;
+    _droppedEvents = 0;
 }
 
 void Profiler::displayTimers()
 {
+    std::lock_guard<std::mutex> lock(_mutex);
+
     for (auto iter = _activeTimers.begin(); iter != _activeTimers.end(); ++iter)
     {
         ProfilingTimer* timer = iter->second;
@@ -135,50 +637,34 @@ void ProfilingTimer::reset()
     _startTime = chrono::high_resolution_clock::now();
 }
 
-void ProfilingBeginTimingBlock(const char *timerName)
+void ProfilingTimer::addSample(long duration)
 {
-    Profiler* p = Profiler::getInstance();
-    ProfilingTimer* timer = p->_activeTimers.at(timerName);
-    if( ! timer )
-    {
-        timer = p->createAndAddTimerWithName(timerName);
-    }
+    numberOfCalls++;
+    totalTime += duration;
+    _averageTime1 = (_averageTime1 + duration) / 2.0f;
+    _averageTime2 = totalTime / numberOfCalls;
+    maxTime = MAX( maxTime, duration);
+    minTime = MIN( minTime, duration);
+}
 
-    timer->numberOfCalls++;
+// The name based functions (and CC_PROFILER_START/STOP) look the marker up on every call, so any name works.
+// CC_PROFILER_SCOPE is cheaper for constant names.
 
-    // should be the last instruction in order to be more reliable
-    timer->_startTime = chrono::high_resolution_clock::now();
+void ProfilingBeginTimingBlock(const char *timerName)
+{
+    Profiler* p = Profiler::getInstance();
+    p->beginBlock(p->registerMarker(timerName));
 }
 
 void ProfilingEndTimingBlock(const char *timerName)
 {
-    // should be the 1st instruction in order to be more reliable
-    auto now = chrono::high_resolution_clock::now();
-
     Profiler* p = Profiler::getInstance();
-    ProfilingTimer* timer = p->_activeTimers.at(timerName);
-
-    CCASSERT(timer, "CCProfilingTimer  not found");
-
-
-    long duration = static_cast<long>(chrono::duration_cast<chrono::microseconds>(now - timer->_startTime).count());
-
-    timer->totalTime += duration;
-    timer->_averageTime1 = (timer->_averageTime1 + duration) / 2.0f;
-    timer->_averageTime2 = timer->totalTime / timer->numberOfCalls;
-    timer->maxTime = MAX( timer->maxTime, duration);
-    timer->minTime = MIN( timer->minTime, duration);
+    p->endBlock(p->registerMarker(timerName));
 }
 
 void ProfilingResetTimingBlock(const char *timerName)
 {
-    Profiler* p = Profiler::getInstance();
-    ProfilingTimer *timer = p->_activeTimers.at(timerName);
-
-    CCASSERT(timer, "CCProfilingTimer not found");
-
-    timer->reset();
+    Profiler::getInstance()->releaseTimer(timerName);
 }
 
 NS_CC_END
-
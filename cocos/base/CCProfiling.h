@@ -30,6 +30,10 @@ THE SOFTWARE.
 
 #include <string>
 #include <chrono>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
 #include "base/ccConfig.h"
 #include "base/CCRef.h"
 #include "base/CCMap.h"
@@ -42,16 +46,35 @@ NS_CC_BEGIN
  */
 
 class ProfilingTimer;
+class ProfilerThreadBuffer;
 
 /** Profiler
  cocos2d builtin profiler.
 
  To use it, enable set the CC_ENABLE_PROFILERS=1 in the ccConfig.h file
+
+ Blocks are identified by markers: names registered once with registerMarker() and referenced by id
+ afterwards, so that timing a block never looks up a string. Every thread records the beginning and
+ the end of its blocks in its own ring buffer without locking. Once per frame the Director calls
+ endFrame(), which drains the buffers on the cocos thread, rebuilds the nesting of the blocks and
+ aggregates them in one call tree per thread.
+
+ The call trees can be printed with getFrameReport() or the "profiler" console command, and the
+ blocks closed between startCapture() and stopCapture() are written in the Chrome trace-event
+ format, which can be opened in chrome://tracing.
  */
 
 class CC_DLL Profiler : public Ref
 {
 public:
+    /** Id of a marker, returned by registerMarker(). */
+    typedef unsigned int MarkerID;
+
+    /**
+     * @js NA
+     * @lua NA
+     */
+    Profiler();
     /**
      * @js NA
      * @lua NA
@@ -81,23 +104,116 @@ public:
      */
     CC_DEPRECATED_ATTRIBUTE static Profiler* sharedProfiler(void);
 
+    /** Returns the id of the marker named markerName, registering it the first time.
+     The id never changes, callers timing a block with a constant name should keep it
+     (CC_PROFILER_SCOPE keeps it in a function local static).
+     Thread safe.
+     * @js NA
+     * @lua NA
+     */
+    MarkerID registerMarker(const char* markerName);
+    /** Records the beginning of a block on the calling thread.
+     * @js NA
+     * @lua NA
+     */
+    void beginBlock(MarkerID marker);
+    /** Records the end of the innermost block opened by the calling thread. marker must be the one passed to beginBlock().
+     * @js NA
+     * @lua NA
+     */
+    void endBlock(MarkerID marker);
+
+    /** Drains the ring buffers of all the threads and aggregates the blocks closed since the previous call.
+     Called by the Director at the end of every frame, from the cocos thread.
+     * @js NA
+     * @lua NA
+     */
+    void endFrame();
+    /** Returns the call tree of every thread with the times of the last frame and the averages since the last reset.
+     Cocos thread only.
+     * @js NA
+     * @lua NA
+     */
+    std::string getFrameReport() const;
+
+    /** Starts recording the blocks closed from now on for the Chrome trace export. Cocos thread only.
+     * @js NA
+     * @lua NA
+     */
+    void startCapture();
+    /** Stops the capture and writes the recorded blocks to filename as Chrome trace-event JSON. Cocos thread only.
+     * @js NA
+     * @lua NA
+     */
+    bool stopCapture(const std::string& filename);
+    /**
+     * @js NA
+     * @lua NA
+     */
+    bool isCapturing() const { return _capturing; }
+
     /** Creates and adds a new timer 
      * @js NA
      * @lua NA
      */
     ProfilingTimer* createAndAddTimerWithName(const char* timerName);
-    /** releases a timer 
+    /** resets a timer. Markers are never unregistered, their id may be kept by the callers.
      * @js NA
      * @lua NA
      */
     void releaseTimer(const char* timerName);
-    /** releases all timers 
+    /** resets all timers and the call trees
      * @js NA
      * @lua NA
      */
     void releaseAllTimers();
 
     Map<std::string, ProfilingTimer*> _activeTimers;
+
+protected:
+    // a node of the call tree of one thread: one per distinct path of nested markers
+    struct CallNode
+    {
+        MarkerID marker;
+        int parent;
+        int firstChild;
+        int nextSibling;
+        int depth;
+        unsigned int frameCalls;
+        long long frameTime;        // nanoseconds, children included
+        long long frameChildTime;
+        long long totalTime;
+        long long maxFrameTime;
+        unsigned long long totalCalls;
+    };
+
+    struct CapturedBlock
+    {
+        MarkerID marker;
+        unsigned int thread;
+        long long start;            // nanoseconds since the profiler was created
+        long long duration;
+    };
+
+    ProfilerThreadBuffer* getThreadBuffer();
+    void drainThreadBuffer(ProfilerThreadBuffer* buffer);
+    void closeBlock(ProfilerThreadBuffer* buffer, int node, long long start, long long end);
+    int getChildNode(int parent, MarkerID marker);
+
+    // guards the markers and the list of thread buffers, which any thread may extend
+    mutable std::mutex _mutex;
+    std::unordered_map<std::string, MarkerID> _markerIDs;
+    std::vector<std::string> _markerNames;
+    std::vector<ProfilingTimer*> _markerTimers;
+    std::vector<ProfilerThreadBuffer*> _threadBuffers;
+
+    // only touched by the cocos thread
+    std::vector<CallNode> _callNodes;
+    std::vector<CapturedBlock> _capturedBlocks;
+    unsigned int _frames;
+    unsigned int _droppedEvents;
+    std::atomic<bool> _capturing;
+    std::chrono::steady_clock::time_point _epoch;
 };
 
 class ProfilingTimer : public Ref
@@ -135,6 +251,12 @@ public:
      */
     void reset();
 
+    /** adds a closed block of duration microseconds to the statistics
+     * @js NA
+     * @lua NA
+     */
+    void addSample(long duration);
+
     std::string _nameStr;
     std::chrono::high_resolution_clock::time_point _startTime;
     long _averageTime1;
@@ -145,6 +267,25 @@ public:
     long numberOfCalls;
 };
 
+/** Times the enclosing scope with a marker registered with Profiler::registerMarker(). */
+class CC_DLL ProfilingScope
+{
+public:
+    explicit ProfilingScope(Profiler::MarkerID marker)
+    : _marker(marker)
+    {
+        Profiler::getInstance()->beginBlock(marker);
+    }
+
+    ~ProfilingScope()
+    {
+        Profiler::getInstance()->endBlock(_marker);
+    }
+
+private:
+    Profiler::MarkerID _marker;
+};
+
 extern void CC_DLL ProfilingBeginTimingBlock(const char *timerName);
 extern void CC_DLL ProfilingEndTimingBlock(const char *timerName);
 extern void CC_DLL ProfilingResetTimingBlock(const char *timerName);
@@ -29,8 +29,27 @@ THE SOFTWARE.
 #include "platform/CCPlatformMacros.h"
 #include "base/ccConfig.h"
 
+#include <new>
+
 #define CC_REF_LEAK_DETECTION 0
 
+/** @def CC_USE_ALLOCATOR_SLAB
+ * Declares the new and delete operators of a Ref subclass that is allocated from its own slab allocator.
+ * Put it in a public section of the class, and CC_IMPLEMENT_ALLOCATOR_SLAB from
+ * base/allocator/CCAllocatorStrategySlab.h in its source file.
+ * Subclasses inherit the operators, their instances are allocated from the global allocator.
+ * It does nothing unless CC_ENABLE_ALLOCATOR_SLAB is set.
+ */
+#if CC_ENABLE_ALLOCATOR_SLAB
+#define CC_USE_ALLOCATOR_SLAB(T) \
+    static void* operator new (size_t size); \
+    static void* operator new (size_t size, const std::nothrow_t&) throw(); \
+    static void operator delete (void* object, size_t size); \
+    static void operator delete (void* object, const std::nothrow_t&) throw();
+#else
+#define CC_USE_ALLOCATOR_SLAB(T)
+#endif
+
 /**
  * @addtogroup base
  * @{
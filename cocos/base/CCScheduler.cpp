@@ -31,6 +31,7 @@ THE SOFTWARE.
 #include "base/utlist.h"
 #include "base/ccCArray.h"
 #include "base/CCScriptSupport.h"
+#include "base/CCProfiling.h"
 
 NS_CC_BEGIN
 
@@ -65,9 +66,194 @@ typedef struct _hashSelectorEntry
     Timer               *currentTimer;
     bool                currentTimerSalvaged;
     bool                paused;
+    int                 wheelTimerCount;    // timers of this target kept in the timer wheel
+    Timer               *parkedTimers;      // wheel timers that came due while the target was paused
+    double              pausedAt;           // scheduler time when the target was paused
+    double              pausedTime;         // total scheduler time spent paused
     UT_hash_handle      hh;
 } tHashTimerEntry;
 
+// Hierarchical timing wheel used for timers with an interval.
+//
+// Deadlines are counted in ticks of 1/TICKS_PER_SECOND seconds of scheduler time. The first level
+// has one slot per tick for the next 256 ticks, each of the next levels has 64 slots covering 64
+// times the range of the level below. When the current tick wraps a level, the matching slot of the
+// level above is redistributed ("cascaded") to the lower levels. Timers of an expired slot are moved
+// to the due list, which the scheduler re-evaluates against the exact time on every update.
+class TimerWheel
+{
+public:
+    static const int TICKS_PER_SECOND = 128;
+
+    explicit TimerWheel(double now)
+    : _currentTick(toTick(now))
+    , _due(nullptr)
+    {
+        memset(_level0, 0, sizeof(_level0));
+        memset(_levels, 0, sizeof(_levels));
+    }
+
+    static long long toTick(double time)
+    {
+        return (long long)floor(time * TICKS_PER_SECOND);
+    }
+
+    static void link(Timer **list, Timer *timer)
+    {
+        timer->_wheelPrev = nullptr;
+        timer->_wheelNext = *list;
+        if (*list)
+            (*list)->_wheelPrev = timer;
+        *list = timer;
+        timer->_wheelList = list;
+    }
+
+    static void unlink(Timer *timer)
+    {
+        if (timer->_wheelList == nullptr)
+            return;
+
+        if (timer->_wheelPrev)
+            timer->_wheelPrev->_wheelNext = timer->_wheelNext;
+        else
+            *timer->_wheelList = timer->_wheelNext;
+        if (timer->_wheelNext)
+            timer->_wheelNext->_wheelPrev = timer->_wheelPrev;
+
+        timer->_wheelPrev = timer->_wheelNext = nullptr;
+        timer->_wheelList = nullptr;
+    }
+
+    void add(Timer *timer, double deadline)
+    {
+        timer->_wheelDeadlineTick = toTick(deadline);
+        place(timer);
+    }
+
+    void addDue(Timer *timer)
+    {
+        link(&_due, timer);
+    }
+
+    // Moves the timers of every slot that expired up to 'now' to the due list.
+    void advance(double now)
+    {
+        long long target = toTick(now);
+        if (target - _currentTick > FULL_RANGE_LEVEL1)
+        {
+            // long hitch: cheaper to let every timer re-evaluate than to walk all the ticks
+            _currentTick = target;
+            for (auto& slot : _level0)
+                spliceToDue(&slot);
+            for (auto& level : _levels)
+                for (auto& slot : level)
+                    spliceToDue(&slot);
+            return;
+        }
+
+        while (_currentTick < target)
+        {
+            long long tick = ++_currentTick;
+            if ((tick & LEVEL0_MASK) == 0)
+            {
+                int index1 = (int)((tick >> LEVEL0_BITS) & LEVEL_MASK);
+                if (index1 == 0)
+                {
+                    int index2 = (int)((tick >> (LEVEL0_BITS + LEVEL_BITS)) & LEVEL_MASK);
+                    if (index2 == 0)
+                        cascade(&_levels[2][(tick >> (LEVEL0_BITS + 2 * LEVEL_BITS)) & LEVEL_MASK]);
+                    cascade(&_levels[1][index2]);
+                }
+                cascade(&_levels[0][index1]);
+            }
+            spliceToDue(&_level0[tick & LEVEL0_MASK]);
+        }
+    }
+
+    // Moves the due timers to 'list'.
+    void takeDue(Timer **list)
+    {
+        while (_due)
+        {
+            Timer *timer = _due;
+            unlink(timer);
+            link(list, timer);
+        }
+    }
+
+private:
+    static const int LEVEL0_BITS = 8;
+    static const int LEVEL_BITS = 6;
+    static const long long LEVEL0_MASK = (1 << LEVEL0_BITS) - 1;
+    static const long long LEVEL_MASK = (1 << LEVEL_BITS) - 1;
+    static const long long FULL_RANGE_LEVEL0 = 1LL << LEVEL0_BITS;
+    static const long long FULL_RANGE_LEVEL1 = 1LL << (LEVEL0_BITS + LEVEL_BITS);
+    static const long long FULL_RANGE_LEVEL2 = 1LL << (LEVEL0_BITS + 2 * LEVEL_BITS);
+    static const long long FULL_RANGE_LEVEL3 = 1LL << (LEVEL0_BITS + 3 * LEVEL_BITS);
+
+    void place(Timer *timer)
+    {
+        long long deadline = timer->_wheelDeadlineTick;
+        long long delta = deadline - _currentTick;
+
+        if (delta <= 0)
+        {
+            link(&_due, timer);
+        }
+        else if (delta < FULL_RANGE_LEVEL0)
+        {
+            link(&_level0[deadline & LEVEL0_MASK], timer);
+        }
+        else if (delta < FULL_RANGE_LEVEL1)
+        {
+            link(&_levels[0][(deadline >> LEVEL0_BITS) & LEVEL_MASK], timer);
+        }
+        else if (delta < FULL_RANGE_LEVEL2)
+        {
+            link(&_levels[1][(deadline >> (LEVEL0_BITS + LEVEL_BITS)) & LEVEL_MASK], timer);
+        }
+        else
+        {
+            // farther than the wheel reaches: come back at its end and re-evaluate then
+            if (delta >= FULL_RANGE_LEVEL3)
+            {
+                deadline = _currentTick + FULL_RANGE_LEVEL3 - 1;
+                timer->_wheelDeadlineTick = deadline;
+            }
+            link(&_levels[2][(deadline >> (LEVEL0_BITS + 2 * LEVEL_BITS)) & LEVEL_MASK], timer);
+        }
+    }
+
+    void cascade(Timer **slot)
+    {
+        Timer *list = *slot;
+        *slot = nullptr;
+        while (list)
+        {
+            Timer *timer = list;
+            list = timer->_wheelNext;
+            timer->_wheelPrev = timer->_wheelNext = nullptr;
+            timer->_wheelList = nullptr;
+            place(timer);
+        }
+    }
+
+    void spliceToDue(Timer **slot)
+    {
+        while (*slot)
+        {
+            Timer *timer = *slot;
+            unlink(timer);
+            link(&_due, timer);
+        }
+    }
+
+    long long _currentTick;
+    Timer *_due;
+    Timer *_level0[1 << LEVEL0_BITS];
+    Timer *_levels[3][1 << LEVEL_BITS];
+};
+
 // implementation Timer
 
 Timer::Timer()
@@ -79,6 +265,14 @@ Timer::Timer()
 , _repeat(0)
 , _delay(0.0f)
 , _interval(0.0f)
+, _inTimerWheel(false)
+, _wheelPrev(nullptr)
+, _wheelNext(nullptr)
+, _wheelList(nullptr)
+, _wheelDeadlineTick(0)
+, _wheelLastTouch(0)
+, _wheelPausedTimeAtTouch(0)
+, _timerEntry(nullptr)
 {
 }
 
@@ -255,6 +449,9 @@ Scheduler::Scheduler(void)
 , _currentTarget(nullptr)
 , _currentTargetSalvaged(false)
 , _updateHashLocked(false)
+, _timerWheel(nullptr)
+, _timerWheelEnabled(CC_ENABLE_SCHEDULER_TIMER_WHEEL != 0)
+, _timerClock(0)
 #if CC_ENABLE_SCRIPT_BINDING
 , _scriptHandlerEntries(20)
 #endif
@@ -266,6 +463,61 @@ Scheduler::Scheduler(void)
 Scheduler::~Scheduler(void)
 {
     unscheduleAll();
+    CC_SAFE_DELETE(_timerWheel);
+}
+
+void Scheduler::addToTimerWheel(_hashSelectorEntry *element, Timer *timer)
+{
+    if (_timerWheel == nullptr)
+    {
+        _timerWheel = new (std::nothrow) TimerWheel(_timerClock);
+    }
+
+    timer->_inTimerWheel = true;
+    timer->_timerEntry = element;
+    timer->_wheelLastTouch = _timerClock;
+    timer->_wheelPausedTimeAtTouch = element->pausedTime;
+    element->wheelTimerCount++;
+
+    // the first update() only starts the timer, same as on the per frame path
+    _timerWheel->addDue(timer);
+}
+
+void Scheduler::removeFromTimerWheel(_hashSelectorEntry *element, Timer *timer)
+{
+    if (timer->_inTimerWheel)
+    {
+        TimerWheel::unlink(timer);
+        timer->_inTimerWheel = false;
+        timer->_timerEntry = nullptr;
+        element->wheelTimerCount--;
+    }
+}
+
+void Scheduler::setTimerEntryPaused(_hashSelectorEntry *element, bool paused)
+{
+    if (element->paused == paused)
+    {
+        return;
+    }
+
+    element->paused = paused;
+    if (paused)
+    {
+        element->pausedAt = _timerClock;
+    }
+    else
+    {
+        element->pausedTime += _timerClock - element->pausedAt;
+
+        // the timers parked while paused are evaluated again on the next update
+        while (element->parkedTimers)
+        {
+            Timer *timer = element->parkedTimers;
+            TimerWheel::unlink(timer);
+            _timerWheel->addDue(timer);
+        }
+    }
 }
 
 void Scheduler::removeHashElement(_hashSelectorEntry *element)
@@ -297,6 +549,7 @@ void Scheduler::schedule(const ccSchedulerFunc& callback, void *target, float in
 
         // Is this the 1st element ? Then set the pause level to all the selectors of this target
         element->paused = paused;
+        element->pausedAt = _timerClock;
     }
     else
     {
@@ -317,6 +570,12 @@ void Scheduler::schedule(const ccSchedulerFunc& callback, void *target, float in
             {
                 CCLOG("CCScheduler#scheduleSelector. Selector already scheduled. Updating interval from: %.4f to %.4f", timer->getInterval(), interval);
                 timer->setInterval(interval);
+                if (timer->_inTimerWheel)
+                {
+                    // its deadline was computed from the old interval
+                    TimerWheel::unlink(timer);
+                    _timerWheel->addDue(timer);
+                }
                 return;
             }        
         }
@@ -327,6 +586,11 @@ void Scheduler::schedule(const ccSchedulerFunc& callback, void *target, float in
     timer->initWithCallback(this, callback, target, key, interval, repeat, delay);
     ccArrayAppendObject(element->timers, timer);
     timer->release();
+
+    if (_timerWheelEnabled && interval > 0)
+    {
+        addToTimerWheel(element, timer);
+    }
 }
 
 void Scheduler::unschedule(const std::string &key, void *target)
@@ -357,6 +621,7 @@ void Scheduler::unschedule(const std::string &key, void *target)
                     element->currentTimerSalvaged = true;
                 }
 
+                removeFromTimerWheel(element, timer);
                 ccArrayRemoveObjectAtIndex(element->timers, i, true);
 
                 // update timerIndex in case we are in tick:, looping over the actions
@@ -653,6 +918,13 @@ void Scheduler::unscheduleAllForTarget(void *target)
             element->currentTimer->retain();
             element->currentTimerSalvaged = true;
         }
+        if (element->wheelTimerCount > 0)
+        {
+            for (int i = 0; i < element->timers->num; ++i)
+            {
+                removeFromTimerWheel(element, static_cast<Timer*>(element->timers->arr[i]));
+            }
+        }
         ccArrayRemoveAllObjects(element->timers);
 
         if (_currentTarget == element)
@@ -701,7 +973,7 @@ void Scheduler::resumeTarget(void *target)
     HASH_FIND_PTR(_hashForTimers, &target, element);
     if (element)
     {
-        element->paused = false;
+        setTimerEntryPaused(element, false);
     }
 
     // update selector
@@ -723,7 +995,7 @@ void Scheduler::pauseTarget(void *target)
     HASH_FIND_PTR(_hashForTimers, &target, element);
     if (element)
     {
-        element->paused = true;
+        setTimerEntryPaused(element, true);
     }
 
     // update selector
@@ -772,7 +1044,7 @@ std::set<void*> Scheduler::pauseAllTargetsWithMinPriority(int minPriority)
     for(tHashTimerEntry *element = _hashForTimers; element != nullptr;
         element = (tHashTimerEntry*)element->hh.next)
     {
-        element->paused = true;
+        setTimerEntryPaused(element, true);
         idsWithSelectors.insert(element->target);
     }
 
@@ -830,6 +1102,8 @@ void Scheduler::performFunctionInCocosThread(const std::function<void ()> &funct
 // main loop
 void Scheduler::update(float dt)
 {
+    CC_PROFILER_SCOPE("Scheduler - update");
+
     _updateHashLocked = true;
 
     if (_timeScale != 1.0f)
@@ -837,6 +1111,8 @@ void Scheduler::update(float dt)
         dt *= _timeScale;
     }
 
+    _timerClock += dt;
+
     //
     // Selector callbacks
     //
@@ -877,12 +1153,18 @@ void Scheduler::update(float dt)
         _currentTarget = elt;
         _currentTargetSalvaged = false;
 
-        if (! _currentTarget->paused)
+        // targets whose timers are all in the timer wheel have nothing to do here
+        if (! _currentTarget->paused && elt->wheelTimerCount < elt->timers->num)
         {
             // The 'timers' array may change while inside this loop
             for (elt->timerIndex = 0; elt->timerIndex < elt->timers->num; ++(elt->timerIndex))
             {
-                elt->currentTimer = (Timer*)(elt->timers->arr[elt->timerIndex]);
+                Timer *timer = (Timer*)(elt->timers->arr[elt->timerIndex]);
+                if (timer->_inTimerWheel)
+                {
+                    continue;
+                }
+                elt->currentTimer = timer;
                 elt->currentTimerSalvaged = false;
 
                 elt->currentTimer->update(dt);
@@ -909,6 +1191,13 @@ void Scheduler::update(float dt)
             removeHashElement(_currentTarget);
         }
     }
+    _currentTarget = nullptr;
+
+    // Timers kept in the timer wheel, only the due ones are touched
+    if (_timerWheel)
+    {
+        updateTimerWheel(dt);
+    }
 
     // delete all updates that are marked for deletion
     // updates with priority < 0
@@ -982,6 +1271,67 @@ void Scheduler::update(float dt)
     }
 }
 
+void Scheduler::updateTimerWheel(float dt)
+{
+    _timerWheel->advance(_timerClock);
+
+    // Timers scheduled or made due by the callbacks below are evaluated on the next update
+    Timer *due = nullptr;
+    _timerWheel->takeDue(&due);
+
+    while (due)
+    {
+        Timer *timer = due;
+        TimerWheel::unlink(timer);
+        tHashTimerEntry *element = timer->_timerEntry;
+
+        if (element->paused)
+        {
+            // paused time doesn't count, see setTimerEntryPaused()
+            TimerWheel::link(&element->parkedTimers, timer);
+            continue;
+        }
+
+        // the time this timer would have accumulated on the per frame path
+        float elapsed = (float)(_timerClock - timer->_wheelLastTouch - (element->pausedTime - timer->_wheelPausedTimeAtTouch));
+        float threshold = timer->_useDelay ? timer->_delay : timer->_interval;
+
+        if (timer->_elapsed != -1 && timer->_elapsed + elapsed < threshold)
+        {
+            // not due yet, it only shared a slot with due timers
+            _timerWheel->add(timer, _timerClock + (threshold - timer->_elapsed - elapsed));
+            continue;
+        }
+
+        _currentTarget = element;
+        _currentTargetSalvaged = false;
+        element->currentTimer = timer;
+        element->currentTimerSalvaged = false;
+
+        timer->update(elapsed);
+
+        if (element->currentTimerSalvaged)
+        {
+            // unscheduled from its own callback, see the per frame path above
+            timer->release();
+        }
+        else
+        {
+            timer->_wheelLastTouch = _timerClock;
+            timer->_wheelPausedTimeAtTouch = element->pausedTime;
+            threshold = timer->_useDelay ? timer->_delay : timer->_interval;
+            _timerWheel->add(timer, _timerClock + (threshold - timer->_elapsed));
+        }
+        element->currentTimer = nullptr;
+
+        if (_currentTargetSalvaged && element->timers->num == 0)
+        {
+            removeHashElement(element);
+        }
+        _currentTarget = nullptr;
+    }
+}
+
 void Scheduler::schedule(SEL_SCHEDULE selector, Ref *target, float interval, unsigned int repeat, float delay, bool paused)
 {
     CCASSERT(target, "Argument target must be non-nullptr");
@@ -998,6 +1348,7 @@ void Scheduler::schedule(SEL_SCHEDULE selector, Ref *target, float interval, uns
         
         // Is this the 1st element ? Then set the pause level to all the selectors of this target
         element->paused = paused;
+        element->pausedAt = _timerClock;
     }
     else
     {
@@ -1018,6 +1369,12 @@ void Scheduler::schedule(SEL_SCHEDULE selector, Ref *target, float interval, uns
             {
                 CCLOG("CCScheduler#scheduleSelector. Selector already scheduled. Updating interval from: %.4f to %.4f", timer->getInterval(), interval);
                 timer->setInterval(interval);
+                if (timer->_inTimerWheel)
+                {
+                    // its deadline was computed from the old interval
+                    TimerWheel::unlink(timer);
+                    _timerWheel->addDue(timer);
+                }
                 return;
             }
         }
@@ -1028,6 +1385,11 @@ void Scheduler::schedule(SEL_SCHEDULE selector, Ref *target, float interval, uns
     timer->initWithSelector(this, selector, target, interval, repeat, delay);
     ccArrayAppendObject(element->timers, timer);
     timer->release();
+
+    if (_timerWheelEnabled && interval > 0)
+    {
+        addToTimerWheel(element, timer);
+    }
 }
 
 void Scheduler::schedule(SEL_SCHEDULE selector, Ref *target, float interval, bool paused)
@@ -1098,6 +1460,7 @@ void Scheduler::unschedule(SEL_SCHEDULE selector, Ref *target)
                     element->currentTimerSalvaged = true;
                 }
                 
+                removeFromTimerWheel(element, timer);
                 ccArrayRemoveObjectAtIndex(element->timers, i, true);
                 
                 // update timerIndex in case we are in tick:, looping over the actions
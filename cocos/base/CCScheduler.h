@@ -39,6 +39,7 @@ THE SOFTWARE.
 NS_CC_BEGIN
 
 class Scheduler;
+class TimerWheel;
 
 typedef std::function<void(float)> ccSchedulerFunc;
 
@@ -73,6 +74,19 @@ protected:
     unsigned int _repeat; //0 = once, 1 is 2 x executed
     float _delay;
     float _interval;
+
+    // Timer wheel bookkeeping, only used while the Scheduler keeps this timer in its TimerWheel.
+    bool _inTimerWheel;
+    Timer* _wheelPrev;
+    Timer* _wheelNext;
+    Timer** _wheelList;                 // head of the slot, due or parked list the timer is linked in
+    long long _wheelDeadlineTick;
+    double _wheelLastTouch;             // scheduler time of the last update()
+    double _wheelPausedTimeAtTouch;     // paused time of the target at the last update()
+    struct _hashSelectorEntry* _timerEntry;
+
+    friend class Scheduler;
+    friend class TimerWheel;
 };
 
 
@@ -206,6 +220,20 @@ public:
     */
     inline void setTimeScale(float timeScale) { _timeScale = timeScale; }
 
+    /** Enables or disables the timer wheel backend for timers with an interval.
+     When enabled, timers scheduled afterwards with an interval greater than 0 are kept in a hierarchical
+     timing wheel, and update() only touches the timers that are due instead of every timer of every target.
+     Timers that were already scheduled keep the backend they were scheduled with.
+     Pause, resume, unschedule and the update priorities behave the same with both backends.
+     Default is CC_ENABLE_SCHEDULER_TIMER_WHEEL.
+     @since v3.6
+     */
+    void setTimerWheelEnabled(bool enabled) { _timerWheelEnabled = enabled; }
+    /** Returns whether new timers with an interval are scheduled in the timer wheel.
+     @see Scheduler::setTimerWheelEnabled()
+     */
+    bool isTimerWheelEnabled() const { return _timerWheelEnabled; }
+
     /** 'update' the scheduler.
      * You should NEVER call this method, unless you know what you are doing.
      * @lua NA
@@ -502,6 +530,13 @@ protected:
     void removeHashElement(struct _hashSelectorEntry *element);
     void removeUpdateFromHash(struct _listEntry *entry);
 
+    // timer wheel specific
+
+    void addToTimerWheel(struct _hashSelectorEntry *element, Timer *timer);
+    void removeFromTimerWheel(struct _hashSelectorEntry *element, Timer *timer);
+    void setTimerEntryPaused(struct _hashSelectorEntry *element, bool paused);
+    void updateTimerWheel(float dt);
+
     // update specific
 
     void priorityIn(struct _listEntry **list, const ccSchedulerFunc& callback, void *target, int priority, bool paused);
@@ -524,6 +559,11 @@ protected:
     bool _currentTargetSalvaged;
     // If true unschedule will not remove anything from a hash. Elements will only be marked for deletion.
     bool _updateHashLocked;
+
+    // Used for timers kept in the timer wheel
+    TimerWheel *_timerWheel;
+    bool _timerWheelEnabled;
+    double _timerClock;             // scaled time accumulated by update()
     
 #if CC_ENABLE_SCRIPT_BINDING
     Vector<SchedulerScriptHandlerEntry*> _scriptHandlerEntries;
@@ -0,0 +1,200 @@
+/****************************************************************************
+ Copyright (c) 2015 Chukong Technologies Inc.
+
+ http://www.cocos2d-x.org
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ****************************************************************************/
+
+
+#include "base/CCTouchSpatialIndex.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "2d/CCNode.h"
+#include "math/CCAffineTransform.h"
+
+NS_CC_BEGIN
+
+// a node covering more cells than this is tested on its own instead
+static const int MAX_CELLS_PER_NODE = 64;
+
+TouchSpatialIndex::TouchSpatialIndex(float cellSize)
+: _cellSize(cellSize)
+{
+}
+
+TouchSpatialIndex::~TouchSpatialIndex()
+{
+}
+
+void TouchSpatialIndex::insert(Node* node)
+{
+    auto result = _entries.insert(std::make_pair(node, Entry()));
+    if (result.second)
+    {
+        Entry& entry = result.first->second;
+        entry.bucketed = false;
+        entry.indexed = false;
+        entry.dirty = true;
+        _dirtyNodes.push_back(node);
+    }
+}
+
+void TouchSpatialIndex::remove(Node* node)
+{
+    auto iter = _entries.find(node);
+    if (iter == _entries.end())
+        return;
+
+    unlink(node, iter->second);
+    if (iter->second.dirty)
+    {
+        _dirtyNodes.erase(std::remove(_dirtyNodes.begin(), _dirtyNodes.end(), node), _dirtyNodes.end());
+    }
+    _entries.erase(iter);
+}
+
+void TouchSpatialIndex::setDirty(Node* node)
+{
+    auto iter = _entries.find(node);
+    if (iter != _entries.end() && !iter->second.dirty)
+    {
+        iter->second.dirty = true;
+        _dirtyNodes.push_back(node);
+    }
+}
+
+void TouchSpatialIndex::clear()
+{
+    _entries.clear();
+    _cells.clear();
+    _unbucketed.clear();
+    _dirtyNodes.clear();
+}
+
+void TouchSpatialIndex::query(const Vec2& point, std::vector<Node*>& result)
+{
+    refresh();
+
+    int x = (int)std::floor(point.x / _cellSize);
+    int y = (int)std::floor(point.y / _cellSize);
+    auto iter = _cells.find(cellKey(x, y));
+    if (iter != _cells.end())
+    {
+        for (auto node : iter->second)
+        {
+            if (_entries[node].bounds.containsPoint(point))
+                result.push_back(node);
+        }
+    }
+
+    for (auto node : _unbucketed)
+    {
+        const Entry& entry = _entries[node];
+        if (entry.bounds.size.width <= 0 || entry.bounds.size.height <= 0 || entry.bounds.containsPoint(point))
+            result.push_back(node);
+    }
+}
+
+void TouchSpatialIndex::refresh()
+{
+    for (auto node : _dirtyNodes)
+    {
+        Entry& entry = _entries[node];
+        unlink(node, entry);
+
+        const Size& size = node->getContentSize();
+        if (size.width > 0 && size.height > 0)
+        {
+            entry.bounds = RectApplyTransform(Rect(0, 0, size.width, size.height), node->getNodeToWorldTransform());
+        }
+        else
+        {
+            entry.bounds = Rect::ZERO;
+        }
+
+        link(node, entry);
+        entry.dirty = false;
+    }
+    _dirtyNodes.clear();
+}
+
+void TouchSpatialIndex::unlink(Node* node, Entry& entry)
+{
+    if (!entry.indexed)
+        return;
+
+    if (entry.bucketed)
+    {
+        for (int y = entry.minY; y <= entry.maxY; ++y)
+        {
+            for (int x = entry.minX; x <= entry.maxX; ++x)
+            {
+                auto iter = _cells.find(cellKey(x, y));
+                if (iter == _cells.end())
+                    continue;
+
+                auto& cell = iter->second;
+                cell.erase(std::find(cell.begin(), cell.end(), node));
+                if (cell.empty())
+                    _cells.erase(iter);
+            }
+        }
+    }
+    else
+    {
+        _unbucketed.erase(std::find(_unbucketed.begin(), _unbucketed.end(), node));
+    }
+    entry.indexed = false;
+}
+
+void TouchSpatialIndex::link(Node* node, Entry& entry)
+{
+    const Rect& bounds = entry.bounds;
+    entry.bucketed = false;
+    if (bounds.size.width > 0 && bounds.size.height > 0
+        && bounds.size.width * bounds.size.height <= MAX_CELLS_PER_NODE * _cellSize * _cellSize)
+    {
+        entry.minX = (int)std::floor(bounds.getMinX() / _cellSize);
+        entry.minY = (int)std::floor(bounds.getMinY() / _cellSize);
+        entry.maxX = (int)std::floor(bounds.getMaxX() / _cellSize);
+        entry.maxY = (int)std::floor(bounds.getMaxY() / _cellSize);
+        entry.bucketed = (entry.maxX - entry.minX + 1) * (entry.maxY - entry.minY + 1) <= MAX_CELLS_PER_NODE;
+    }
+
+    if (entry.bucketed)
+    {
+        for (int y = entry.minY; y <= entry.maxY; ++y)
+        {
+            for (int x = entry.minX; x <= entry.maxX; ++x)
+            {
+                _cells[cellKey(x, y)].push_back(node);
+            }
+        }
+    }
+    else
+    {
+        _unbucketed.push_back(node);
+    }
+    entry.indexed = true;
+}
+
+NS_CC_END
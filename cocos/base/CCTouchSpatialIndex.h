@@ -0,0 +1,111 @@
+/****************************************************************************
+ Copyright (c) 2015 Chukong Technologies Inc.
+
+ http://www.cocos2d-x.org
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ****************************************************************************/
+
+
+#ifndef __CCTOUCHSPATIALINDEX_H__
+#define __CCTOUCHSPATIALINDEX_H__
+
+#include <vector>
+#include <unordered_map>
+
+#include "platform/CCPlatformMacros.h"
+#include "math/CCGeometry.h"
+
+/**
+ * @addtogroup base
+ * @{
+ */
+
+NS_CC_BEGIN
+
+class Node;
+
+/**
+ TouchSpatialIndex is a uniform grid over the world space bounding boxes of the nodes that have
+ scene graph priority event listeners. EventDispatcher uses it to find the few listeners whose node
+ can contain a touch, instead of running every onTouchBegan hit test.
+
+ Bounds are refreshed lazily: nodes whose transform or content size changed are only marked dirty,
+ and their boxes are recomputed on the next query. Nodes with an empty content size can't be bounded
+ and are returned by every query, as are nodes spanning too many cells to be worth bucketing.
+ */
+class CC_DLL TouchSpatialIndex
+{
+public:
+    /** @param cellSize The size of a grid cell, in points. */
+    explicit TouchSpatialIndex(float cellSize = 128);
+    ~TouchSpatialIndex();
+
+    /** Starts tracking a node. Its bounds are computed on the next query. */
+    void insert(Node* node);
+
+    /** Stops tracking a node. */
+    void remove(Node* node);
+
+    /** Marks the bounds of a tracked node stale. */
+    void setDirty(Node* node);
+
+    /** Stops tracking all nodes. */
+    void clear();
+
+    /**
+     Collects the nodes whose bounds may contain a world space point, in no particular order.
+     @param point The point in world space.
+     @param result Receives the nodes. It is not cleared first.
+     */
+    void query(const Vec2& point, std::vector<Node*>& result);
+
+    /** Returns the number of tracked nodes. */
+    size_t size() const { return _entries.size(); }
+
+protected:
+    struct Entry
+    {
+        Rect bounds;
+        int minX, minY, maxX, maxY;
+        bool bucketed;  ///< stored in _cells, otherwise in _unbucketed
+        bool dirty;
+        bool indexed;   ///< present in _cells or _unbucketed
+    };
+
+    void refresh();
+    void unlink(Node* node, Entry& entry);
+    void link(Node* node, Entry& entry);
+
+    static long long cellKey(int x, int y) { return ((long long)x << 32) ^ (unsigned int)y; }
+
+    float _cellSize;
+    std::unordered_map<Node*, Entry> _entries;
+    std::unordered_map<long long, std::vector<Node*>> _cells;
+    std::vector<Node*> _unbucketed;
+    std::vector<Node*> _dirtyNodes;
+};
+
+NS_CC_END
+
+/**
+ end of base group
+ @}
+ */
+#endif // __CCTOUCHSPATIALINDEX_H__
@@ -37,9 +37,11 @@
 #include <stdlib.h>
 
 #include "base/CCData.h"
+#include "base/CCMappedData.h"
 #include "base/ccMacros.h"
 #include "platform/CCFileUtils.h"
 #include <map>
+#include <algorithm>
 
 // FIXME: Other platforms should use upstream minizip like mingw-w64  
 #ifdef MINIZIP_FROM_SYSTEM
@@ -686,4 +688,255 @@ bool ZipFile::initWithBuffer(const void *buffer, uLong size)
     return true;
 }
 
+// --------------------- ZipArchive ---------------------
+
+namespace
+{
+    const uint32_t ZIP_END_OF_CENTRAL_DIR_SIGNATURE = 0x06054b50;
+    const uint32_t ZIP_CENTRAL_DIR_SIGNATURE = 0x02014b50;
+    const uint32_t ZIP_LOCAL_HEADER_SIGNATURE = 0x04034b50;
+    const ssize_t ZIP_END_OF_CENTRAL_DIR_SIZE = 22;
+    const ssize_t ZIP_CENTRAL_DIR_HEADER_SIZE = 46;
+    const ssize_t ZIP_LOCAL_HEADER_SIZE = 30;
+    const ssize_t ZIP_MAX_COMMENT_SIZE = 0xffff;
+
+    const uint16_t ZIP_METHOD_STORED = 0;
+    const uint16_t ZIP_METHOD_DEFLATED = 8;
+    const uint16_t ZIP_FLAG_ENCRYPTED = 1;
+
+    // zip fields are little endian and not aligned
+    inline uint16_t readUInt16(const unsigned char *p)
+    {
+        return (uint16_t)(p[0] | (p[1] << 8));
+    }
+
+    inline uint32_t readUInt32(const unsigned char *p)
+    {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+}
+
+struct ZipArchiveEntry
+{
+    uint32_t localHeaderOffset;
+    uint32_t compressedSize;
+    uint32_t uncompressedSize;
+    uint16_t method;
+    uint16_t flags;
+};
+
+class ZipArchivePrivate
+{
+public:
+    MappedData mapping;
+
+    typedef std::unordered_map<std::string, ZipArchiveEntry> EntryContainer;
+    EntryContainer entries;
+
+    // returns the start of the entry's data, or nullptr if the entry doesn't fit in the archive
+    const unsigned char *getEntryData(const ZipArchiveEntry &entry) const
+    {
+        const unsigned char *base = mapping.getBytes();
+        ssize_t size = mapping.getSize();
+        ssize_t offset = entry.localHeaderOffset;
+        if (offset + ZIP_LOCAL_HEADER_SIZE > size || readUInt32(base + offset) != ZIP_LOCAL_HEADER_SIGNATURE)
+            return nullptr;
+
+        // the local extra field may differ from the central one
+        offset += ZIP_LOCAL_HEADER_SIZE + readUInt16(base + offset + 26) + readUInt16(base + offset + 28);
+        if (offset + (ssize_t)entry.compressedSize > size)
+            return nullptr;
+
+        return base + offset;
+    }
+};
+
+ZipArchive *ZipArchive::create(const std::string &zipFile)
+{
+    ZipArchive *archive = new (std::nothrow) ZipArchive();
+    if (archive && archive->initWithFile(zipFile))
+    {
+        return archive;
+    }
+    CC_SAFE_DELETE(archive);
+    return nullptr;
+}
+
+ZipArchive::ZipArchive()
+: _data(new ZipArchivePrivate)
+{
+}
+
+ZipArchive::~ZipArchive()
+{
+    CC_SAFE_DELETE(_data);
+}
+
+bool ZipArchive::initWithFile(const std::string &zipFile)
+{
+    if (!_data->mapping.initWithFile(zipFile, MappedData::Access::RANDOM))
+        return false;
+
+    const unsigned char *base = _data->mapping.getBytes();
+    ssize_t size = _data->mapping.getSize();
+    if (size < ZIP_END_OF_CENTRAL_DIR_SIZE)
+        return false;
+
+    // the end of central directory record is followed by a comment of up to 64k
+    ssize_t end = size - ZIP_END_OF_CENTRAL_DIR_SIZE;
+    ssize_t stop = std::max<ssize_t>(0, end - ZIP_MAX_COMMENT_SIZE);
+    for (; end >= stop; --end)
+    {
+        if (readUInt32(base + end) == ZIP_END_OF_CENTRAL_DIR_SIGNATURE)
+            break;
+    }
+    if (end < stop)
+        return false;
+
+    uint16_t entryCount = readUInt16(base + end + 10);
+    uint32_t directorySize = readUInt32(base + end + 12);
+    uint32_t directoryOffset = readUInt32(base + end + 16);
+    // zip64 archives store 0xffff / 0xffffffff here
+    if (entryCount == 0xffff || directoryOffset == 0xffffffff || (ssize_t)directoryOffset + (ssize_t)directorySize > end)
+        return false;
+
+    _data->entries.reserve(entryCount);
+
+    ssize_t offset = directoryOffset;
+    for (uint16_t i = 0; i < entryCount; ++i)
+    {
+        if (offset + ZIP_CENTRAL_DIR_HEADER_SIZE > end || readUInt32(base + offset) != ZIP_CENTRAL_DIR_SIGNATURE)
+            return false;
+
+        const unsigned char *header = base + offset;
+        uint16_t nameLength = readUInt16(header + 28);
+        uint16_t extraLength = readUInt16(header + 30);
+        uint16_t commentLength = readUInt16(header + 32);
+        if (offset + ZIP_CENTRAL_DIR_HEADER_SIZE + nameLength > end)
+            return false;
+
+        ZipArchiveEntry entry;
+        entry.flags = readUInt16(header + 8);
+        entry.method = readUInt16(header + 10);
+        entry.compressedSize = readUInt32(header + 20);
+        entry.uncompressedSize = readUInt32(header + 24);
+        entry.localHeaderOffset = readUInt32(header + 42);
+
+        std::string name((const char*)header + ZIP_CENTRAL_DIR_HEADER_SIZE, nameLength);
+        // skip directories, and stored entries whose sizes disagree, they would be read past their data
+        if (!name.empty() && name.back() != '/'
+            && (entry.method != ZIP_METHOD_STORED || entry.compressedSize == entry.uncompressedSize))
+        {
+            _data->entries[name] = entry;
+        }
+
+        offset += ZIP_CENTRAL_DIR_HEADER_SIZE + nameLength + extraLength + commentLength;
+    }
+
+    return true;
+}
+
+ssize_t ZipArchive::getFileCount() const
+{
+    return _data->entries.size();
+}
+
+bool ZipArchive::fileExists(const std::string &fileName) const
+{
+    return _data->entries.find(fileName) != _data->entries.end();
+}
+
+ssize_t ZipArchive::getFileSize(const std::string &fileName) const
+{
+    auto it = _data->entries.find(fileName);
+    if (it == _data->entries.end())
+        return -1;
+    return it->second.uncompressedSize;
+}
+
+const unsigned char *ZipArchive::getStoredFileData(const std::string &fileName, ssize_t *size) const
+{
+    const unsigned char *ret = nullptr;
+    if (size)
+        *size = 0;
+
+    do
+    {
+        auto it = _data->entries.find(fileName);
+        CC_BREAK_IF(it == _data->entries.end());
+
+        const ZipArchiveEntry &entry = it->second;
+        CC_BREAK_IF(entry.method != ZIP_METHOD_STORED || (entry.flags & ZIP_FLAG_ENCRYPTED));
+
+        ret = _data->getEntryData(entry);
+        if (ret && size)
+        {
+            *size = entry.uncompressedSize;
+        }
+    } while (0);
+
+    return ret;
+}
+
+unsigned char *ZipArchive::getFileData(const std::string &fileName, ssize_t *size) const
+{
+    unsigned char *buffer = nullptr;
+    if (size)
+        *size = 0;
+
+    do
+    {
+        auto it = _data->entries.find(fileName);
+        CC_BREAK_IF(it == _data->entries.end());
+
+        const ZipArchiveEntry &entry = it->second;
+        CC_BREAK_IF(entry.flags & ZIP_FLAG_ENCRYPTED);
+        CC_BREAK_IF(entry.method != ZIP_METHOD_STORED && entry.method != ZIP_METHOD_DEFLATED);
+
+        const unsigned char *source = _data->getEntryData(entry);
+        CC_BREAK_IF(!source);
+
+        // malloc(0) may return nullptr
+        buffer = (unsigned char*)malloc(entry.uncompressedSize > 0 ? entry.uncompressedSize : 1);
+        CC_BREAK_IF(!buffer);
+
+        if (entry.method == ZIP_METHOD_STORED)
+        {
+            memcpy(buffer, source, entry.uncompressedSize);
+        }
+        else
+        {
+            // raw deflate stream, every call has its own stream so threads don't share state
+            z_stream stream;
+            memset(&stream, 0, sizeof(stream));
+            stream.next_in = const_cast<Bytef*>(source);
+            stream.avail_in = entry.compressedSize;
+            stream.next_out = buffer;
+            stream.avail_out = entry.uncompressedSize;
+
+            int err = inflateInit2(&stream, -MAX_WBITS);
+            if (err == Z_OK)
+            {
+                err = inflate(&stream, Z_FINISH);
+                inflateEnd(&stream);
+            }
+
+            if (err != Z_STREAM_END || stream.total_out != entry.uncompressedSize)
+            {
+                CCLOG("cocos2d: ZipArchive: can't inflate %s", fileName.c_str());
+                free(buffer);
+                buffer = nullptr;
+                break;
+            }
+        }
+
+        if (size)
+        {
+            *size = entry.uncompressedSize;
+        }
+    } while (0);
+
+    return buffer;
+}
+
 NS_CC_END
@@ -291,6 +291,81 @@ typedef struct unz_file_info_s unz_file_info;
         /** Internal data like zip file pointer / file list array and so on */
         ZipFilePrivate *_data;
     };
+
+    // forward declaration
+    class ZipArchivePrivate;
+
+    /**
+    * Zip archive - persistent, memory mapped reader for large asset packs.
+    *
+    * The archive is mapped once and its central directory is indexed in a hash table, so locating an entry
+    * doesn't touch the file system. Stored (uncompressed) entries can be accessed in place without any copy,
+    * and deflated entries are inflated straight from the mapping.
+    *
+    * All the reading methods are const and keep no per call state, so they can be used concurrently
+    * from loader threads.
+    *
+    * @note Zip64 and encrypted archives aren't supported; create() returns nullptr for the former,
+    *       and encrypted entries can't be read.
+    */
+    class CC_DLL ZipArchive
+    {
+    public:
+        /**
+        * Opens and indexes a zip archive.
+        *
+        * @param zipFile The absolute path of the archive.
+        * @return The archive, or nullptr if it can't be opened. The caller deletes it.
+        */
+        static ZipArchive *create(const std::string &zipFile);
+
+        ~ZipArchive();
+
+        /** Gets the number of entries in the archive. */
+        ssize_t getFileCount() const;
+
+        /**
+        * Check does a file exists or not in the archive.
+        *
+        * @param fileName File to be checked on existance
+        * @return true whenever file exists, false otherwise
+        */
+        bool fileExists(const std::string &fileName) const;
+
+        /**
+        * Gets the uncompressed size of an entry.
+        *
+        * @param fileName File name
+        * @return The size, or -1 if there is no such entry.
+        */
+        ssize_t getFileSize(const std::string &fileName) const;
+
+        /**
+        * Gets the bytes of a stored entry in place.
+        *
+        * @param fileName File name
+        * @param[out] size If the entry is stored, it will be the data size, otherwise 0.
+        * @return The bytes, valid as long as the archive, or nullptr if the entry is missing or compressed.
+        */
+        const unsigned char *getStoredFileData(const std::string &fileName, ssize_t *size) const;
+
+        /**
+        * Get resource file data from the archive, inflating it if needed.
+        * @param fileName File name
+        * @param[out] size If the file read operation succeeds, it will be the data size, otherwise 0.
+        * @return Upon success, a pointer to the data is returned, otherwise nullptr.
+        * @warning Recall: you are responsible for calling free() on any Non-nullptr pointer returned.
+        */
+        unsigned char *getFileData(const std::string &fileName, ssize_t *size) const;
+
+    private:
+        ZipArchive();
+
+        bool initWithFile(const std::string &zipFile);
+
+        /** Internal data like the mapping and the entry index */
+        ZipArchivePrivate *_data;
+    };
 } // end of namespace cocos2d
 
 // end group
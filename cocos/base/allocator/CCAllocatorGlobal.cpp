@@ -26,7 +26,7 @@
 
 #include "base/allocator/CCAllocatorGlobal.h"
 
-#if CC_ENABLE_ALLOCATOR
+#if CC_ENABLE_ALLOCATOR || CC_ENABLE_ALLOCATOR_SLAB
 
 NS_CC_BEGIN
 NS_CC_ALLOCATOR_BEGIN
@@ -37,4 +37,4 @@ CC_ALLOCATOR_GLOBAL ccAllocatorGlobal;
 NS_CC_ALLOCATOR_END
 NS_CC_END
 
-#endif // CC_ENABLE_ALLOCATOR
+#endif // CC_ENABLE_ALLOCATOR || CC_ENABLE_ALLOCATOR_SLAB
@@ -0,0 +1,349 @@
+/****************************************************************************
+ Copyright (c) 2015 Chukong Technologies Inc.
+ 
+ http://www.cocos2d-x.org
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ****************************************************************************/
+
+#ifndef CC_ALLOCATOR_STRATEGY_SLAB_H
+#define CC_ALLOCATOR_STRATEGY_SLAB_H
+/// @cond DO_NOT_SHOW
+
+/****************************************************************************
+                                    WARNING!
+     Do not use Console::log or any other methods that use NEW inside of this
+     allocator. Failure to do so will result in recursive memory allocation.
+ ****************************************************************************/
+
+#include "base/allocator/CCAllocatorMacros.h"
+
+// @brief CC_ALLOCATOR_THREAD_LOCAL
+// Storage class for the per thread caches of the slab allocators. It stays undefined
+// on toolchains without thread_local objects with destructors, which are needed to return
+// the cached blocks when a thread exits. The slab allocators then always lock.
+#if defined(_MSC_VER)
+    #if _MSC_VER >= 1900
+        #define CC_ALLOCATOR_THREAD_LOCAL __declspec(thread)
+    #endif
+#elif defined(__clang__)
+    #if __has_feature(cxx_thread_local)
+        #define CC_ALLOCATOR_THREAD_LOCAL __thread
+    #endif
+#elif defined(__GNUC__)
+    #if __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 8)
+        #define CC_ALLOCATOR_THREAD_LOCAL __thread
+    #endif
+#endif
+
+#if CC_ENABLE_ALLOCATOR_SLAB
+
+#include <new>
+#include <atomic>
+#include <sstream>
+
+#include "base/allocator/CCAllocatorGlobal.h"
+#include "base/allocator/CCAllocatorStrategyFixedBlock.h"
+#include "base/allocator/CCAllocatorDiagnostics.h"
+
+NS_CC_BEGIN
+NS_CC_ALLOCATOR_BEGIN
+
+// @brief
+// Free blocks kept by one thread for one slab allocator.
+// Must stay a POD so that it can be declared CC_ALLOCATOR_THREAD_LOCAL.
+struct AllocatorSlabThreadCache
+{
+    void* list;
+    size_t count;
+
+    // set when the cache is registered with the thread's AllocatorSlabThreadExit
+    bool registered;
+    AllocatorSlabThreadCache* next;
+    void* owner;
+    void (*release)(void* owner, AllocatorSlabThreadCache* cache);
+};
+
+#if defined(CC_ALLOCATOR_THREAD_LOCAL)
+// @brief
+// Returns the blocks of the registered thread caches to their allocators when the thread exits.
+struct AllocatorSlabThreadExit
+{
+    AllocatorSlabThreadCache* caches;
+
+    AllocatorSlabThreadExit()
+        : caches(nullptr)
+    {}
+
+    ~AllocatorSlabThreadExit()
+    {
+        // objects destroyed by a release may register a cache again
+        while (caches)
+        {
+            AllocatorSlabThreadCache* cache = caches;
+            caches = cache->next;
+            cache->registered = false;
+            cache->release(cache->owner, cache);
+        }
+    }
+
+    // @brief Registers a cache of the calling thread, done when it is first filled.
+    static void add(AllocatorSlabThreadCache* cache)
+    {
+        static thread_local AllocatorSlabThreadExit threadExit;
+        cache->next = threadExit.caches;
+        threadExit.caches = cache;
+        cache->registered = true;
+    }
+};
+#endif
+
+// @brief
+// Slab allocator strategy for the objects of one class, see CC_USE_ALLOCATOR_SLAB.
+// Blocks are carved from pages of the fixed block strategy and handed out through a
+// per thread cache, so that creating and destroying objects on the same thread
+// only takes the lock once every kThreadCacheBatch blocks.
+// Requests for any other size, e.g. from subclasses, go to the global allocator.
+// @param _block_size the size of the objects allocated by this allocator.
+template <size_t _block_size>
+class AllocatorStrategySlab
+    : public AllocatorStrategyFixedBlock<_block_size, AllocatorBase::kDefaultAlignment, locking_semantics>
+{
+public:
+
+    typedef AllocatorStrategyFixedBlock<_block_size, AllocatorBase::kDefaultAlignment, locking_semantics> tParentStrategy;
+
+    // number of blocks moved between a thread cache and the shared free list at once.
+    static const size_t kThreadCacheBatch = CC_ALLOCATOR_SLAB_THREAD_CACHE_SIZE / 2 > 0 ? CC_ALLOCATOR_SLAB_THREAD_CACHE_SIZE / 2 : 1;
+
+    // @brief Returns a new slab allocator that is never destroyed, objects may outlive static destructors.
+    // @param pageSize the number of blocks reserved at once.
+    static AllocatorStrategySlab* create(const char* tag, size_t pageSize = CC_ALLOCATOR_SLAB_PAGE_SIZE)
+    {
+        void* address = ccAllocatorGlobal.allocate(sizeof(AllocatorStrategySlab));
+        return new (address) AllocatorStrategySlab(tag, pageSize);
+    }
+
+    // @brief
+    // Allocates a block, from the thread cache if one is given and not empty,
+    // refilling it from the shared free list otherwise.
+    CC_ALLOCATOR_INLINE void* allocate(size_t size, AllocatorSlabThreadCache* cache)
+    {
+        if (_block_size != size)
+        {
+            return ccAllocatorGlobal.allocate(size);
+        }
+
+        void* block;
+        if (nullptr == cache)
+        {
+            tParentStrategy::lock();
+            block = tParentStrategy::pop_front();
+            tParentStrategy::unlock();
+        }
+        else
+        {
+            if (nullptr == cache->list)
+            {
+                registerThreadCache(cache);
+                tParentStrategy::lock();
+                for (size_t i = 0; i < kThreadCacheBatch; ++i)
+                {
+                    void* b = tParentStrategy::pop_front();
+                    *(void**)b = cache->list;
+                    cache->list = b;
+                }
+                tParentStrategy::unlock();
+                cache->count = kThreadCacheBatch;
+            }
+            block = cache->list;
+            cache->list = *(void**)block;
+            --cache->count;
+        }
+
+#if CC_ENABLE_ALLOCATOR_DIAGNOSTICS
+        size_t live = ++_live;
+        if (live > _highestLive)
+            _highestLive = live;
+#endif
+        return block;
+    }
+
+    // @brief
+    // Deallocates a block into the thread cache if one is given,
+    // returning half of the cache to the shared free list when it grows too large.
+    CC_ALLOCATOR_INLINE void deallocate(void* address, size_t size, AllocatorSlabThreadCache* cache)
+    {
+        if (nullptr == address)
+            return;
+
+        if (_block_size != size)
+        {
+            ccAllocatorGlobal.deallocate(address, size);
+            return;
+        }
+
+#if CC_ENABLE_ALLOCATOR_DIAGNOSTICS
+        --_live;
+#endif
+
+        if (nullptr == cache)
+        {
+            tParentStrategy::lock();
+            tParentStrategy::push_front(address);
+            tParentStrategy::unlock();
+            return;
+        }
+
+        if (nullptr == cache->list)
+        {
+            registerThreadCache(cache);
+        }
+        *(void**)address = cache->list;
+        cache->list = address;
+        if (++cache->count > 2 * kThreadCacheBatch)
+        {
+            tParentStrategy::lock();
+            for (size_t i = 0; i < kThreadCacheBatch; ++i)
+            {
+                void* b = cache->list;
+                cache->list = *(void**)b;
+                tParentStrategy::push_front(b);
+            }
+            tParentStrategy::unlock();
+            cache->count -= kThreadCacheBatch;
+        }
+    }
+
+    // @brief Deallocates a block of unknown size, only used when a constructor throws.
+    CC_ALLOCATOR_INLINE void deallocate(void* address)
+    {
+        if (address && tParentStrategy::owns(address))
+        {
+            deallocate(address, _block_size, nullptr);
+        }
+        else
+        {
+            ccAllocatorGlobal.deallocate(address);
+        }
+    }
+
+#if CC_ENABLE_ALLOCATOR_DIAGNOSTICS
+    std::string diagnostics() const
+    {
+        std::stringstream s;
+        s << AllocatorBase::tag() << " block:" << _block_size << " page:" << tParentStrategy::_pageSize
+          << " live:" << _live << " highest:" << _highestLive
+          << " cached:" << tParentStrategy::_allocated - _live << "\n";
+        return s.str();
+    }
+#endif
+
+protected:
+
+    AllocatorStrategySlab(const char* tag, size_t pageSize)
+        : tParentStrategy(tag, pageSize)
+#if CC_ENABLE_ALLOCATOR_DIAGNOSTICS
+        , _live(0)
+        , _highestLive(0)
+#endif
+    {
+    }
+
+    CC_ALLOCATOR_INLINE void registerThreadCache(AllocatorSlabThreadCache* cache)
+    {
+#if defined(CC_ALLOCATOR_THREAD_LOCAL)
+        if (!cache->registered)
+        {
+            cache->owner = this;
+            cache->release = &releaseThreadCache;
+            AllocatorSlabThreadExit::add(cache);
+        }
+#endif
+    }
+
+    // returns all the blocks of a thread cache to the shared free list.
+    static void releaseThreadCache(void* owner, AllocatorSlabThreadCache* cache)
+    {
+        AllocatorStrategySlab* allocator = static_cast<AllocatorStrategySlab*>(owner);
+        allocator->lock();
+        while (cache->list)
+        {
+            void* b = cache->list;
+            cache->list = *(void**)b;
+            allocator->push_front(b);
+        }
+        allocator->unlock();
+        cache->count = 0;
+    }
+
+#if CC_ENABLE_ALLOCATOR_DIAGNOSTICS
+    // blocks handed out to objects, the parent's count also includes the thread caches.
+    std::atomic<size_t> _live;
+    size_t _highestLive;
+#endif
+};
+
+NS_CC_ALLOCATOR_END
+NS_CC_END
+
+#if defined(CC_ALLOCATOR_THREAD_LOCAL)
+    #define CC_ALLOCATOR_SLAB_THREAD_CACHE(T) \
+        static CC_ALLOCATOR_THREAD_LOCAL NS_CC_ALLOCATOR::AllocatorSlabThreadCache s_##T##SlabCache;
+    #define CC_ALLOCATOR_SLAB_THREAD_CACHE_PTR(T) (&s_##T##SlabCache)
+#else
+    #define CC_ALLOCATOR_SLAB_THREAD_CACHE(T)
+    #define CC_ALLOCATOR_SLAB_THREAD_CACHE_PTR(T) nullptr
+#endif
+
+// @brief helper macro defining the operators declared by CC_USE_ALLOCATOR_SLAB.
+// Use it once in the source file of the class, inside the cocos2d namespace, so that
+// a single allocator serves the whole program. It is tagged with the class name.
+#define CC_IMPLEMENT_ALLOCATOR_SLAB(T) \
+    CC_ALLOCATOR_SLAB_THREAD_CACHE(T) \
+    static NS_CC_ALLOCATOR::AllocatorStrategySlab<sizeof(T)>* T##SlabAllocator() \
+    { \
+        static auto allocator = NS_CC_ALLOCATOR::AllocatorStrategySlab<sizeof(T)>::create(#T); \
+        return allocator; \
+    } \
+    void* T::operator new (size_t size) \
+    { \
+        return T##SlabAllocator()->allocate(size, CC_ALLOCATOR_SLAB_THREAD_CACHE_PTR(T)); \
+    } \
+    void* T::operator new (size_t size, const std::nothrow_t&) throw() \
+    { \
+        return T##SlabAllocator()->allocate(size, CC_ALLOCATOR_SLAB_THREAD_CACHE_PTR(T)); \
+    } \
+    void T::operator delete (void* object, size_t size) \
+    { \
+        T##SlabAllocator()->deallocate(object, size, CC_ALLOCATOR_SLAB_THREAD_CACHE_PTR(T)); \
+    } \
+    void T::operator delete (void* object, const std::nothrow_t&) throw() \
+    { \
+        T##SlabAllocator()->deallocate(object); \
+    }
+
+#else
+
+#define CC_IMPLEMENT_ALLOCATOR_SLAB(...)
+
+#endif // CC_ENABLE_ALLOCATOR_SLAB
+
+/// @endcond
+#endif//CC_ALLOCATOR_STRATEGY_SLAB_H
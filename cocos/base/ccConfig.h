@@ -233,8 +233,9 @@ THE SOFTWARE.
 #endif
 
 /** @def CC_ENABLE_PROFILERS
- * If enabled, will activate various profilers within cocos2d. This statistical data will be output to the console
- * once per second showing average time (in milliseconds) required to execute the specific routine(s).
+ * If enabled, will activate various profilers within cocos2d. The timed blocks are aggregated once per frame in
+ * a call tree per thread, which can be printed with the "profiler" console command or exported in the Chrome
+ * trace-event format.
  * Useful for debugging purposes only. It is recommended to leave it disabled.
  * To enable set it to a value different than 0. Disabled by default.
  */
@@ -242,6 +243,53 @@ THE SOFTWARE.
 #define CC_ENABLE_PROFILERS 0
 #endif
 
+/** @def CC_PROFILER_RING_BUFFER_SIZE
+ * Number of events (the beginning or the end of a block) each thread can record between two frames
+ * before the profiler drops them. Must be a power of two.
+ */
+#ifndef CC_PROFILER_RING_BUFFER_SIZE
+#define CC_PROFILER_RING_BUFFER_SIZE 4096
+#endif
+
+/** @def CC_ENABLE_RENDERER_PARALLEL_FILL
+ * If enabled, the renderer transforms the vertices of big batches on a pool of worker threads.
+ * It can also be changed at runtime with Renderer::setParallelFillEnabled().
+ * Disabled by default.
+ */
+#ifndef CC_ENABLE_RENDERER_PARALLEL_FILL
+#define CC_ENABLE_RENDERER_PARALLEL_FILL 0
+#endif
+
+/** @def CC_RENDERER_PARALLEL_FILL_THRESHOLD
+ * The minimum number of vertices a batch needs before its fill is split across worker threads.
+ * Smaller batches are cheaper to fill on the rendering thread than to hand over to the workers.
+ */
+#ifndef CC_RENDERER_PARALLEL_FILL_THRESHOLD
+#define CC_RENDERER_PARALLEL_FILL_THRESHOLD 8192
+#endif
+
+/** @def CC_ENABLE_RENDERER_STREAMING_BUFFERS
+ * If enabled, the renderer streams batched quads and triangles through a triple buffered ring
+ * (see StreamingVertexBuffer) instead of orphaning and re-uploading the whole vertex buffer on every flush.
+ * The vertices are written directly into mapped GPU storage when the driver supports it.
+ * Buffer mapping and sync objects vary a lot between drivers, so projects should only enable it after
+ * checking it on the devices they target.
+ * Disabled by default.
+ */
+#ifndef CC_ENABLE_RENDERER_STREAMING_BUFFERS
+#define CC_ENABLE_RENDERER_STREAMING_BUFFERS 0
+#endif
+
+/** @def CC_ENABLE_SCHEDULER_TIMER_WHEEL
+ * If enabled, timers scheduled with an interval are kept in a hierarchical timing wheel, so that
+ * Scheduler::update() only touches the timers that are due.
+ * It can also be changed at runtime with Scheduler::setTimerWheelEnabled().
+ * Disabled by default.
+ */
+#ifndef CC_ENABLE_SCHEDULER_TIMER_WHEEL
+#define CC_ENABLE_SCHEDULER_TIMER_WHEEL 0
+#endif
+
 /** Enable Lua engine debug log. */
 #ifndef CC_LUA_ENGINE_DEBUG
 #define CC_LUA_ENGINE_DEBUG 0
@@ -332,6 +380,28 @@ THE SOFTWARE.
 # define CC_ENABLE_ALLOCATOR_GLOBAL_NEW_DELETE 0
 # endif//CC_ENABLE_ALLOCATOR_GLOBAL_NEW_DELETE
 
+/** @def CC_ENABLE_ALLOCATOR_SLAB
+ * Turn on the slab allocators of the classes that use CC_USE_ALLOCATOR_SLAB,
+ * e.g. Sprite, EventCustom, CallFunc and Sequence.
+ */
+#ifndef CC_ENABLE_ALLOCATOR_SLAB
+# define CC_ENABLE_ALLOCATOR_SLAB CC_ENABLE_ALLOCATOR
+#endif
+
+/** @def CC_ALLOCATOR_SLAB_THREAD_CACHE_SIZE
+ * Number of free blocks each thread keeps per slab allocator before returning them to the shared list.
+ */
+#ifndef CC_ALLOCATOR_SLAB_THREAD_CACHE_SIZE
+# define CC_ALLOCATOR_SLAB_THREAD_CACHE_SIZE 32
+#endif
+
+/** @def CC_ALLOCATOR_SLAB_PAGE_SIZE
+ * Number of blocks the slab allocators reserve at once when they run out of free blocks.
+ */
+#ifndef CC_ALLOCATOR_SLAB_PAGE_SIZE
+# define CC_ALLOCATOR_SLAB_PAGE_SIZE 64
+#endif
+
 /** @def CC_ALLOCATOR_GLOBAL
  * Specify allocator to use for global allocator.
  */
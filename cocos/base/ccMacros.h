@@ -209,6 +209,15 @@ It should work same as apples CFSwapInt32LittleToHost(..)
 #define CC_PROFILER_DISPLAY_TIMERS() NS_CC::Profiler::getInstance()->displayTimers()
 #define CC_PROFILER_PURGE_ALL() NS_CC::Profiler::getInstance()->releaseAllTimers()
 
+#define CC_PROFILER_END_FRAME() NS_CC::Profiler::getInstance()->endFrame()
+
+// __name__ must be a constant string: CC_PROFILER_SCOPE registers its marker id once per call site
+#define CC_PROFILER_MARKER_CONCAT_(__a__, __b__) __a__##__b__
+#define CC_PROFILER_MARKER_CONCAT(__a__, __b__) CC_PROFILER_MARKER_CONCAT_(__a__, __b__)
+#define CC_PROFILER_SCOPE(__name__) \
+    static const NS_CC::Profiler::MarkerID CC_PROFILER_MARKER_CONCAT(__ccProfilerMarker, __LINE__) = NS_CC::Profiler::getInstance()->registerMarker(__name__); \
+    NS_CC::ProfilingScope CC_PROFILER_MARKER_CONCAT(__ccProfilerScope, __LINE__)(CC_PROFILER_MARKER_CONCAT(__ccProfilerMarker, __LINE__))
+
 #define CC_PROFILER_START(__name__) NS_CC::ProfilingBeginTimingBlock(__name__)
 #define CC_PROFILER_STOP(__name__) NS_CC::ProfilingEndTimingBlock(__name__)
 #define CC_PROFILER_RESET(__name__) NS_CC::ProfilingResetTimingBlock(__name__)
@@ -226,7 +235,9 @@ It should work same as apples CFSwapInt32LittleToHost(..)
 
 #define CC_PROFILER_DISPLAY_TIMERS() do {} while (0)
 #define CC_PROFILER_PURGE_ALL() do {} while (0)
+#define CC_PROFILER_END_FRAME() do {} while (0)
 
+#define CC_PROFILER_SCOPE(__name__) do {} while (0)
 #define CC_PROFILER_START(__name__)  do {} while (0)
 #define CC_PROFILER_STOP(__name__) do {} while (0)
 #define CC_PROFILER_RESET(__name__) do {} while (0)
@@ -32,6 +32,7 @@
 #include <spine/spine-cocos2dx.h>
 #include <spine/extension.h>
 #include <spine/PolygonBatch.h>
+#include "base/CCFrameArena.h"
 #include <algorithm>
 
 USING_NS_CC;
@@ -145,7 +146,7 @@ void SkeletonRenderer::update (float deltaTime) {
 
 void SkeletonRenderer::draw (Renderer* renderer, const Mat4& transform, uint32_t transformFlags) {
 	_drawCommand.init(_globalZOrder);
-	_drawCommand.func = CC_CALLBACK_0(SkeletonRenderer::drawSkeleton, this, transform, transformFlags);
+	_drawCommand.func = _director->getFrameArena()->makeCallback(CC_CALLBACK_0(SkeletonRenderer::drawSkeleton, this, transform, transformFlags));
 	renderer->addCommand(&_drawCommand);
 }
 
@@ -19,6 +19,9 @@ This file was modified to fit the cocos2d-x project
 */
 
 #include "MathUtil.h"
+
+#include <cmath>
+
 #include "base/ccMacros.h"
 
 #if (CC_TARGET_PLATFORM == CC_PLATFORM_ANDROID)
@@ -275,4 +278,36 @@ void MathUtil::crossVec3(const float* v1, const float* v2, float* dst)
 #endif
 }
 
+void MathUtil::addScaledArray(float* dst, const float* src, float scale, int count)
+{
+#ifdef USE_NEON32
+    MathUtilNeon::addScaledArray(dst, src, scale, count);
+#elif defined (USE_NEON64)
+    MathUtilNeon64::addScaledArray(dst, src, scale, count);
+#elif defined (INCLUDE_NEON32)
+    if(isNeon32Enabled()) MathUtilNeon::addScaledArray(dst, src, scale, count);
+    else MathUtilC::addScaledArray(dst, src, scale, count);
+#elif defined (USE_SSE)
+    MathUtilSSE::addScaledArray(dst, src, scale, count);
+#else
+    MathUtilC::addScaledArray(dst, src, scale, count);
+#endif
+}
+
+void MathUtil::normalizeVec2Array(const float* x, const float* y, float* dstX, float* dstY, int count)
+{
+#ifdef USE_NEON32
+    MathUtilNeon::normalizeVec2Array(x, y, dstX, dstY, count);
+#elif defined (USE_NEON64)
+    MathUtilNeon64::normalizeVec2Array(x, y, dstX, dstY, count);
+#elif defined (INCLUDE_NEON32)
+    if(isNeon32Enabled()) MathUtilNeon::normalizeVec2Array(x, y, dstX, dstY, count);
+    else MathUtilC::normalizeVec2Array(x, y, dstX, dstY, count);
+#elif defined (USE_SSE)
+    MathUtilSSE::normalizeVec2Array(x, y, dstX, dstY, count);
+#else
+    MathUtilC::normalizeVec2Array(x, y, dstX, dstY, count);
+#endif
+}
+
 NS_CC_MATH_END
@@ -87,6 +87,29 @@ public:
      * @return interpolated float value
      */
     static float lerp(float from, float to, float alpha);
+
+    /**
+     * Adds a scaled array to another array, element by element:
+     * dst[i] += src[i] * scale.
+     *
+     * @param dst the array that is accumulated into.
+     * @param src the array whose elements are scaled and added.
+     * @param scale the factor applied to every element of src.
+     * @param count the number of elements in both arrays.
+     */
+    static void addScaledArray(float* dst, const float* src, float scale, int count);
+
+    /**
+     * Normalizes an array of 2D vectors whose components are stored in separate
+     * x and y arrays. Zero-length vectors are written as zero.
+     *
+     * @param x the x components of the vectors.
+     * @param y the y components of the vectors.
+     * @param dstX receives the x components of the normalized vectors.
+     * @param dstY receives the y components of the normalized vectors.
+     * @param count the number of vectors.
+     */
+    static void normalizeVec2Array(const float* x, const float* y, float* dstX, float* dstY, int count);
 private:
     //Indicates that if neon is enabled
     static bool isNeon32Enabled();
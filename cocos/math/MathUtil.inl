@@ -42,6 +42,10 @@ public:
     inline static void transformVec4(const float* m, const float* v, float* dst);
     
     inline static void crossVec3(const float* v1, const float* v2, float* dst);
+
+    inline static void addScaledArray(float* dst, const float* src, float scale, int count);
+
+    inline static void normalizeVec2Array(const float* x, const float* y, float* dstX, float* dstY, int count);
 };
 
 inline void MathUtilC::addMatrix(const float* m, float scalar, float* dst)
@@ -215,4 +219,31 @@ inline void MathUtilC::crossVec3(const float* v1, const float* v2, float* dst)
     dst[2] = z;
 }
 
+inline void MathUtilC::addScaledArray(float* dst, const float* src, float scale, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        dst[i] += src[i] * scale;
+    }
+}
+
+inline void MathUtilC::normalizeVec2Array(const float* x, const float* y, float* dstX, float* dstY, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        float lengthSq = x[i] * x[i] + y[i] * y[i];
+        if (lengthSq > 0.0f)
+        {
+            float inv = 1.0f / std::sqrt(lengthSq);
+            dstX[i] = x[i] * inv;
+            dstY[i] = y[i] * inv;
+        }
+        else
+        {
+            dstX[i] = 0.0f;
+            dstY[i] = 0.0f;
+        }
+    }
+}
+
 NS_CC_MATH_END
@@ -17,6 +17,8 @@
 
  This file was modified to fit the cocos2d-x project
  */
+#include <arm_neon.h>
+
 NS_CC_MATH_BEGIN
 
 class MathUtilNeon
@@ -41,6 +43,10 @@ public:
     inline static void transformVec4(const float* m, const float* v, float* dst);
     
     inline static void crossVec3(const float* v1, const float* v2, float* dst);
+
+    inline static void addScaledArray(float* dst, const float* src, float scale, int count);
+
+    inline static void normalizeVec2Array(const float* x, const float* y, float* dstX, float* dstY, int count);
 };
 
 inline void MathUtilNeon::addMatrix(const float* m, float scalar, float* dst)
@@ -268,4 +274,48 @@ inline void MathUtilNeon::crossVec3(const float* v1, const float* v2, float* dst
                  );
 }
 
+inline void MathUtilNeon::addScaledArray(float* dst, const float* src, float scale, int count)
+{
+    float32x4_t s = vdupq_n_f32(scale);
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        // dst = dst + src * s
+        vst1q_f32(dst + i, vmlaq_f32(vld1q_f32(dst + i), vld1q_f32(src + i), s));
+    }
+    for (; i < count; ++i)
+    {
+        dst[i] += src[i] * scale;
+    }
+}
+
+inline void MathUtilNeon::normalizeVec2Array(const float* x, const float* y, float* dstX, float* dstY, int count)
+{
+    float32x4_t zero = vdupq_n_f32(0.0f);
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        float32x4_t vx = vld1q_f32(x + i);
+        float32x4_t vy = vld1q_f32(y + i);
+        float32x4_t lengthSq = vmlaq_f32(vmulq_f32(vx, vx), vy, vy);
+        uint32x4_t nonZero = vcgtq_f32(lengthSq, zero);
+
+        // reciprocal square root estimate refined with two Newton-Raphson steps
+        float32x4_t inv = vrsqrteq_f32(lengthSq);
+        inv = vmulq_f32(inv, vrsqrtsq_f32(vmulq_f32(lengthSq, inv), inv));
+        inv = vmulq_f32(inv, vrsqrtsq_f32(vmulq_f32(lengthSq, inv), inv));
+
+        // zero-length lanes produce NaN above and are masked out here
+        vst1q_f32(dstX + i, vreinterpretq_f32_u32(vandq_u32(nonZero, vreinterpretq_u32_f32(vmulq_f32(vx, inv)))));
+        vst1q_f32(dstY + i, vreinterpretq_f32_u32(vandq_u32(nonZero, vreinterpretq_u32_f32(vmulq_f32(vy, inv)))));
+    }
+    for (; i < count; ++i)
+    {
+        float lengthSq = x[i] * x[i] + y[i] * y[i];
+        float inv = lengthSq > 0.0f ? 1.0f / std::sqrt(lengthSq) : 0.0f;
+        dstX[i] = x[i] * inv;
+        dstY[i] = y[i] * inv;
+    }
+}
+
 NS_CC_MATH_END
@@ -151,7 +151,57 @@ void MathUtil::transformVec4(const __m128 m[4], const __m128& v, __m128& dst)
                      );
 }
 
+class MathUtilSSE
+{
+public:
+    inline static void addScaledArray(float* dst, const float* src, float scale, int count);
+
+    inline static void normalizeVec2Array(const float* x, const float* y, float* dstX, float* dstY, int count);
+};
+
+inline void MathUtilSSE::addScaledArray(float* dst, const float* src, float scale, int count)
+{
+    __m128 s = _mm_set1_ps(scale);
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 d = _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_loadu_ps(src + i), s));
+        _mm_storeu_ps(dst + i, d);
+    }
+    for (; i < count; ++i)
+    {
+        dst[i] += src[i] * scale;
+    }
+}
+
+inline void MathUtilSSE::normalizeVec2Array(const float* x, const float* y, float* dstX, float* dstY, int count)
+{
+    __m128 zero = _mm_setzero_ps();
+    __m128 one = _mm_set1_ps(1.0f);
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 vx = _mm_loadu_ps(x + i);
+        __m128 vy = _mm_loadu_ps(y + i);
+        __m128 lengthSq = _mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy));
+        __m128 nonZero = _mm_cmpgt_ps(lengthSq, zero);
+        __m128 inv = _mm_div_ps(one, _mm_sqrt_ps(lengthSq));
+
+        // zero-length lanes produce NaN above and are masked out here
+        _mm_storeu_ps(dstX + i, _mm_and_ps(nonZero, _mm_mul_ps(vx, inv)));
+        _mm_storeu_ps(dstY + i, _mm_and_ps(nonZero, _mm_mul_ps(vy, inv)));
+    }
+    for (; i < count; ++i)
+    {
+        float lengthSq = x[i] * x[i] + y[i] * y[i];
+        float inv = lengthSq > 0.0f ? 1.0f / std::sqrt(lengthSq) : 0.0f;
+        dstX[i] = x[i] * inv;
+        dstY[i] = y[i] * inv;
+    }
+}
+
 #endif
 
 
+
 NS_CC_MATH_END
@@ -72,6 +72,11 @@ PhysicsBody::PhysicsBody()
 , _rotationOffset(0)
 , _recordedRotation(0.0f)
 , _recordedAngle(0.0)
+, _nodeTransformDirty(true)
+, _stepQueued(false)
+, _previousAngle(0.0)
+, _nodeShowsStepTransform(false)
+, _stepNodeRotation(0.0f)
 {
 }
 
@@ -336,6 +341,9 @@ void PhysicsBody::setPosition(const Vec2& position)
 {
     _positionInitDirty = false;
     _recordedPosition = position;
+    _previousPosition = position;
+    _nodeShowsStepTransform = false;
+    _nodeTransformDirty = true;
     cpBodySetPos(_cpBody, PhysicsHelper::point2cpv(position + _positionOffset));
 }
 
@@ -343,6 +351,9 @@ void PhysicsBody::setRotation(float rotation)
 {
     _recordedRotation = rotation;
     _recordedAngle = - (rotation + _rotationOffset) * (M_PI / 180.0);
+    _previousAngle = _recordedAngle;
+    _nodeShowsStepTransform = false;
+    _nodeTransformDirty = true;
     cpBodySetAngle(_cpBody, _recordedAngle);
 }
 
@@ -380,6 +391,41 @@ float PhysicsBody::getRotation()
     return _recordedRotation;
 }
 
+void PhysicsBody::recordStepState()
+{
+    _previousPosition.x = _cpBody->p.x - _positionOffset.x;
+    _previousPosition.y = _cpBody->p.y - _positionOffset.y;
+    _previousAngle = cpBodyGetAngle(_cpBody);
+}
+
+void PhysicsBody::getStepTransform(Vec2* position, float* rotation)
+{
+    *position = getPosition();
+    *rotation = getRotation();
+    
+    if (_positionInitDirty || _world == nullptr || !_world->isInterpolatingSteps())
+    {
+        return;
+    }
+    
+    // blend the last two states, or extrapolate the motion of the last step
+    Vec2 from = _previousPosition;
+    double fromAngle = _previousAngle;
+    Vec2 to = *position;
+    double toAngle = cpBodyGetAngle(_cpBody);
+    if (_world->getStepInterpolation() == PhysicsWorld::StepInterpolation::EXTRAPOLATE)
+    {
+        from = to;
+        to += to - _previousPosition;
+        fromAngle = toAngle;
+        toAngle += toAngle - _previousAngle;
+    }
+    
+    float alpha = _world->getStepAlpha();
+    *position = from.lerp(to, alpha);
+    *rotation = - (fromAngle + (toAngle - fromAngle) * alpha) * 180.0 / M_PI - _rotationOffset;
+}
+
 PhysicsShape* PhysicsBody::addShape(PhysicsShape* shape, bool addMassAndMoment/* = true*/)
 {
     if (shape == nullptr) return nullptr;
@@ -772,6 +818,20 @@ void PhysicsBody::update(float delta)
     }
 }
 
+void PhysicsBody::setTag(int tag)
+{
+    if (_world && tag != _tag)
+    {
+        _world->removeBodyTag(this);
+        _tag = tag;
+        _world->addBodyTag(this);
+    }
+    else
+    {
+        _tag = tag;
+    }
+}
+
 void PhysicsBody::setCategoryBitmask(int bitmask)
 {
     for (auto& shape : _shapes)
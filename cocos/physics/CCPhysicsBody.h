@@ -494,7 +494,7 @@ public:
     inline int getTag() const { return _tag; }
     
     /** set the body's tag. */
-    inline void setTag(int tag) { _tag = tag; }
+    void setTag(int tag);
     
     /** Convert the world point to local. */
     Vec2 world2Local(const Vec2& point);
@@ -515,6 +515,10 @@ protected:
     
     void update(float delta);
     
+    // keeps the state before a fixed step, and gets the state the node shows between steps
+    void recordStepState();
+    void getStepTransform(Vec2* position, float* rotation);
+    
     void removeJoint(PhysicsJoint* joint);
     inline void updateDamping() { _isDamping = _linearDamping != 0.0f ||  _angularDamping != 0.0f; }
     
@@ -551,6 +555,19 @@ protected:
     float _recordedRotation;
     double _recordedAngle;
     
+    // the body moved since its node last followed it
+    bool _nodeTransformDirty;
+    // in the world's list of the bodies moved by the last step
+    bool _stepQueued;
+    
+    // the state before the last fixed step
+    Vec2 _previousPosition;
+    double _previousAngle;
+    // the interpolated transform last given to the node, not written back to the body while the node keeps it
+    bool _nodeShowsStepTransform;
+    Vec2 _stepNodePosition;
+    float _stepNodeRotation;
+    
     friend class PhysicsWorld;
     friend class PhysicsShape;
     friend class PhysicsJoint;
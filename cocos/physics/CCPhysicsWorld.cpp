@@ -26,6 +26,7 @@
 #if CC_USE_PHYSICS
 #include <algorithm>
 #include <climits>
+#include <cmath>
 
 #include "chipmunk.h"
 #include "CCPhysicsBody.h"
@@ -89,6 +90,7 @@ public:
     static void queryRectCallbackFunc(cpShape *shape, RectQueryCallbackInfo *info);
     static void queryPointFunc(cpShape *shape, cpFloat distance, cpVect point, PointQueryCallbackInfo *info);
     static void getShapesAtPointFunc(cpShape *shape, cpFloat distance, cpVect point, Vector<PhysicsShape*>* arr);
+    static void updateBodyPositionFunc(cpBody *body, cpFloat dt);
     
 public:
     static bool continues;
@@ -96,6 +98,18 @@ public:
 
 bool PhysicsWorldCallback::continues = true;
 
+// chipmunk only integrates the awake dynamic bodies, this is how the world learns which ones moved
+void PhysicsWorldCallback::updateBodyPositionFunc(cpBody *body, cpFloat dt)
+{
+    PhysicsBody* physicsBody = static_cast<PhysicsBody*>(body->data);
+    PhysicsWorld* world = physicsBody->getWorld();
+    if (world)
+    {
+        world->addSteppedBody(physicsBody);
+    }
+    cpBodyUpdatePosition(body, dt);
+}
+
 int PhysicsWorldCallback::collisionBeginCallbackFunc(cpArbiter *arb, struct cpSpace *space, PhysicsWorld *world)
 {
     CP_ARBITER_GET_SHAPES(arb, a, b);
@@ -333,7 +347,7 @@ void PhysicsWorld::rayCast(PhysicsRayCastCallbackFunc func, const Vec2& point1,
     {
         if (!_delayAddBodies.empty() || !_delayRemoveBodies.empty())
         {
-            _scene->updatePhysicsBodyTransform(_scene->getNodeToParentTransform(), 0, 1.0f, 1.0f);
+            updateBodyTransforms();
             updateBodies();
         }
         RayCastCallbackInfo info = { this, func, point1, point2, data };
@@ -357,7 +371,7 @@ void PhysicsWorld::queryRect(PhysicsQueryRectCallbackFunc func, const Rect& rect
     {
         if (!_delayAddBodies.empty() || !_delayRemoveBodies.empty())
         {
-            _scene->updatePhysicsBodyTransform(_scene->getNodeToParentTransform(), 0, 1.0f, 1.0f);
+            updateBodyTransforms();
             updateBodies();
         }
         RectQueryCallbackInfo info = {this, func, data};
@@ -380,7 +394,7 @@ void PhysicsWorld::queryPoint(PhysicsQueryPointCallbackFunc func, const Vec2& po
     {
         if (!_delayAddBodies.empty() || !_delayRemoveBodies.empty())
         {
-            _scene->updatePhysicsBodyTransform(_scene->getNodeToParentTransform(), 0, 1.0f, 1.0f);
+            updateBodyTransforms();
             updateBodies();
         }
         PointQueryCallbackInfo info = {this, func, data};
@@ -474,7 +488,10 @@ void PhysicsWorld::addBody(PhysicsBody* body)
     
     addBodyOrDelay(body);
     _bodies.pushBack(body);
+    addBodyTag(body);
     body->_world = this;
+    body->_cpBody->data = body;
+    body->_cpBody->position_func = PhysicsWorldCallback::updateBodyPositionFunc;
 }
 
 void PhysicsWorld::doAddBody(PhysicsBody* body)
@@ -535,13 +552,10 @@ void PhysicsWorld::updateBodies()
 
 void PhysicsWorld::removeBody(int tag)
 {
-    for (auto& body : _bodies)
+    auto body = getBody(tag);
+    if (body)
     {
-        if (body->getTag() == tag)
-        {
-            removeBody(body);
-            return;
-        }
+        removeBody(body);
     }
 }
 
@@ -562,7 +576,13 @@ void PhysicsWorld::removeBody(PhysicsBody* body)
     body->_joints.clear();
     
     removeBodyOrDelay(body);
+    if (body->_stepQueued)
+    {
+        _steppedBodies.erase(std::find(_steppedBodies.begin(), _steppedBodies.end(), body));
+        body->_stepQueued = false;
+    }
     _bodies.eraseObject(body);
+    removeBodyTag(body);
     body->_world = nullptr;
 }
 
@@ -751,10 +771,13 @@ void PhysicsWorld::removeAllBodies()
     for (auto& child : _bodies)
     {
         removeBodyOrDelay(child);
+        child->_stepQueued = false;
         child->_world = nullptr;
     }
+    _steppedBodies.clear();
     
     _bodies.clear();
+    _bodiesByTag.clear();
 }
 
 void PhysicsWorld::setDebugDrawMask(int mask)
@@ -774,15 +797,114 @@ const Vector<PhysicsBody*>& PhysicsWorld::getAllBodies() const
 
 PhysicsBody* PhysicsWorld::getBody(int tag) const
 {
-    for (auto& body : _bodies)
+    auto it = _bodiesByTag.find(tag);
+    return it != _bodiesByTag.end() ? it->second : nullptr;
+}
+
+void PhysicsWorld::addBodyTag(PhysicsBody* body)
+{
+    _bodiesByTag.insert(std::make_pair(body->getTag(), body));
+}
+
+void PhysicsWorld::removeBodyTag(PhysicsBody* body)
+{
+    auto range = _bodiesByTag.equal_range(body->getTag());
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        if (it->second == body)
+        {
+            _bodiesByTag.erase(it);
+            return;
+        }
+    }
+}
+
+void PhysicsWorld::markBodyTransformDirty(Node* node)
+{
+    if (!node->_physicsTransformQueued)
+    {
+        node->_physicsTransformQueued = true;
+        _bodyTransformDirtyNodes.push_back(node);
+    }
+}
+
+void PhysicsWorld::unmarkBodyTransformDirty(Node* node)
+{
+    auto it = std::find(_bodyTransformDirtyNodes.begin(), _bodyTransformDirtyNodes.end(), node);
+    if (it != _bodyTransformDirtyNodes.end())
     {
-        if (body->getTag() == tag)
+        _bodyTransformDirtyNodes.erase(it);
+    }
+    node->_physicsTransformQueued = false;
+}
+
+void PhysicsWorld::updateBodyTransforms()
+{
+    for (auto& body : _delayAddBodies)
+    {
+        if (body->getNode())
         {
-            return body;
+            markBodyTransformDirty(body->getNode());
         }
     }
     
-    return nullptr;
+    // a node below another dirty node is synced along with it
+    std::vector<Node*> roots;
+    roots.reserve(_bodyTransformDirtyNodes.size());
+    for (auto node : _bodyTransformDirtyNodes)
+    {
+        bool covered = false;
+        for (auto parent = node->getParent(); parent; parent = parent->getParent())
+        {
+            if (parent->_physicsTransformQueued)
+            {
+                covered = true;
+                break;
+            }
+        }
+        
+        if (!covered)
+        {
+            roots.push_back(node);
+        }
+    }
+    
+    for (auto node : _bodyTransformDirtyNodes)
+    {
+        node->_physicsTransformQueued = false;
+    }
+    _bodyTransformDirtyNodes.clear();
+    
+    std::vector<Node*> ancestors;
+    for (auto node : roots)
+    {
+        auto parent = node->getParent();
+        if (parent == nullptr)
+        {
+            node->updatePhysicsBodyTransform(node->getNodeToParentTransform(), 0, 1.0f, 1.0f);
+            continue;
+        }
+        
+        // refresh the rotation and scale the ancestors would get from a walk down from the scene
+        ancestors.clear();
+        for (auto p = parent; p; p = p->getParent())
+        {
+            ancestors.push_back(p);
+        }
+        float scaleX = 1.0f;
+        float scaleY = 1.0f;
+        for (auto it = ancestors.rbegin(); it != ancestors.rend(); ++it)
+        {
+            auto ancestor = *it;
+            if (ancestor->_parent)
+            {
+                ancestor->_physicsRotation = ancestor->_parent->_physicsRotation + ancestor->_rotationZ_X;
+            }
+            scaleX *= ancestor->_scaleX;
+            scaleY *= ancestor->_scaleY;
+        }
+        node->updatePhysicsBodyTransform(parent->getNodeToWorldTransform(), Node::FLAGS_TRANSFORM_DIRTY, scaleX, scaleY);
+    }
 }
 
 void PhysicsWorld::setGravity(const Vect& gravity)
@@ -817,11 +939,10 @@ void PhysicsWorld::step(float delta)
 
 void PhysicsWorld::update(float delta, bool userCall/* = false*/)
 {
-    if(_updateBodyTransform || !_delayAddBodies.empty())
+    if(!_bodyTransformDirtyNodes.empty() || !_delayAddBodies.empty())
     {
-        _scene->updatePhysicsBodyTransform(_scene->getNodeToParentTransform(), 0, 1.0f, 1.0f);
+        updateBodyTransforms();
         updateBodies();
-        _updateBodyTransform = false;
     }
     else if (!_delayRemoveBodies.empty())
     {
@@ -838,13 +959,15 @@ void PhysicsWorld::update(float delta, bool userCall/* = false*/)
         return;
     }
     
+    bool stepped = false;
     if (userCall)
     {
-        cpSpaceStep(_cpSpace, delta);
-        for (auto& body : _bodies)
-        {
-            body->update(delta);
-        }
+        stepSpace(delta);
+        stepped = true;
+    }
+    else if (_fixedTimeStep > 0.0f)
+    {
+        stepped = updateFixedStep(delta);
     }
     else
     {
@@ -854,14 +977,21 @@ void PhysicsWorld::update(float delta, bool userCall/* = false*/)
             const float dt = _updateTime * _speed / _substeps;
             for (int i = 0; i < _substeps; ++i)
             {
-                cpSpaceStep(_cpSpace, dt);
-                for (auto& body : _bodies)
-                {
-                    body->update(dt);
-                }
+                stepSpace(dt);
             }
             _updateRateCount = 0;
             _updateTime = 0.0f;
+            stepped = true;
+        }
+    }
+    
+    // only the nodes of the bodies moved by the last step follow them, the others are left alone until
+    // their parent moves. Interpolated nodes keep moving between the steps.
+    if (stepped || isInterpolatingSteps())
+    {
+        for (auto body : _steppedBodies)
+        {
+            body->_nodeTransformDirty = true;
         }
     }
     
@@ -871,6 +1001,70 @@ void PhysicsWorld::update(float delta, bool userCall/* = false*/)
     }
 }
 
+bool PhysicsWorld::updateFixedStep(float delta)
+{
+    _stepAccumulator += delta * _speed;
+    
+    int steps = 0;
+    while (_stepAccumulator >= _fixedTimeStep && steps < _maxFixedSteps)
+    {
+        stepSpace(_fixedTimeStep);
+        _stepAccumulator -= _fixedTimeStep;
+        ++steps;
+    }
+    
+    // too far behind, drop the time that can't be caught up rather than making the next frames longer
+    if (_stepAccumulator >= _fixedTimeStep)
+    {
+        _stepAccumulator = fmodf(_stepAccumulator, _fixedTimeStep);
+    }
+    _stepAlpha = _stepAccumulator / _fixedTimeStep;
+    return steps > 0;
+}
+
+void PhysicsWorld::stepSpace(float delta)
+{
+    releaseSteppedBodies();
+    cpSpaceStep(_cpSpace, delta);
+    for (auto body : _steppedBodies)
+    {
+        body->update(delta);
+    }
+}
+
+void PhysicsWorld::addSteppedBody(PhysicsBody* body)
+{
+    if (!body->_stepQueued)
+    {
+        // the state before this step, where interpolation starts from
+        body->recordStepState();
+        body->_stepQueued = true;
+        _steppedBodies.push_back(body);
+    }
+}
+
+void PhysicsWorld::releaseSteppedBodies()
+{
+    // a body that stops moving now rests where the last step left it, its node follows it one last time
+    for (auto body : _steppedBodies)
+    {
+        body->recordStepState();
+        body->_stepQueued = false;
+        body->_nodeTransformDirty = true;
+    }
+    _steppedBodies.clear();
+}
+
+void PhysicsWorld::setFixedTimeStep(float step)
+{
+    if (step >= 0.0f)
+    {
+        _fixedTimeStep = step;
+        _stepAccumulator = 0.0f;
+        _stepAlpha = 0.0f;
+    }
+}
+
 PhysicsWorld::PhysicsWorld()
 : _gravity(Vec2(0.0f, -98.0f))
 , _speed(1.0f)
@@ -878,11 +1072,15 @@ PhysicsWorld::PhysicsWorld()
 , _updateRateCount(0)
 , _updateTime(0.0f)
 , _substeps(1)
+, _fixedTimeStep(0.0f)
+, _maxFixedSteps(5)
+, _stepAccumulator(0.0f)
+, _stepAlpha(0.0f)
+, _stepInterpolation(StepInterpolation::INTERPOLATE)
 , _cpSpace(nullptr)
 , _scene(nullptr)
 , _autoStep(true)
 , _debugDraw(nullptr)
-, _updateBodyTransform(false)
 , _debugDrawMask(DEBUGDRAW_NONE)
 {
     
@@ -890,6 +1088,11 @@ PhysicsWorld::PhysicsWorld()
 
 PhysicsWorld::~PhysicsWorld()
 {
+    for (auto node : _bodyTransformDirtyNodes)
+    {
+        node->_physicsTransformQueued = false;
+    }
+    
     removeAllJoints(true);
     removeAllBodies();
     if (_cpSpace)
@@ -33,6 +33,7 @@
 #include "math/CCGeometry.h"
 #include "physics/CCPhysicsBody.h"
 #include <list>
+#include <unordered_map>
 
 struct cpSpace;
 
@@ -97,6 +98,14 @@ public:
     static const int DEBUGDRAW_CONTACT;     ///< draw contact
     static const int DEBUGDRAW_ALL;         ///< draw all
     
+    /** How the nodes are placed between two fixed time steps, see setFixedTimeStep(). */
+    enum class StepInterpolation
+    {
+        NONE,           ///< show the last simulated state
+        INTERPOLATE,    ///< blend the last two simulated states, the nodes lag at most one step behind
+        EXTRAPOLATE,    ///< project the last simulated state forward, the nodes may overshoot
+    };
+    
 public:
     /**
     * Adds a joint to this physics world.
@@ -285,6 +294,60 @@ public:
     */
     inline int getSubsteps() const { return _substeps; }
 
+    /**
+     * Set the fixed time step of this physics world.
+     *
+     * With a fixed time step, the frame time is accumulated and the world is stepped by exactly this amount
+     * as many times as the accumulated time allows, so the simulation doesn't depend on the frame rate.
+     * The nodes are placed between the last two steps according to setStepInterpolation().
+     * @attention if you setAutoStep(false), this won't work. The update rate and the substeps are not used in this mode.
+     * @param step In seconds, 1/60 for example. 0, the default value, steps once per frame with the frame time.
+     */
+    void setFixedTimeStep(float step);
+
+    /**
+    * Get the fixed time step of this physics world.
+    *
+    * @return In seconds, 0 if the world is stepped with the frame time.
+    */
+    inline float getFixedTimeStep() const { return _fixedTimeStep; }
+
+    /**
+     * Set the maximum number of fixed steps run in a frame.
+     *
+     * After a long frame the world catches up by at most this number of steps, the remaining time is dropped.
+     * @param steps An interger number, default value is 5.
+     */
+    inline void setMaxFixedSteps(int steps) { if(steps > 0) { _maxFixedSteps = steps; } }
+
+    /**
+    * Get the maximum number of fixed steps run in a frame.
+    *
+    * @return An interger number.
+    */
+    inline int getMaxFixedSteps() const { return _maxFixedSteps; }
+
+    /**
+     * Set how the nodes are placed between two fixed time steps.
+     *
+     * @param mode Default value is StepInterpolation::INTERPOLATE.
+     */
+    inline void setStepInterpolation(StepInterpolation mode) { _stepInterpolation = mode; }
+
+    /**
+    * Get how the nodes are placed between two fixed time steps.
+    *
+    * @return A StepInterpolation value.
+    */
+    inline StepInterpolation getStepInterpolation() const { return _stepInterpolation; }
+
+    /**
+    * Get the time accumulated since the last fixed step, as a fraction of the fixed time step.
+    *
+    * @return A float number between 0 and 1.
+    */
+    inline float getStepAlpha() const { return _stepAlpha; }
+
     /**
     * Set the debug draw mask of this physics world.
     * 
@@ -334,6 +397,11 @@ protected:
     virtual void addShape(PhysicsShape* shape);
     virtual void removeShape(PhysicsShape* shape);
     virtual void update(float delta, bool userCall = false);
+    bool updateFixedStep(float delta);
+    void stepSpace(float delta);
+    void addSteppedBody(PhysicsBody* body);
+    void releaseSteppedBodies();
+    inline bool isInterpolatingSteps() const { return _fixedTimeStep > 0.0f && _stepInterpolation != StepInterpolation::NONE; }
     
     virtual void debugDraw();
     
@@ -350,6 +418,13 @@ protected:
     virtual void updateBodies();
     virtual void updateJoints();
     
+    // the nodes whose transform changed, with bodies at or below them, are synced to the bodies before a step
+    void markBodyTransformDirty(Node* node);
+    void unmarkBodyTransformDirty(Node* node);
+    void updateBodyTransforms();
+    void addBodyTag(PhysicsBody* body);
+    void removeBodyTag(PhysicsBody* body);
+    
 protected:
     Vect _gravity;
     float _speed;
@@ -357,10 +432,18 @@ protected:
     int _updateRateCount;
     float _updateTime;
     int _substeps;
+    float _fixedTimeStep;
+    int _maxFixedSteps;
+    float _stepAccumulator;
+    float _stepAlpha;
+    StepInterpolation _stepInterpolation;
     cpSpace* _cpSpace;
     
-    bool _updateBodyTransform;
+    std::vector<Node*> _bodyTransformDirtyNodes;
+    // the bodies chipmunk moved in the last step, the only ones whose nodes need to follow them
+    std::vector<PhysicsBody*> _steppedBodies;
     Vector<PhysicsBody*> _bodies;
+    std::unordered_multimap<int, PhysicsBody*> _bodiesByTag;
     std::list<PhysicsJoint*> _joints;
     Scene* _scene;
     
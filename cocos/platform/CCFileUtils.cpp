@@ -26,12 +26,14 @@ THE SOFTWARE.
 #include "CCFileUtils.h"
 
 #include <stack>
+#include <algorithm>
 
 #include "base/CCData.h"
 #include "base/ccMacros.h"
 #include "base/CCDirector.h"
 #include "platform/CCSAXParser.h"
 #include "base/ccUtils.h"
+#include "base/ZipUtils.h"
 
 #include "tinyxml2.h"
 #ifdef MINIZIP_FROM_SYSTEM
@@ -371,6 +373,8 @@ static tinyxml2::XMLElement* generateElementForDict(const ValueMap& dict, tinyxm
 bool FileUtils::writeToFile(ValueMap& dict, const std::string &fullPath)
 {
     //CCLOG("tinyxml2 Dictionary %d writeToFile %s", dict->_ID, fullPath.c_str());
+    invalidateMissingPathCache();
+    invalidateZipArchives(fullPath);
     tinyxml2::XMLDocument *doc = new tinyxml2::XMLDocument();
     if (nullptr == doc)
         return false;
@@ -522,12 +526,16 @@ void FileUtils::setDelegate(FileUtils *delegate)
 }
 
 FileUtils::FileUtils()
-    : _writablePath("")
+    : _missingPathCacheEnabled(false)
+    , _fullPathCacheLimit(0)
+    , _fullPathCacheStats()
+    , _writablePath("")
 {
 }
 
 FileUtils::~FileUtils()
 {
+    purgeZipArchives();
 }
 
 
@@ -542,8 +550,161 @@ bool FileUtils::init()
 }
 
 void FileUtils::purgeCachedEntries()
+{
+    clearFullPathCache();
+    purgeZipArchives();
+}
+
+void FileUtils::clearFullPathCache() const
 {
     _fullPathCache.clear();
+    _missingPathCache.clear();
+    _fullPathCacheLRU.clear();
+    _fullPathCacheLRUIndex.clear();
+}
+
+void FileUtils::addFullPathCacheEntry(const std::string& filename, const std::string& fullPath) const
+{
+    if (fullPath.empty())
+    {
+        if (!_missingPathCacheEnabled)
+            return;
+        _missingPathCache.insert(filename);
+    }
+    else
+    {
+        _fullPathCache[filename] = fullPath;
+    }
+
+    if (_fullPathCacheLimit == 0)
+        return;
+
+    auto indexIter = _fullPathCacheLRUIndex.find(filename);
+    if (indexIter != _fullPathCacheLRUIndex.end())
+    {
+        _fullPathCacheLRU.splice(_fullPathCacheLRU.begin(), _fullPathCacheLRU, indexIter->second);
+        return;
+    }
+
+    _fullPathCacheLRU.push_front(filename);
+    _fullPathCacheLRUIndex.insert(std::make_pair(filename, _fullPathCacheLRU.begin()));
+
+    while (_fullPathCacheLRU.size() > _fullPathCacheLimit)
+    {
+        const std::string& oldest = _fullPathCacheLRU.back();
+        _fullPathCache.erase(oldest);
+        _missingPathCache.erase(oldest);
+        _fullPathCacheLRUIndex.erase(oldest);
+        _fullPathCacheLRU.pop_back();
+        ++_fullPathCacheStats.evictions;
+    }
+}
+
+void FileUtils::touchFullPathCacheEntry(const std::string& filename) const
+{
+    if (_fullPathCacheLimit == 0)
+        return;
+
+    auto indexIter = _fullPathCacheLRUIndex.find(filename);
+    if (indexIter != _fullPathCacheLRUIndex.end())
+    {
+        _fullPathCacheLRU.splice(_fullPathCacheLRU.begin(), _fullPathCacheLRU, indexIter->second);
+    }
+}
+
+void FileUtils::invalidateMissingPathCache() const
+{
+    if (_missingPathCache.empty())
+        return;
+
+    if (_fullPathCacheLimit != 0)
+    {
+        for (const auto& filename : _missingPathCache)
+        {
+            auto indexIter = _fullPathCacheLRUIndex.find(filename);
+            if (indexIter != _fullPathCacheLRUIndex.end())
+            {
+                _fullPathCacheLRU.erase(indexIter->second);
+                _fullPathCacheLRUIndex.erase(indexIter);
+            }
+        }
+    }
+    _missingPathCache.clear();
+}
+
+void FileUtils::setFullPathCacheLimit(size_t limit)
+{
+    if (limit == _fullPathCacheLimit)
+        return;
+
+    // the recency order isn't tracked while unbounded, start over
+    clearFullPathCache();
+    _fullPathCacheLimit = limit;
+}
+
+void FileUtils::setMissingPathCacheEnabled(bool enabled)
+{
+    if (!enabled)
+    {
+        invalidateMissingPathCache();
+    }
+    _missingPathCacheEnabled = enabled;
+}
+
+void FileUtils::setFileManifest(const std::vector<std::string>& files)
+{
+    clearFullPathCache();
+    _fileManifest.clear();
+    _fileManifest.reserve(files.size());
+    for (const auto& file : files)
+    {
+        std::string path = file;
+        std::replace(path.begin(), path.end(), '\\', '/');
+        while (path.compare(0, 2, "./") == 0)
+        {
+            path.erase(0, 2);
+        }
+        if (!path.empty())
+        {
+            _fileManifest.insert(path);
+        }
+    }
+}
+
+bool FileUtils::loadFileManifestFromFile(const std::string& filename)
+{
+    std::string content = getStringFromFile(filename);
+    if (content.empty())
+    {
+        CCLOG("cocos2d: ERROR: Failed to load the file manifest: %s", filename.c_str());
+        return false;
+    }
+
+    std::vector<std::string> files;
+    size_t start = 0;
+    while (start < content.size())
+    {
+        size_t end = content.find('\n', start);
+        if (end == std::string::npos)
+            end = content.size();
+
+        size_t last = end;
+        while (last > start && (content[last - 1] == '\r' || content[last - 1] == ' ' || content[last - 1] == '\t'))
+            --last;
+        if (last > start)
+        {
+            files.push_back(content.substr(start, last - start));
+        }
+        start = end + 1;
+    }
+
+    setFileManifest(files);
+    return true;
+}
+
+void FileUtils::resetFullPathCacheStats()
+{
+    _fullPathCacheStats = FullPathCacheStats();
 }
 
 static Data getData(const std::string& filename, bool forString)
@@ -622,6 +783,21 @@ Data FileUtils::getDataFromFile(const std::string& filename)
     return getData(filename, false);
 }
 
+MappedData FileUtils::getMappedDataFromFile(const std::string& filename, MappedData::Access access)
+{
+    MappedData ret;
+    if (filename.empty())
+        return ret;
+
+    // only plain files on disk can be mapped, packaged ones go through the platform's reader
+    std::string fullPath = fullPathForFilename(filename);
+    if (!fullPath.empty() && isAbsolutePath(fullPath) && ret.initWithFile(fullPath, access))
+        return ret;
+
+    ret.initWithData(getDataFromFile(filename));
+    return ret;
+}
+
 unsigned char* FileUtils::getFileData(const std::string& filename, const char* mode, ssize_t *size)
 {
     unsigned char * buffer = nullptr;
@@ -662,6 +838,12 @@ unsigned char* FileUtils::getFileDataFromZip(const std::string& zipFilePath, con
     {
         CC_BREAK_IF(zipFilePath.empty());
 
+        std::shared_ptr<ZipArchive> archive = getZipArchive(zipFilePath);
+        if (archive)
+        {
+            return archive->getFileData(filename, size);
+        }
+
         file = unzOpen(zipFilePath.c_str());
         CC_BREAK_IF(!file);
 
@@ -697,6 +879,47 @@ unsigned char* FileUtils::getFileDataFromZip(const std::string& zipFilePath, con
     return buffer;
 }
 
+std::shared_ptr<ZipArchive> FileUtils::getZipArchive(const std::string& zipFilePath)
+{
+    std::lock_guard<std::mutex> lock(_zipArchivesMutex);
+
+    auto iter = _zipArchives.find(zipFilePath);
+    if (iter != _zipArchives.end())
+        return iter->second;
+
+    // failures are remembered too, getFileDataFromZip falls back to minizip for them
+    std::shared_ptr<ZipArchive> archive(ZipArchive::create(zipFilePath));
+    _zipArchives.insert(std::make_pair(zipFilePath, archive));
+    return archive;
+}
+
+void FileUtils::purgeZipArchives()
+{
+    std::lock_guard<std::mutex> lock(_zipArchivesMutex);
+
+    // readers holding an archive keep it mapped until they are done
+    _zipArchives.clear();
+}
+
+void FileUtils::invalidateZipArchives(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(_zipArchivesMutex);
+
+    // a path ending with '/' is a directory, drop every archive below it
+    bool isDirectory = !path.empty() && path[path.size() - 1] == '/';
+    for (auto iter = _zipArchives.begin(); iter != _zipArchives.end();)
+    {
+        if (iter->first == path || (isDirectory && iter->first.compare(0, path.size(), path) == 0))
+        {
+            iter = _zipArchives.erase(iter);
+        }
+        else
+        {
+            ++iter;
+        }
+    }
+}
+
 std::string FileUtils::getNewFilename(const std::string &filename) const
 {
     std::string newFileName;
@@ -730,7 +953,25 @@ std::string FileUtils::getPathForFilename(const std::string& filename, const std
     std::string path = searchPath;
     path += file_path;
     path += resolutionDirectory;
-    
+
+    // files under the resource root are looked up in the manifest when there is one
+    if (!_fileManifest.empty() && !_defaultResRootPath.empty()
+        && path.compare(0, _defaultResRootPath.size(), _defaultResRootPath) == 0)
+    {
+        ++_fullPathCacheStats.manifestProbes;
+        if (!path.empty() && path[path.size()-1] != '/')
+        {
+            path += '/';
+        }
+        path += file;
+        if (_fileManifest.find(path.substr(_defaultResRootPath.size())) == _fileManifest.end())
+        {
+            path = "";
+        }
+        return path;
+    }
+
+    ++_fullPathCacheStats.fileProbes;
     path = getFullPathForDirectoryAndFilename(path, file);
     
     //CCLOG("getPathForFilename, fullPath = %s", path.c_str());
@@ -755,8 +996,19 @@ std::string FileUtils::fullPathForFilename(const std::string &filename) const
     auto cacheIter = _fullPathCache.find(filename);
     if(cacheIter != _fullPathCache.end())
     {
+        ++_fullPathCacheStats.hits;
+        touchFullPathCacheEntry(filename);
         return cacheIter->second;
     }
+
+    // Already known to be missing ?
+    if (_missingPathCacheEnabled && _missingPathCache.find(filename) != _missingPathCache.end())
+    {
+        ++_fullPathCacheStats.missingHits;
+        touchFullPathCacheEntry(filename);
+        return "";
+    }
+    ++_fullPathCacheStats.misses;
     /*02，如果不在_fullPathCache中，则继续执行如下步骤。
     首先，在_searchPathArray优先查找路径信息，然后再遍历_searchResolutionsOrderArray，
     最后以：_searchPathArray[i] + _searchResolutionsOrderArray[j] + filename方法查找文件，
@@ -787,7 +1039,7 @@ std::string FileUtils::fullPathForFilename(const std::string &filename) const
             if (fullpath.length() > 0)
             {
                 // Using the filename passed in as key.
-                _fullPathCache.insert(std::make_pair(filename, fullpath));
+                addFullPathCacheEntry(filename, fullpath);
                 return fullpath;
             }
             
@@ -797,6 +1049,7 @@ std::string FileUtils::fullPathForFilename(const std::string &filename) const
     if(isPopupNotify()){
         CCLOG("cocos2d: fullPathForFilename: No file found at %s. Possible missing file.", filename.c_str());
     }
+    addFullPathCacheEntry(filename, "");
 
     // The file wasn't found, return empty string.
     return "";
@@ -810,7 +1063,7 @@ std::string FileUtils::fullPathFromRelativeFile(const std::string &filename, con
 void FileUtils::setSearchResolutionsOrder(const std::vector<std::string>& searchResolutionsOrder)
 {
     bool existDefault = false;
-    _fullPathCache.clear();
+    clearFullPathCache();
     _searchResolutionsOrderArray.clear();
     for(const auto& iter : searchResolutionsOrder)
     {
@@ -839,6 +1092,7 @@ void FileUtils::addSearchResolutionsOrder(const std::string &order,const bool fr
     std::string resOrder = order;
     if (!resOrder.empty() && resOrder[resOrder.length()-1] != '/')
         resOrder.append("/");
+    clearFullPathCache();
     
     if (front) {
         _searchResolutionsOrderArray.insert(_searchResolutionsOrderArray.begin(), resOrder);
@@ -873,7 +1127,7 @@ void FileUtils::setSearchPaths(const std::vector<std::string>& searchPaths)
 {
     bool existDefaultRootPath = false;
     
-    _fullPathCache.clear();
+    clearFullPathCache();
     _searchPathArray.clear();
     for (const auto& iter : searchPaths)
     {
@@ -914,6 +1168,7 @@ void FileUtils::addSearchPath(const std::string &searchpath,const bool front)
     {
         path += "/";
     }
+    clearFullPathCache();
     if (front) {
         _searchPathArray.insert(_searchPathArray.begin(), path);
     } else {
@@ -923,7 +1178,7 @@ void FileUtils::addSearchPath(const std::string &searchpath,const bool front)
 
 void FileUtils::setFilenameLookupDictionary(const ValueMap& filenameLookupDict)
 {
-    _fullPathCache.clear();    
+    clearFullPathCache();
     _filenameLookupDict = filenameLookupDict;
 }
 
@@ -1044,6 +1299,7 @@ bool FileUtils::isDirectoryExist(const std::string& dirPath) const
     auto cacheIter = _fullPathCache.find(dirPath);
     if( cacheIter != _fullPathCache.end() )
     {
+        touchFullPathCacheEntry(dirPath);
         return isDirectoryExistInternal(cacheIter->second);
     }
     
@@ -1056,7 +1312,7 @@ bool FileUtils::isDirectoryExist(const std::string& dirPath) const
             fullpath = searchIt + dirPath + resolutionIt;
             if (isDirectoryExistInternal(fullpath))
             {
-                _fullPathCache.insert(std::make_pair(dirPath, fullpath));
+                addFullPathCacheEntry(dirPath, fullpath);
                 return true;
             }
         }
@@ -1068,6 +1324,7 @@ bool FileUtils::isDirectoryExist(const std::string& dirPath) const
 bool FileUtils::createDirectory(const std::string& path)
 {
     CCASSERT(!path.empty(), "Invalid path");
+    invalidateMissingPathCache();
     
     if (isDirectoryExist(path))
         return true;
@@ -1191,6 +1448,8 @@ bool FileUtils::removeDirectory(const std::string& path)
         return false;
     }
     
+    invalidateZipArchives(path);
+
     // Remove downloaded files
 
 #if (CC_TARGET_PLATFORM == CC_PLATFORM_WP8) || (CC_TARGET_PLATFORM == CC_PLATFORM_WINRT)
@@ -1255,6 +1514,8 @@ bool FileUtils::removeDirectory(const std::string& path)
 
 bool FileUtils::removeFile(const std::string &path)
 {
+    invalidateZipArchives(path);
+
     // Remove downloaded file
 
 #if (CC_TARGET_PLATFORM == CC_PLATFORM_WP8) || (CC_TARGET_PLATFORM == CC_PLATFORM_WINRT)
@@ -1293,8 +1554,11 @@ bool FileUtils::removeFile(const std::string &path)
 bool FileUtils::renameFile(const std::string &path, const std::string &oldname, const std::string &name)
 {
     CCASSERT(!path.empty(), "Invalid path");
+    invalidateMissingPathCache();
     std::string oldPath = path + oldname;
     std::string newPath = path + name;
+    invalidateZipArchives(oldPath);
+    invalidateZipArchives(newPath);
  
     // Rename a file
 #if (CC_TARGET_PLATFORM == CC_PLATFORM_WINRT || CC_TARGET_PLATFORM == CC_PLATFORM_WP8)
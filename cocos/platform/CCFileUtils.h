@@ -28,14 +28,21 @@ THE SOFTWARE.
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
+#include <list>
+#include <memory>
+#include <mutex>
 
 #include "platform/CCPlatformMacros.h"
 #include "base/ccTypes.h"
 #include "base/CCValue.h"
 #include "base/CCData.h"
+#include "base/CCMappedData.h"
 
 NS_CC_BEGIN
 
+class ZipArchive;
+
 /**
  * @addtogroup support
  * @{
@@ -84,7 +91,7 @@ public:
     virtual ~FileUtils();
     
     /**
-     *  Purges full path caches.
+     *  Purges full path caches and closes the zip files opened by getZipArchive().
      */
     virtual void purgeCachedEntries();
     
@@ -98,6 +105,17 @@ public:
      *  @return A data object.
      */
     virtual Data getDataFromFile(const std::string& filename);
+
+    /**
+     *  Gets a read-only view of a file, memory mapped when the platform allows it.
+     *  Unlike getDataFromFile, a large file is neither copied nor loaded into a heap buffer up front.
+     *  Falls back to getDataFromFile for files that can't be mapped.
+     *
+     *  @param filename The resource file name which contains the path.
+     *  @param access The expected access pattern, used as an madvise hint.
+     *  @return A view of the file, null if the file can't be read.
+     */
+    virtual MappedData getMappedDataFromFile(const std::string& filename, MappedData::Access access = MappedData::Access::SEQUENTIAL);
     
     /**
      *  Gets resource file data
@@ -120,6 +138,27 @@ public:
      */
     virtual unsigned char* getFileDataFromZip(const std::string& zipFilePath, const std::string& filename, ssize_t *size);
 
+    /**
+     *  Gets an indexed, memory mapped reader for a zip file, opening it on first use.
+     *  The archive stays open until purgeZipArchives() or purgeCachedEntries() is called, or until the file is
+     *  written, renamed or removed through FileUtils, so later reads don't open or scan it again.
+     *  getFileDataFromZip() uses it too.
+     *
+     *  @note Files can only be mapped on POSIX platforms. On Win32, WinRT and WP8 this returns nullptr
+     *        and getFileDataFromZip() reads through minizip as before.
+     *
+     *  @param zipFilePath The absolute path of the zip file.
+     *  @return The archive, or nullptr if it can't be opened. It is shared with FileUtils, and stays mapped
+     *          while the returned pointer is held even if FileUtils closes it in the meantime.
+     */
+    std::shared_ptr<ZipArchive> getZipArchive(const std::string& zipFilePath);
+
+    /**
+     *  Closes the zip files opened by getZipArchive().
+     *  Archives still held by readers are unmapped when the last of them releases it.
+     */
+    void purgeZipArchives();
+
     
     /** Returns the fullpath for a given filename.
      根据一个文件名返回一个绝对路径.
@@ -433,6 +472,58 @@ public:
     /** Returns the full path cache. */
     const std::unordered_map<std::string, std::string>& getFullPathCache() const { return _fullPathCache; }
 
+    /**
+     *  Limits the number of filenames kept by the full path cache, the least recently used ones are evicted first.
+     *  Both found and missing filenames count towards the limit.
+     *
+     *  @param limit The maximum number of entries, 0 (the default) means unbounded.
+     */
+    void setFullPathCacheLimit(size_t limit);
+    size_t getFullPathCacheLimit() const { return _fullPathCacheLimit; }
+
+    /**
+     *  Enables caching the filenames that fullPathForFilename() couldn't find, so probing an optional file
+     *  doesn't search every path again. Disabled by default.
+     *
+     *  @note The cache is reset when the search paths or resolution orders change and when files are written
+     *        through FileUtils. Call purgeCachedEntries() after creating files by other means.
+     */
+    void setMissingPathCacheEnabled(bool enabled);
+    bool isMissingPathCacheEnabled() const { return _missingPathCacheEnabled; }
+
+    /**
+     *  Sets the list of files shipped under the default resource root path.
+     *  Once set, existence checks below that root are answered from the list instead of the file system.
+     *
+     *  @param files The file paths, relative to the default resource root path, e.g. "hd/images/hero.png".
+     *               An empty list disables the manifest.
+     */
+    void setFileManifest(const std::vector<std::string>& files);
+
+    /**
+     *  Loads the file manifest from a text file with one relative path per line.
+     *
+     *  @return True if the manifest has been loaded, false if the file can't be read.
+     */
+    bool loadFileManifestFromFile(const std::string& filename);
+
+    /** Counters of the full path lookups since the last resetFullPathCacheStats(). */
+    struct FullPathCacheStats
+    {
+        unsigned int hits;              ///< lookups answered from the cache with a full path
+        unsigned int missingHits;       ///< lookups answered from the cache as missing
+        unsigned int misses;            ///< lookups that had to search the paths
+        unsigned int fileProbes;        ///< existence checks done on the file system
+        unsigned int manifestProbes;    ///< existence checks answered by the file manifest
+        unsigned int evictions;         ///< entries evicted by the cache limit
+    };
+
+    /** Returns the counters of the full path lookups. */
+    const FullPathCacheStats& getFullPathCacheStats() const { return _fullPathCacheStats; }
+
+    /** Resets the counters of the full path lookups. */
+    void resetFullPathCacheStats();
+
 protected:
     /**
      *  The default constructor.
@@ -570,6 +661,58 @@ protected:
      _fullPathCache返回该文件的全路径，从而提高游戏的运行效率。
      */
     mutable std::unordered_map<std::string, std::string> _fullPathCache;
+
+    /**
+     *  Clears the found and missing full path caches.
+     */
+    void clearFullPathCache() const;
+
+    /**
+     *  Adds a lookup result to the full path cache, an empty fullPath records a missing file.
+     */
+    void addFullPathCacheEntry(const std::string& filename, const std::string& fullPath) const;
+
+    /**
+     *  Marks a cached filename as recently used, only needed when the cache is bounded.
+     */
+    void touchFullPathCacheEntry(const std::string& filename) const;
+
+    /**
+     *  Forgets the missing filenames, called before FileUtils creates files.
+     */
+    void invalidateMissingPathCache() const;
+
+    /**
+     *  The filenames fullPathForFilename() couldn't find, see setMissingPathCacheEnabled().
+     */
+    mutable std::unordered_set<std::string> _missingPathCache;
+    bool _missingPathCacheEnabled;
+
+    /**
+     *  Least recently used order of the cached filenames, front is the most recent.
+     *  Only maintained when _fullPathCacheLimit isn't 0.
+     */
+    mutable std::list<std::string> _fullPathCacheLRU;
+    mutable std::unordered_map<std::string, std::list<std::string>::iterator> _fullPathCacheLRUIndex;
+    size_t _fullPathCacheLimit;
+
+    /**
+     *  The files below _defaultResRootPath, relative to it. Empty when no manifest is set.
+     */
+    std::unordered_set<std::string> _fileManifest;
+
+    mutable FullPathCacheStats _fullPathCacheStats;
+
+    /**
+     *  The zip files opened by getZipArchive(), nullptr for the ones that can't be indexed.
+     */
+    std::unordered_map<std::string, std::shared_ptr<ZipArchive>> _zipArchives;
+    std::mutex _zipArchivesMutex;
+
+    /**
+     *  Closes the archive opened for path, or every archive below it if path ends with '/'.
+     */
+    void invalidateZipArchives(const std::string& path);
     
     /**
      * Writable path.
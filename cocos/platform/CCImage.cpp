@@ -506,7 +506,7 @@ bool Image::initWithImageFile(const std::string& path)
 
     SDL_FreeSurface(iSurf);
 #else
-    Data data = FileUtils::getInstance()->getDataFromFile(_filePath);
+    MappedData data = FileUtils::getInstance()->getMappedDataFromFile(_filePath);
 
     if (!data.isNull())
     {
@@ -522,7 +522,7 @@ bool Image::initWithImageFileThreadSafe(const std::string& fullpath)
     bool ret = false;
     _filePath = fullpath;
 
-    Data data = FileUtils::getInstance()->getDataFromFile(fullpath);
+    MappedData data = FileUtils::getInstance()->getMappedDataFromFile(fullpath);
 
     if (!data.isNull())
     {
@@ -456,6 +456,8 @@ ValueMap FileUtilsApple::getValueMapFromData(const char* filedata, int filesize)
 bool FileUtilsApple::writeToFile(ValueMap& dict, const std::string &fullPath)
 {
     //CCLOG("iOS||Mac Dictionary %d write to file %s", dict->_ID, fullPath.c_str());
+    invalidateMissingPathCache();
+    invalidateZipArchives(fullPath);
     NSMutableDictionary *nsDict = [NSMutableDictionary dictionary];
 
     for (auto iter = dict.begin(); iter != dict.end(); ++iter)
@@ -287,6 +287,7 @@ GLProgramState::GLProgramState()
 , _textureUnitIndex(1)
 , _vertexAttribsFlags(0)
 , _glprogram(nullptr)
+, _materialVersion(0)
 {
 #if (CC_TARGET_PLATFORM == CC_PLATFORM_ANDROID || CC_TARGET_PLATFORM == CC_PLATFORM_WP8 || CC_TARGET_PLATFORM == CC_PLATFORM_WINRT)
     /** listen the event that renderer was recreated on Android/WP8 */
@@ -296,6 +297,7 @@ GLProgramState::GLProgramState()
         {
             CCLOG("Dirty Uniform and Attributes of GLProgramState"); 
             _uniformAttributeValueDirty = true;
+            bumpMaterialVersion();
         });
     Director::getInstance()->getEventDispatcher()->addEventListenerWithFixedPriority(_backToForegroundlistener, -1);
 #endif
@@ -328,6 +330,7 @@ bool GLProgramState::init(GLProgram* glprogram)
         _uniformsByName[uniform.first] = uniform.second.location;
     }
 
+    bumpMaterialVersion();
     return true;
 }
 
@@ -338,6 +341,15 @@ void GLProgramState::resetGLProgram()
     _attributes.clear();
     // first texture is GL_TEXTURE1
     _textureUnitIndex = 1;
+    bumpMaterialVersion();
+}
+
+void GLProgramState::bumpMaterialVersion()
+{
+    // shared across instances, so a new state allocated at the address of a deleted one
+    // can't be mistaken for it
+    static uint32_t s_materialVersion = 0;
+    _materialVersion = ++s_materialVersion;
 }
 
 void GLProgramState::apply(const Mat4& modelView)
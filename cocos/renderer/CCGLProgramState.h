@@ -260,6 +260,14 @@ public:
     
     /**Get the number of user defined uniform count.*/
     ssize_t getUniformCount() const { return _uniforms.size(); }
+
+    /**
+     Get the material version. It changes whenever the GLProgram or the set of user uniforms is
+     replaced, or the program is rebuilt after the GL context was recreated. Render commands cache
+     their material ID and only regenerate it when this value changes.
+     Versions are unique across all GLProgramState objects.
+     */
+    uint32_t getMaterialVersion() const { return _materialVersion; }
     
     /** @{
      Setting user defined uniforms by uniform string name in the shader.
@@ -295,6 +303,7 @@ protected:
     bool init(GLProgram* program);
     void resetGLProgram();
     void updateUniformsAndAttributes();
+    void bumpMaterialVersion();
     VertexAttribValue* getVertexAttribValue(const std::string &attributeName);
     UniformValue* getUniformValue(const std::string &uniformName);
     UniformValue* getUniformValue(GLint uniformLocation);
@@ -308,6 +317,7 @@ protected:
     int _textureUnitIndex;
     uint32_t _vertexAttribsFlags;
     GLProgram *_glprogram;
+    uint32_t _materialVersion;
 
 #if (CC_TARGET_PLATFORM == CC_PLATFORM_ANDROID || (CC_TARGET_PLATFORM == CC_PLATFORM_WP8) || CC_TARGET_PLATFORM == CC_PLATFORM_WINRT)
     EventListenerCustom* _backToForegroundlistener;
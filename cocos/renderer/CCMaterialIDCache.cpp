@@ -0,0 +1,81 @@
+/****************************************************************************
+ Copyright (c) 2015 Chukong Technologies Inc.
+
+ http://www.cocos2d-x.org
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ****************************************************************************/
+
+
+#include "renderer/CCMaterialIDCache.h"
+
+NS_CC_BEGIN
+
+size_t MaterialIDCache::MaterialKeyHash::operator()(const MaterialKey& key) const
+{
+    uint64_t a = ((uint64_t)key.program << 32) | key.textureID;
+    uint64_t b = ((uint64_t)key.src << 32) | key.dst;
+    uint64_t h = a * 0x9E3779B97F4A7C15ULL ^ b * 0xC2B2AE3D27D4EB4FULL;
+    return (size_t)(h ^ (h >> 32));
+}
+
+MaterialIDCache* MaterialIDCache::getInstance()
+{
+    static MaterialIDCache s_instance;
+    return &s_instance;
+}
+
+MaterialIDCache::MaterialIDCache()
+: _nextMaterialID(1)
+, _lastMaterialID(0)
+{
+    _lastKey.program = 0;
+    _lastKey.textureID = 0;
+    _lastKey.src = 0;
+    _lastKey.dst = 0;
+}
+
+MaterialIDCache::~MaterialIDCache()
+{
+}
+
+uint32_t MaterialIDCache::getMaterialID(GLuint program, GLuint textureID, const BlendFunc& blendFunc)
+{
+    MaterialKey key;
+    key.program = program;
+    key.textureID = textureID;
+    key.src = blendFunc.src;
+    key.dst = blendFunc.dst;
+
+    if (_lastMaterialID != 0 && key == _lastKey)
+        return _lastMaterialID;
+
+    auto result = _materialIDs.insert(std::make_pair(key, _nextMaterialID));
+    if (result.second)
+    {
+        ++_nextMaterialID;
+        CCASSERT(_nextMaterialID != 0, "Material ID overflow");
+    }
+
+    _lastKey = key;
+    _lastMaterialID = result.first->second;
+    return _lastMaterialID;
+}
+
+NS_CC_END
@@ -0,0 +1,105 @@
+/****************************************************************************
+ Copyright (c) 2015 Chukong Technologies Inc.
+
+ http://www.cocos2d-x.org
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ****************************************************************************/
+
+
+#ifndef __CC_MATERIAL_ID_CACHE_H__
+#define __CC_MATERIAL_ID_CACHE_H__
+
+#include <unordered_map>
+
+#include "platform/CCPlatformMacros.h"
+#include "platform/CCGL.h"
+#include "base/ccTypes.h"
+
+/**
+ * @addtogroup support
+ * @{
+ */
+
+NS_CC_BEGIN
+
+/**
+ MaterialIDCache interns the (program, texture, blend function) tuple used by QuadCommand and
+ TrianglesCommand into a small sequential material ID.
+
+ Equal tuples always map to the same ID and different tuples never collide, so the Renderer can
+ batch on ID equality without hashing the tuple again. IDs start at 1; 0 is reserved for
+ Renderer::MATERIAL_ID_DO_NOT_BATCH. The cache lives for the whole process because commands keep
+ the IDs they were given, and reusing an ID for another tuple would merge unrelated batches.
+ */
+class CC_DLL MaterialIDCache
+{
+public:
+    /**Get the MaterialIDCache singleton instance.*/
+    static MaterialIDCache* getInstance();
+
+    /**
+     Get the material ID of a program/texture/blend function tuple, creating one if the tuple has
+     not been seen before.
+     @param program The GL program name.
+     @param textureID The GL texture name.
+     @param blendFunc The blend function.
+     @return A non zero ID that is stable for the lifetime of the process.
+     */
+    uint32_t getMaterialID(GLuint program, GLuint textureID, const BlendFunc& blendFunc);
+
+    /**Get the number of distinct materials interned so far.*/
+    ssize_t getMaterialCount() const { return _materialIDs.size(); }
+
+protected:
+    MaterialIDCache();
+    ~MaterialIDCache();
+
+    struct MaterialKey
+    {
+        GLuint program;
+        GLuint textureID;
+        GLenum src;
+        GLenum dst;
+
+        bool operator==(const MaterialKey& other) const
+        {
+            return program == other.program && textureID == other.textureID && src == other.src && dst == other.dst;
+        }
+    };
+
+    struct MaterialKeyHash
+    {
+        size_t operator()(const MaterialKey& key) const;
+    };
+
+    std::unordered_map<MaterialKey, uint32_t, MaterialKeyHash> _materialIDs;
+    uint32_t _nextMaterialID;
+
+    // Consecutive commands usually share a material, so the last lookup is remembered.
+    MaterialKey _lastKey;
+    uint32_t _lastMaterialID;
+};
+
+NS_CC_END
+/**
+ end of support group
+ @}
+ */
+#endif /* __CC_MATERIAL_ID_CACHE_H__ */
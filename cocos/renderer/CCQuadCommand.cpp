@@ -27,7 +27,7 @@
 
 #include "renderer/ccGLStateCache.h"
 #include "renderer/CCGLProgram.h"
-#include "xxhash.h"
+#include "renderer/CCMaterialIDCache.h"
 #include "CCRenderer.h"
 
 NS_CC_BEGIN
@@ -37,6 +37,7 @@ QuadCommand::QuadCommand()
 :_materialID(0)
 ,_textureID(0)
 ,_glProgramState(nullptr)
+,_glProgramStateVersion(0)
 ,_blendType(BlendFunc::DISABLE)
 ,_quads(nullptr)
 ,_quadsCount(0)
@@ -57,11 +58,13 @@ void QuadCommand::init(float globalOrder, GLuint textureID, GLProgramState* shad
     
     _mv = mv;
     
-    if( _textureID != textureID || _blendType.src != blendType.src || _blendType.dst != blendType.dst || _glProgramState != shader) {
+    if( _textureID != textureID || _blendType.src != blendType.src || _blendType.dst != blendType.dst || _glProgramState != shader ||
+       _glProgramStateVersion != shader->getMaterialVersion()) {
         
         _textureID = textureID;
         _blendType = blendType;
         _glProgramState = shader;
+        _glProgramStateVersion = shader->getMaterialVersion();
         
         generateMaterialID();
     }
@@ -85,10 +88,8 @@ void QuadCommand::generateMaterialID()
     }
     else
     {
-        int glProgram = (int)_glProgramState->getGLProgram()->getProgram();
-        int intArray[4] = { glProgram, (int)_textureID, (int)_blendType.src, (int)_blendType.dst};
-        
-        _materialID = XXH32((const void*)intArray, sizeof(intArray), 0);
+        GLuint glProgram = _glProgramState->getGLProgram()->getProgram();
+        _materialID = MaterialIDCache::getInstance()->getMaterialID(glProgram, _textureID, _blendType);
     }
 }
 
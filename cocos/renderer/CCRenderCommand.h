@@ -97,6 +97,10 @@ public:
     inline void set3D(bool value) { _is3D = value; }
     /**Get the depth by current model view matrix.*/
     inline float getDepth() const { return _depth; }
+    /**Get the sort key, it is built by the RenderQueue when the command is pushed into it.*/
+    inline uint64_t getSortKey() const { return _sortKey; }
+    /**Set the sort key, used by RenderQueue.*/
+    inline void setSortKey(uint64_t key) { _sortKey = key; }
     
 protected:
     /**Constructor.*/
@@ -126,6 +130,9 @@ protected:
     
     /** Depth from the model view matrix.*/
     float _depth;
+
+    /** Packed queue group, global Z order (or depth) and material ID, see RenderQueue::makeSortKey(). */
+    uint64_t _sortKey;
 };
 
 NS_CC_END
@@ -0,0 +1,138 @@
+/****************************************************************************
+ Copyright (c) 2015 Chukong Technologies Inc.
+
+ http://www.cocos2d-x.org
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ****************************************************************************/
+
+
+#include "renderer/CCRenderWorkerPool.h"
+
+#include <algorithm>
+
+NS_CC_BEGIN
+
+RenderWorkerPool::RenderWorkerPool(int workerCount)
+: _generation(0)
+, _stop(false)
+, _busyWorkers(0)
+, _func(nullptr)
+, _count(0)
+, _chunkSize(1)
+, _nextChunk(0)
+{
+    if (workerCount < 0)
+    {
+        int hardware = (int)std::thread::hardware_concurrency();
+        workerCount = std::max(hardware - 1, 0);
+    }
+
+    _workers.reserve(workerCount);
+    for (int i = 0; i < workerCount; ++i)
+    {
+        _workers.push_back(std::thread(&RenderWorkerPool::workerLoop, this));
+    }
+}
+
+RenderWorkerPool::~RenderWorkerPool()
+{
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _wakeCondition.notify_all();
+
+    for (auto& worker : _workers)
+    {
+        worker.join();
+    }
+}
+
+void RenderWorkerPool::parallelFor(ssize_t count, ssize_t minChunkSize, const RangeFunction& func)
+{
+    if (count <= 0)
+        return;
+
+    // a few chunks per thread keeps the load balanced when some slices are more expensive than others
+    ssize_t chunkSize = std::max(minChunkSize, count / (getConcurrency() * 4) + 1);
+    if (_workers.empty() || chunkSize >= count)
+    {
+        func(0, count);
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _func = &func;
+        _count = count;
+        _chunkSize = chunkSize;
+        _nextChunk = 0;
+        _busyWorkers = (int)_workers.size();
+        ++_generation;
+    }
+    _wakeCondition.notify_all();
+
+    runChunks();
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _doneCondition.wait(lock, [this]{ return _busyWorkers == 0; });
+    _func = nullptr;
+}
+
+void RenderWorkerPool::runChunks()
+{
+    for (;;)
+    {
+        ssize_t begin = _nextChunk.fetch_add(1) * _chunkSize;
+        if (begin >= _count)
+            break;
+
+        (*_func)(begin, std::min(begin + _chunkSize, _count));
+    }
+}
+
+void RenderWorkerPool::workerLoop()
+{
+    unsigned int seenGeneration = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wakeCondition.wait(lock, [&]{ return _stop || _generation != seenGeneration; });
+            if (_stop)
+                return;
+            seenGeneration = _generation;
+        }
+
+        runChunks();
+
+        bool last = false;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            last = (--_busyWorkers == 0);
+        }
+        if (last)
+        {
+            _doneCondition.notify_one();
+        }
+    }
+}
+
+NS_CC_END
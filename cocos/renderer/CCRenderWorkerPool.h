@@ -0,0 +1,99 @@
+/****************************************************************************
+ Copyright (c) 2015 Chukong Technologies Inc.
+
+ http://www.cocos2d-x.org
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ****************************************************************************/
+
+
+#ifndef __CC_RENDER_WORKER_POOL_H__
+#define __CC_RENDER_WORKER_POOL_H__
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+
+#include "platform/CCPlatformMacros.h"
+
+/**
+ * @addtogroup support
+ * @{
+ */
+
+NS_CC_BEGIN
+
+/**
+ A small fork-join pool used by the renderer to split CPU side work (e.g. vertex transforms) of one batch
+ across several threads. The calling thread always takes part in the work and `parallelFor` only returns
+ once every chunk has been processed, so no GL call is ever made outside of the calling thread.
+ */
+class CC_DLL RenderWorkerPool
+{
+public:
+    /** Range callback, processes the elements in [begin, end). */
+    typedef std::function<void(ssize_t begin, ssize_t end)> RangeFunction;
+
+    /**Constructor.
+     @param workerCount The number of extra threads. If it is negative, the hardware concurrency minus one is used.
+     */
+    explicit RenderWorkerPool(int workerCount = -1);
+    /**Destructor. Joins all worker threads.*/
+    ~RenderWorkerPool();
+
+    /** Returns the number of threads taking part in a `parallelFor`, including the calling thread. */
+    int getConcurrency() const { return (int)_workers.size() + 1; }
+
+    /** Splits [0, count) into chunks of at least `minChunkSize` elements and runs `func` over them on the
+     workers and the calling thread. Blocks until all chunks are done.
+     */
+    void parallelFor(ssize_t count, ssize_t minChunkSize, const RangeFunction& func);
+
+protected:
+    void workerLoop();
+    void runChunks();
+
+    std::vector<std::thread> _workers;
+
+    std::mutex _mutex;
+    std::condition_variable _wakeCondition;
+    std::condition_variable _doneCondition;
+    // bumped on every parallelFor so that sleeping workers know there is new work
+    unsigned int _generation;
+    bool _stop;
+    // number of workers that have not finished the current job yet
+    int _busyWorkers;
+
+    // current job
+    const RangeFunction* _func;
+    ssize_t _count;
+    ssize_t _chunkSize;
+    std::atomic<ssize_t> _nextChunk;
+};
+
+NS_CC_END
+
+/**
+ end of support group
+ @}
+ */
+#endif //__CC_RENDER_WORKER_POOL_H__
@@ -45,6 +45,8 @@ class EventListenerCustom;
 class QuadCommand;
 class TrianglesCommand;
 class MeshCommand;
+class RenderWorkerPool;
+class StreamingVertexBuffer;
 
 /** Class that knows how to sort `RenderCommand` objects.
  Since the commands that have `z == 0` are "pushed back" in
@@ -84,8 +86,11 @@ public:
     void push_back(RenderCommand* command);
     /**Return the number of render commands.*/
     ssize_t size() const;
-    /**Sort the render commands.*/
-    void sort();
+    /**Sort the render commands.
+     @param groupMaterials If true, commands with the same global Z order are also sorted by material ID, which
+     batches better but changes the drawing order of overlapping 2D commands with the same global Z order.
+     */
+    void sort(bool groupMaterials = false);
     /**Treat sorted commands as an array, access them one by one.*/
     RenderCommand* operator[](ssize_t index) const;
     /**Clear all rendered commands.*/
@@ -101,11 +106,30 @@ public:
     void saveRenderState();
     /**Restore the saved DepthState, CullState, DepthWriteState render state.*/
     void restoreRenderState();
+
+    /**
+     Build the 64 bits sort key of a command: 3 bits of queue group, 32 bits of order and 29 bits of material ID.
+     The order is the global Z order, or the inverted depth for transparent 3D commands which are drawn back to front.
+     */
+    static uint64_t makeSortKey(QUEUE_GROUP group, RenderCommand* command);
+    
+protected:
+    /**Stable LSD radix sort of a sub queue on the sort keys of the commands, masked by keyMask.*/
+    void radixSort(std::vector<RenderCommand*>& commands, uint64_t keyMask);
     
 protected:
     /**The commands in the render queue.*/
     //存储command id,第一个是0，其他用于groupCommand,
     std::vector<RenderCommand*> _commands[QUEUE_COUNT];
+
+    /**Key/command pairs used by radixSort(), kept around to avoid reallocating them every frame.*/
+    struct SortEntry
+    {
+        uint64_t key;
+        RenderCommand* command;
+    };
+    std::vector<SortEntry> _sortEntries;
+    std::vector<SortEntry> _sortScratch;
     
     /**Cull state.*/
     bool _isCullEnabled;
@@ -131,9 +155,9 @@ Whenever possible prefer to use `QuadCommand` objects since the renderer will au
 class CC_DLL Renderer
 {
 public:
-    /**The max number of vertices in a vertex buffer object.*/
+    /**The number of vertices in a page of the vertex pool. 16 bits indices can't address more vertices in one draw call.*/
     static const int VBO_SIZE = 65536;
-    /**The max numer of indices in a index buffer.*/
+    /**The initial number of indices of the index pool, it grows on demand.*/
     static const int INDEX_VBO_SIZE = VBO_SIZE * 6 / 4;
     /**The rendercommands which can be batched will be saved into a list, this is the reversed size of this list.*/
     static const int BATCH_QUADCOMMAND_RESEVER_SIZE = 64;
@@ -181,8 +205,10 @@ public:
     ssize_t getDrawnVertices() const { return _drawnVertices; }
     /* RenderCommands (except) QuadCommand should update this value */
     void addDrawnVertices(ssize_t number) { _drawnVertices += number; };
+    /* returns the number of times a batch continued on a new page of the vertex pool in the last frame */
+    ssize_t getCapacityFlushes() const { return _capacityFlushes; }
     /* clear draw stats */
-    void clearDrawStats() { _drawnBatches = _drawnVertices = 0; }
+    void clearDrawStats() { _drawnBatches = _drawnVertices = _capacityFlushes = 0; }
 
     /**
      * Enable/Disable depth test
@@ -194,9 +220,40 @@ public:
     //This will not be used outside.
     inline GroupCommandManager* getGroupCommandManager() const { return _groupCommandManager; };
 
+    /**
+     * Enable/Disable material grouping when sorting the render queues.
+     * When enabled, commands with the same global Z order are sorted by material ID so that more of them can be batched.
+     * Overlapping 2D commands with the same global Z order and different materials may then be drawn in another order.
+     * Disabled by default.
+     */
+    void setMaterialGroupingEnabled(bool enabled) { _groupMaterials = enabled; }
+    /** Returns whether the render queues are sorted by material ID. */
+    bool isMaterialGroupingEnabled() const { return _groupMaterials; }
+
     /** returns whether or not a rectangle is visible or not */
     bool checkVisibility(const Mat4& transform, const Size& size);
 
+    /**
+     * Enable/Disable the parallel fill stage.
+     * When enabled, the model-view transform of the vertices of a batch is split across a pool of worker threads
+     * before the batch is uploaded. GL calls are still issued from the rendering thread only.
+     * Default value is CC_ENABLE_RENDERER_PARALLEL_FILL.
+     */
+    void setParallelFillEnabled(bool enabled);
+    /** Returns whether the parallel fill stage is enabled or not. */
+    bool isParallelFillEnabled() const { return _parallelFillEnabled; }
+    /** Batches with fewer vertices than this threshold are filled on the rendering thread only. */
+    void setParallelFillThreshold(ssize_t vertexCount) { _parallelFillThreshold = vertexCount; }
+    /** Returns the minimum number of vertices a batch needs to be filled in parallel. */
+    ssize_t getParallelFillThreshold() const { return _parallelFillThreshold; }
+
+    /**
+     * Returns the worker pool of the parallel fill stage, creating it on first use.
+     * Other CPU side work done on the rendering thread between two frames (e.g. the parallel particle update)
+     * can share it, so the features don't start competing pools.
+     */
+    RenderWorkerPool* getWorkerPool();
+
 protected:
 
     //Setup VBO or VAO based on OpenGL extensions
@@ -204,6 +261,9 @@ protected:
     void setupVBOAndVAO();
     void setupVBO();
     void mapBuffers();
+    void bindStreamingVertexBuffer(GLuint vao, int firstVertex);
+    //stop streaming when the ring can't hold a batch, the batches are uploaded to _buffersVBO and _quadbuffersVBO again
+    void dropVertexStream();
     void drawBatchedTriangles();
     void drawBatchedQuads();
 
@@ -220,8 +280,19 @@ protected:
     void processRenderCommand(RenderCommand* command);
     void visitRenderQueue(RenderQueue& queue);
 
-    void fillVerticesAndIndices(const TrianglesCommand* cmd);
-    void fillQuads(const QuadCommand* cmd);
+    //Copy and transform the vertices [first, last) of a command into `vertices`, which is either the
+    //CPU side batch buffer or the mapped streaming buffer.
+    //The commands are only counted when they are queued, the buffers are filled right before the batch is drawn.
+    void fillVerticesAndIndices(const TrianglesCommand* cmd, ssize_t first, ssize_t last, V3F_C4B_T2F* vertices, ssize_t vertexOffset, ssize_t indexOffset);
+    void fillQuads(const QuadCommand* cmd, ssize_t first, ssize_t last, V3F_C4B_T2F* vertices, ssize_t vertexOffset);
+    //Fill the vertices [begin, end) of the current batch, which is one page of the vertex pool.
+    void fillBatchedTriangles(V3F_C4B_T2F* vertices, ssize_t begin, ssize_t end, ssize_t indexBegin);
+    void fillBatchedQuads(V3F_C4B_T2F* vertices, ssize_t begin, ssize_t end);
+    void uploadTrianglesPage(ssize_t vertexBegin, ssize_t vertexEnd, ssize_t indexBegin, ssize_t indexEnd);
+    void uploadQuadsPage(ssize_t vertexBegin, ssize_t vertexEnd);
+    //make the 32 bits quad index buffer hold at least quadCount quads
+    void ensureQuadIndicesUint(ssize_t quadCount);
+    bool shouldFillInParallel(ssize_t vertexCount);
 
     /* clear color set outside be used in setGLDefaultValues() */
     Color4F _clearColor;
@@ -236,9 +307,11 @@ protected:
     std::vector<TrianglesCommand*> _batchedCommands;
     std::vector<QuadCommand*> _batchQuadCommands;
 
-    //for TrianglesCommand
-    V3F_C4B_T2F _verts[VBO_SIZE];//这就是所有缓存的四边形
-    GLushort _indices[INDEX_VBO_SIZE];//索引数组，发送到显存后其实可以删除了
+    //for TrianglesCommand, pool of one page which grows on demand
+    std::vector<V3F_C4B_T2F> _verts;//这就是所有缓存的四边形
+    std::vector<GLushort> _indices;//索引数组，发送到显存后其实可以删除了
+    std::vector<GLuint> _indices32;//used instead of _indices when 32 bits indices are supported
+    bool _useIndexUint;
     GLuint _buffersVAO;
     GLuint _buffersVBO[2]; //0: vertex  1: indices
 
@@ -250,17 +323,35 @@ protected:
     GLushort _quadIndices[INDEX_VBO_SIZE];
     GLuint _quadVAO;
     GLuint _quadbuffersVBO[2]; //0: vertex  1: indices
+    //used instead of _quadIndices when 32 bits indices are supported, grows with the biggest batch
+    std::vector<GLuint> _quadIndices32;
+    GLuint _quadIndexUintVBO;
+    ssize_t _quadIndexUintCount;
     int _numberQuads;//一次渲染中，有多少四边形
+
+    //ring buffer the batched vertices are streamed into, see CC_ENABLE_RENDERER_STREAMING_BUFFERS
+    StreamingVertexBuffer* _vertexStream;
     
     bool _glViewAssigned;
 
     // stats
     ssize_t _drawnBatches;//记录调用glDrawElements的次数
     ssize_t _drawnVertices;//记录参与绘制的顶点个数
+    ssize_t _capacityFlushes;//batches which continued on a new page of the vertex pool
     //the flag for checking whether renderer is rendering
     bool _isRendering;
     
     bool _isDepthTestFor2D;
+
+    bool _groupMaterials;
+
+    // parallel fill stage
+    bool _parallelFillEnabled;
+    ssize_t _parallelFillThreshold;
+    RenderWorkerPool* _fillWorkers;
+    //start vertex/index of every batched command inside the batch buffers
+    std::vector<ssize_t> _batchVertexOffsets;
+    std::vector<ssize_t> _batchIndexOffsets;
     
     GroupCommandManager* _groupCommandManager;//管理group command 的id的生成
     
@@ -0,0 +1,275 @@
+/****************************************************************************
+ Copyright (c) 2015 Chukong Technologies Inc.
+
+ http://www.cocos2d-x.org
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ****************************************************************************/
+
+
+#include "renderer/CCStreamingVertexBuffer.h"
+
+#include "base/CCConfiguration.h"
+#include "base/ccMacros.h"
+
+NS_CC_BEGIN
+
+#if defined(GL_SYNC_GPU_COMMANDS_COMPLETE)
+#define CC_STREAMING_BUFFER_FENCES 1
+#else
+#define CC_STREAMING_BUFFER_FENCES 0
+#endif
+
+#if defined(GL_MAP_WRITE_BIT) && defined(GL_MAP_UNSYNCHRONIZED_BIT)
+#define CC_STREAMING_BUFFER_MAP_RANGE 1
+#else
+#define CC_STREAMING_BUFFER_MAP_RANGE 0
+#endif
+
+#if CC_STREAMING_BUFFER_MAP_RANGE && CC_STREAMING_BUFFER_FENCES && defined(GL_MAP_PERSISTENT_BIT) && defined(GL_MAP_COHERENT_BIT)
+#define CC_STREAMING_BUFFER_PERSISTENT 1
+#else
+#define CC_STREAMING_BUFFER_PERSISTENT 0
+#endif
+
+StreamingVertexBuffer::StreamingVertexBuffer()
+: _vbo(0)
+, _mode(Mode::SUB_DATA)
+, _useFences(false)
+, _sizePerVertex(0)
+, _segmentVertexCount(0)
+, _currentSegment(0)
+, _head(0)
+, _reservedFirst(0)
+, _reservedCount(0)
+, _reservedStorage(nullptr)
+, _mappedStorage(nullptr)
+{
+    for (int i = 0; i < SEGMENT_COUNT; ++i)
+    {
+        _fences[i] = nullptr;
+    }
+}
+
+StreamingVertexBuffer::~StreamingVertexBuffer()
+{
+    deleteBuffer();
+}
+
+void StreamingVertexBuffer::deleteBuffer()
+{
+#if CC_STREAMING_BUFFER_FENCES
+    for (int i = 0; i < SEGMENT_COUNT; ++i)
+    {
+        if (_fences[i])
+        {
+            glDeleteSync((GLsync)_fences[i]);
+            _fences[i] = nullptr;
+        }
+    }
+#endif
+
+    if (_vbo && glIsBuffer(_vbo))
+    {
+        if (_mappedStorage)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, _vbo);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &_vbo);
+    }
+    _vbo = 0;
+    _mappedStorage = nullptr;
+}
+
+bool StreamingVertexBuffer::init(int sizePerVertex, int segmentVertexCount)
+{
+    // after a context loss the old names are already gone, don't delete them twice
+    for (int i = 0; i < SEGMENT_COUNT; ++i)
+    {
+        _fences[i] = nullptr;
+    }
+    _vbo = 0;
+    _mappedStorage = nullptr;
+
+    _sizePerVertex = sizePerVertex;
+    _segmentVertexCount = segmentVertexCount;
+    _currentSegment = 0;
+    _head = 0;
+    _reservedCount = 0;
+
+    auto conf = Configuration::getInstance();
+    _useFences = CC_STREAMING_BUFFER_FENCES && conf->supportsFenceSync();
+    _mode = Mode::SUB_DATA;
+    if (CC_STREAMING_BUFFER_MAP_RANGE && conf->supportsMapBufferRange())
+    {
+        _mode = Mode::MAP_RANGE;
+        if (CC_STREAMING_BUFFER_PERSISTENT && _useFences && conf->checkForGLExtension("GL_ARB_buffer_storage"))
+        {
+            _mode = Mode::PERSISTENT_MAP;
+        }
+    }
+
+    const GLsizeiptr size = (GLsizeiptr)_sizePerVertex * _segmentVertexCount * SEGMENT_COUNT;
+
+    glGenBuffers(1, &_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, _vbo);
+
+#if CC_STREAMING_BUFFER_PERSISTENT
+    if (_mode == Mode::PERSISTENT_MAP)
+    {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+        _mappedStorage = (unsigned char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+        if (_mappedStorage == nullptr)
+        {
+            // immutable storage can't be mapped in some other way, start again with a mutable buffer
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glDeleteBuffers(1, &_vbo);
+            glGenBuffers(1, &_vbo);
+            glBindBuffer(GL_ARRAY_BUFFER, _vbo);
+            _mode = Mode::MAP_RANGE;
+        }
+    }
+#endif
+
+    if (_mode != Mode::PERSISTENT_MAP)
+    {
+        glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    CHECK_GL_ERROR_DEBUG();
+
+    return _vbo != 0;
+}
+
+bool StreamingVertexBuffer::ensureSegmentCapacity(int segmentVertexCount)
+{
+    if (segmentVertexCount <= _segmentVertexCount)
+        return true;
+
+    int newCount = _segmentVertexCount > 0 ? _segmentVertexCount : 1;
+    while (newCount < segmentVertexCount)
+    {
+        newCount *= 2;
+    }
+
+    deleteBuffer();
+    return init(_sizePerVertex, newCount);
+}
+
+void StreamingVertexBuffer::waitForSegment(int segment)
+{
+#if CC_STREAMING_BUFFER_FENCES
+    GLsync fence = (GLsync)_fences[segment];
+    if (fence)
+    {
+        GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        while (result == GL_TIMEOUT_EXPIRED)
+        {
+            // 1ms
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+        }
+        glDeleteSync(fence);
+        _fences[segment] = nullptr;
+    }
+#endif
+}
+
+void StreamingVertexBuffer::nextSegment()
+{
+#if CC_STREAMING_BUFFER_FENCES
+    if (_useFences)
+    {
+        _fences[_currentSegment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+#endif
+
+    _currentSegment = (_currentSegment + 1) % SEGMENT_COUNT;
+    _head = 0;
+
+    if (_useFences)
+    {
+        waitForSegment(_currentSegment);
+    }
+    else if (_currentSegment == 0)
+    {
+        // no way to know whether the GPU is done with the ring, let the driver hand out fresh storage
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)_sizePerVertex * _segmentVertexCount * SEGMENT_COUNT, nullptr, GL_STREAM_DRAW);
+    }
+}
+
+void* StreamingVertexBuffer::reserve(int count, int* firstVertex)
+{
+    CCASSERT(count > 0 && count <= _segmentVertexCount, "Batch is bigger than a segment of the streaming buffer");
+    CCASSERT(_reservedCount == 0, "commit() was not called for the previous batch");
+
+    glBindBuffer(GL_ARRAY_BUFFER, _vbo);
+
+    if (_head + count > _segmentVertexCount)
+    {
+        nextSegment();
+    }
+
+    _reservedFirst = _currentSegment * _segmentVertexCount + _head;
+    _reservedCount = count;
+    _head += count;
+    *firstVertex = _reservedFirst;
+
+    const GLintptr offset = (GLintptr)_reservedFirst * _sizePerVertex;
+    const GLsizeiptr length = (GLsizeiptr)count * _sizePerVertex;
+
+    _reservedStorage = nullptr;
+    if (_mode == Mode::PERSISTENT_MAP)
+    {
+        _reservedStorage = _mappedStorage + offset;
+    }
+#if CC_STREAMING_BUFFER_MAP_RANGE
+    else if (_mode == Mode::MAP_RANGE)
+    {
+        // the range is either fenced or freshly orphaned, the driver doesn't need to synchronize
+        _reservedStorage = glMapBufferRange(GL_ARRAY_BUFFER, offset, length, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    }
+#endif
+    CC_UNUSED_PARAM(length);
+
+    return _reservedStorage;
+}
+
+void StreamingVertexBuffer::commit(const void* data)
+{
+    if (_reservedStorage)
+    {
+        if (_mode == Mode::MAP_RANGE)
+        {
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+        }
+    }
+    else
+    {
+        // SUB_DATA mode, or the range could not be mapped
+        glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)_reservedFirst * _sizePerVertex, (GLsizeiptr)_reservedCount * _sizePerVertex, data);
+    }
+
+    _reservedCount = 0;
+}
+
+NS_CC_END
@@ -0,0 +1,136 @@
+/****************************************************************************
+ Copyright (c) 2015 Chukong Technologies Inc.
+
+ http://www.cocos2d-x.org
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ****************************************************************************/
+
+
+#ifndef __CC_STREAMING_VERTEX_BUFFER_H__
+#define __CC_STREAMING_VERTEX_BUFFER_H__
+
+#include "platform/CCPlatformMacros.h"
+#include "platform/CCGL.h"
+
+/**
+ * @addtogroup support
+ * @{
+ */
+
+NS_CC_BEGIN
+
+/**
+ StreamingVertexBuffer is a ring of vertex storage used by the renderer to upload batched vertices.
+ The buffer is split into several segments, vertices are appended to the current segment and the
+ ring moves to the next segment when the current one is full. Segments are only written again once
+ the GPU is done with them, which is tracked with fences where they are available, or by orphaning
+ the whole buffer when the ring wraps around.
+
+ Depending on the GL driver the storage is either persistently mapped, mapped per batch with
+ glMapBufferRange, or updated with glBufferSubData at increasing offsets.
+ @js NA
+ */
+class CC_DLL StreamingVertexBuffer
+{
+public:
+    /** How the vertices reach the GPU. */
+    enum class Mode
+    {
+        /** Storage is mapped once and written directly (GL_ARB_buffer_storage). */
+        PERSISTENT_MAP,
+        /** Every batch maps its own range unsynchronized (GL_EXT/ARB_map_buffer_range). */
+        MAP_RANGE,
+        /** Vertices are built on the CPU and uploaded with glBufferSubData. */
+        SUB_DATA,
+    };
+
+    /** The number of segments of the ring. */
+    static const int SEGMENT_COUNT = 3;
+
+    /**Constructor.*/
+    StreamingVertexBuffer();
+    /**Destructor, deletes the GL objects.*/
+    ~StreamingVertexBuffer();
+
+    /**
+     Creates the GL buffer. Can be called again to recreate the buffer after the GL context was lost.
+     @param sizePerVertex Size in bytes of one vertex.
+     @param segmentVertexCount The number of vertices of one segment, which is also the biggest batch that can be reserved.
+     */
+    bool init(int sizePerVertex, int segmentVertexCount);
+
+    /**
+     Reserves room for `count` vertices.
+     @param count The number of vertices of the batch.
+     @param firstVertex Returns the position of the first reserved vertex inside the GL buffer.
+     @return A write only pointer to the reserved storage, or nullptr if the storage can't be mapped (e.g. in SUB_DATA mode).
+     In that case the vertices must be passed to `commit()`.
+     */
+    void* reserve(int count, int* firstVertex);
+    /**
+     Finishes the batch started with `reserve()`.
+     @param data The vertices to upload if `reserve()` returned nullptr, ignored otherwise.
+     */
+    void commit(const void* data);
+
+    /**
+     Makes sure a batch of `segmentVertexCount` vertices can be reserved, recreating a bigger buffer if needed.
+     Batches which were already drawn are not affected, GL keeps the old storage alive until it is not used anymore.
+     */
+    bool ensureSegmentCapacity(int segmentVertexCount);
+
+    /** Get the number of vertices of one segment. */
+    int getSegmentVertexCount() const { return _segmentVertexCount; }
+    /** Get the openGL handle of the buffer. */
+    GLuint getVBO() const { return _vbo; }
+    /** Get the upload mode picked for this GL driver. */
+    Mode getMode() const { return _mode; }
+
+protected:
+    void deleteBuffer();
+    void nextSegment();
+    void waitForSegment(int segment);
+
+    GLuint _vbo;
+    Mode _mode;
+    bool _useFences;
+    int _sizePerVertex;
+    int _segmentVertexCount;
+    int _currentSegment;
+    // next free vertex inside the current segment
+    int _head;
+    // the batch being written between reserve() and commit()
+    int _reservedFirst;
+    int _reservedCount;
+    // where the batch is written, nullptr when the vertices are uploaded by commit()
+    void* _reservedStorage;
+    // base pointer of the storage in PERSISTENT_MAP mode
+    unsigned char* _mappedStorage;
+    // one fence per segment, set when the ring leaves the segment
+    void* _fences[SEGMENT_COUNT];
+};
+
+NS_CC_END
+
+/**
+ end of support group
+ @}
+ */
+#endif //__CC_STREAMING_VERTEX_BUFFER_H__
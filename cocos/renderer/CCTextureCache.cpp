@@ -59,11 +59,20 @@ TextureCache * TextureCache::getInstance()
 }
 
 TextureCache::TextureCache()
-: _loadingThread(nullptr)
-, _asyncStructQueue(nullptr)
-, _imageInfoQueue(nullptr)
+: _asyncWorkerCount(1)
+, _nextAsyncTicket(0)
+, _asyncDecodingCount(0)
 , _needQuit(false)
 , _asyncRefCount(0)
+, _nextAsyncSequence(0)
+, _nextDeliveryTicket(0)
+, _asyncCoalescedCount(0)
+, _asyncLoadedCount(0)
+, _asyncTotalDecodeTime(0)
+, _asyncCallbackScheduled(false)
+, _asyncUploadTimeBudget(0)
+, _asyncUploadByteBudget(0)
+, _asyncMipmapsEnabled(false)
 {
 }
 
@@ -74,7 +83,11 @@ TextureCache::~TextureCache()
     for( auto it=_textures.begin(); it!=_textures.end(); ++it)
         (it->second)->release();
 
-    CC_SAFE_DELETE(_loadingThread);
+    for (auto thread : _loadingThreads)
+        delete thread;
+
+    for (auto& pending : _pendingMipmapTextures)
+        pending.second->release();
 }
 
 void TextureCache::destroyInstance()
@@ -96,6 +109,11 @@ std::string TextureCache::getDescription() const
 }
 
 void TextureCache::addImageAsync(const std::string &path, const std::function<void(Texture2D*)>& callback)
+{
+    addImageAsync(path, callback, 0);
+}
+
+void TextureCache::addImageAsync(const std::string &path, const std::function<void(Texture2D*)>& callback, int priority)
 {
     Texture2D *texture = nullptr;
 
@@ -111,170 +129,199 @@ void TextureCache::addImageAsync(const std::string &path, const std::function<vo
         return;
     }
 
-    // lazy init
-    if (_asyncStructQueue == nullptr)
-    {             
-        _asyncStructQueue = new queue<AsyncStruct*>();
-        _imageInfoQueue   = new deque<ImageInfo*>();        
-
-        // create a new thread to load images
-        _loadingThread = new std::thread(&TextureCache::loadImage, this);
+    // the file is already being loaded, wait for the same image
+    auto inFlight = _asyncStructsInFlight.find(fullpath);
+    if (inFlight != _asyncStructsInFlight.end())
+    {
+        inFlight->second->callbacks.push_back(callback);
+        ++_asyncCoalescedCount;
+        return;
+    }
 
-        _needQuit = false;
+    // lazy init, create the missing threads to load images
+    while (_loadingThreads.size() < static_cast<size_t>(_asyncWorkerCount))
+    {
+        _loadingThreads.push_back(new std::thread(&TextureCache::loadImage, this));
     }
 
-    if (0 == _asyncRefCount)
+    if (!_asyncCallbackScheduled)
     {
         Director::getInstance()->getScheduler()->schedule(CC_SCHEDULE_SELECTOR(TextureCache::addImageAsyncCallBack), this, 0, false);
+        _asyncCallbackScheduled = true;
     }
 
     ++_asyncRefCount;
 
     // generate async struct
-    AsyncStruct *data = new (std::nothrow) AsyncStruct(fullpath, callback);
+    AsyncStruct *data = new (std::nothrow) AsyncStruct(fullpath, callback, priority, _nextAsyncSequence++);
+    _asyncStructsInFlight.insert(std::make_pair(fullpath, data));
 
     // add async struct into queue
     _asyncStructQueueMutex.lock();
-    _asyncStructQueue->push(data);
+    _asyncStructQueue.push(data);
     _asyncStructQueueMutex.unlock();
 
     _sleepCondition.notify_one();
 }
 
-void TextureCache::unbindImageAsync(const std::string& filename)
+void TextureCache::setAsyncWorkerCount(int count)
 {
+    _asyncWorkerCount = std::max(count, 1);
+}
+
+TextureCache::AsyncLoadStats TextureCache::getAsyncLoadStats() const
+{
+    AsyncLoadStats stats;
+
+    _asyncStructQueueMutex.lock();
+    stats.queued = _asyncStructQueue.size();
+    stats.decoding = _asyncDecodingCount;
+    _asyncStructQueueMutex.unlock();
+
     _imageInfoMutex.lock();
-    if (_imageInfoQueue && !_imageInfoQueue->empty())
+    stats.decoded = _decodedAsyncStructs.size();
+    _imageInfoMutex.unlock();
+
+    stats.pendingMipmaps = _pendingMipmapTextures.size();
+    stats.coalesced = _asyncCoalescedCount;
+    stats.loaded = _asyncLoadedCount;
+    stats.totalDecodeTime = _asyncTotalDecodeTime;
+    return stats;
+}
+
+float TextureCache::getAsyncDecodeTime(const std::string &filepath) const
+{
+    std::string fullpath = FileUtils::getInstance()->fullPathForFilename(filepath);
+    auto it = _asyncDecodeTimes.find(fullpath);
+    if (it != _asyncDecodeTimes.end())
+        return it->second;
+    return -1;
+}
+
+void TextureCache::unbindImageAsync(const std::string& filename)
+{
+    std::string fullpath = FileUtils::getInstance()->fullPathForFilename(filename);
+    auto found = _asyncStructsInFlight.find(fullpath);
+    if (found != _asyncStructsInFlight.end())
     {
-        std::string fullpath = FileUtils::getInstance()->fullPathForFilename(filename);
-        auto found = std::find_if(_imageInfoQueue->begin(), _imageInfoQueue->end(), [&fullpath](ImageInfo* ptr)->bool{ return ptr->asyncStruct->filename == fullpath; });
-        if (found != _imageInfoQueue->end())
-        {
-            (*found)->asyncStruct->callback = nullptr;
-        }
+        found->second->callbacks.clear();
     }
-    _imageInfoMutex.unlock();
 }
 
 void TextureCache::unbindAllImageAsync()
 {
-    _imageInfoMutex.lock();
-    if (_imageInfoQueue && !_imageInfoQueue->empty())
+    for (auto& pair : _asyncStructsInFlight)
     {
-        std::for_each(_imageInfoQueue->begin(), _imageInfoQueue->end(), [](ImageInfo* ptr) { ptr->asyncStruct->callback = nullptr; });
+        pair.second->callbacks.clear();
     }
-    _imageInfoMutex.unlock();
 }
 
 void TextureCache::loadImage()
 {
-    AsyncStruct *asyncStruct = nullptr;
-
     while (true)
     {
-        std::queue<AsyncStruct*> *pQueue = _asyncStructQueue;
-        _asyncStructQueueMutex.lock();
-        if (pQueue->empty())
+        AsyncStruct *asyncStruct = nullptr;
         {
-            _asyncStructQueueMutex.unlock();
-            if (_needQuit) {
-                break;
-            }
-            else {
-                std::unique_lock<std::mutex> lk(_sleepMutex);
+            std::unique_lock<std::mutex> lk(_asyncStructQueueMutex);
+            while (_asyncStructQueue.empty() && !_needQuit)
+            {
                 _sleepCondition.wait(lk);
-                continue;
             }
-        }
-        else
-        {
-            asyncStruct = pQueue->front();
-            pQueue->pop();
-            _asyncStructQueueMutex.unlock();
-        }        
-
-        Image *image = nullptr;
-        bool generateImage = false;
+            if (_asyncStructQueue.empty())
+            {
+                break;
+            }
 
-        auto it = _textures.find(asyncStruct->filename);
-        if( it == _textures.end() )
-        {
-           _imageInfoMutex.lock();
-           ImageInfo *imageInfo;
-           size_t pos = 0;
-           size_t infoSize = _imageInfoQueue->size();
-           for (; pos < infoSize; pos++)
-           {
-               imageInfo = (*_imageInfoQueue)[pos];
-               if(imageInfo->asyncStruct->filename.compare(asyncStruct->filename) == 0)
-                   break;
-           }
-           _imageInfoMutex.unlock();
-           if(infoSize == 0 || pos == infoSize)
-               generateImage = true;
+            asyncStruct = _asyncStructQueue.top();
+            _asyncStructQueue.pop();
+            asyncStruct->ticket = _nextAsyncTicket++;
+            ++_asyncDecodingCount;
         }
 
-        if (generateImage)
+        // generate image, the main thread checks _textures again before using it
+        auto start = std::chrono::steady_clock::now();
+        const std::string& filename = asyncStruct->filename;
+        Image *image = new (std::nothrow) Image();
+        if (image && !image->initWithImageFileThreadSafe(filename))
         {
-            const std::string& filename = asyncStruct->filename;
-            // generate image      
-            image = new (std::nothrow) Image();
-            if (image && !image->initWithImageFileThreadSafe(filename))
-            {
-                CC_SAFE_RELEASE(image);
-                CCLOG("can not load %s", filename.c_str());
-                continue;
-            }
-        }    
-
-        // generate image info
-        ImageInfo *imageInfo = new (std::nothrow) ImageInfo();
-        imageInfo->asyncStruct = asyncStruct;
-        imageInfo->image = image;
+            CC_SAFE_RELEASE_NULL(image);
+            CCLOG("can not load %s", filename.c_str());
+        }
+        asyncStruct->image = image;
+        asyncStruct->decodeTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() / 1000000.0f;
 
-        // put the image info into the queue
+        // hand the image over before giving up the decoding slot, so the counters never lose it
         _imageInfoMutex.lock();
-        _imageInfoQueue->push_back(imageInfo);
+        _decodedAsyncStructs.insert(std::make_pair(asyncStruct->ticket, asyncStruct));
         _imageInfoMutex.unlock();
+
+        _asyncStructQueueMutex.lock();
+        --_asyncDecodingCount;
+        _asyncStructQueueMutex.unlock();
     }
-    
-	if(_asyncStructQueue != nullptr)
+}
+
+bool TextureCache::hasAsyncUploadBudget(const std::chrono::steady_clock::time_point& start, size_t uploadedBytes) const
+{
+    if (_asyncUploadTimeBudget <= 0 && _asyncUploadByteBudget == 0)
+        return false;
+
+    if (_asyncUploadByteBudget > 0 && uploadedBytes >= _asyncUploadByteBudget)
+        return false;
+
+    if (_asyncUploadTimeBudget > 0)
     {
-        delete _asyncStructQueue;
-	    _asyncStructQueue = nullptr;
-        delete _imageInfoQueue;
-	    _imageInfoQueue = nullptr;
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        if (elapsed >= _asyncUploadTimeBudget * 1000)
+            return false;
     }
+    return true;
 }
 
 void TextureCache::addImageAsyncCallBack(float dt)
 {
-    // the image is generated in loading thread
-    std::deque<ImageInfo*> *imagesQueue = _imageInfoQueue;
+    auto start = std::chrono::steady_clock::now();
+    size_t uploadedBytes = 0;
+    bool uploaded = false;
 
-    _imageInfoMutex.lock();
-    if (imagesQueue->empty())
+    // the images are generated in loading threads, deliver them in the order they were picked up
+    while (!uploaded || hasAsyncUploadBudget(start, uploadedBytes))
     {
-        _imageInfoMutex.unlock();
-    }
-    else
-    {
-        ImageInfo *imageInfo = imagesQueue->front();
-        imagesQueue->pop_front();
+        AsyncStruct *asyncStruct = nullptr;
+
+        _imageInfoMutex.lock();
+        auto found = _decodedAsyncStructs.find(_nextDeliveryTicket);
+        if (found != _decodedAsyncStructs.end())
+        {
+            asyncStruct = found->second;
+            _decodedAsyncStructs.erase(found);
+        }
         _imageInfoMutex.unlock();
 
-        AsyncStruct *asyncStruct = imageInfo->asyncStruct;
-        Image *image = imageInfo->image;
+        if (asyncStruct == nullptr)
+        {
+            break;
+        }
+        ++_nextDeliveryTicket;
+        uploaded = true;
 
+        Image *image = asyncStruct->image;
         const std::string& filename = asyncStruct->filename;
 
         Texture2D *texture = nullptr;
-        if (image)
+        auto it = _textures.find(filename);
+        if (it != _textures.end())
+        {
+            // loaded synchronously in the meantime
+            texture = it->second;
+        }
+        else if (image)
         {
             // generate texture in render thread
             texture = new (std::nothrow) Texture2D();
 
             texture->initWithImage(image);
+            uploadedBytes += image->getDataLen();
 
 #if CC_ENABLE_CACHE_TEXTURE_DATA
             // cache the texture file name
@@ -285,31 +332,66 @@ void TextureCache::addImageAsyncCallBack(float dt)
             texture->retain();
 
             texture->autorelease();
+
+            if (_asyncMipmapsEnabled && !texture->hasMipmaps()
+                && texture->getPixelsWide() == ccNextPOT(texture->getPixelsWide())
+                && texture->getPixelsHigh() == ccNextPOT(texture->getPixelsHigh()))
+            {
+                texture->retain();
+                _pendingMipmapTextures.push_back(std::make_pair(filename, texture));
+            }
         }
-        else
+
+        if (image)
         {
-            auto it = _textures.find(asyncStruct->filename);
-            if(it != _textures.end())
-                texture = it->second;
+            _asyncDecodeTimes[filename] = asyncStruct->decodeTime;
+            _asyncTotalDecodeTime += asyncStruct->decodeTime;
+            ++_asyncLoadedCount;
         }
-        
-        if (asyncStruct->callback)
+
+        _asyncStructsInFlight.erase(filename);
+
+        // a failed decode doesn't invoke the callbacks
+        if (texture)
         {
-            asyncStruct->callback(texture);
+            for (auto& callback : asyncStruct->callbacks)
+            {
+                if (callback)
+                {
+                    callback(texture);
+                }
+            }
         }
-        
-        if(image)
-        {
-            image->release();
-        }       
+
+        CC_SAFE_RELEASE(image);
         delete asyncStruct;
-        delete imageInfo;
 
         --_asyncRefCount;
-        if (0 == _asyncRefCount)
+    }
+
+    // deferred mipmaps only use what is left of the budget, or an otherwise idle frame
+    while (!_pendingMipmapTextures.empty() && (!uploaded || hasAsyncUploadBudget(start, uploadedBytes)))
+    {
+        std::string key = std::move(_pendingMipmapTextures.front().first);
+        Texture2D *texture = _pendingMipmapTextures.front().second;
+        _pendingMipmapTextures.pop_front();
+        uploaded = true;
+
+        // a texture removed from the cache in the meantime isn't worth the work
+        auto it = _textures.find(key);
+        if (it != _textures.end() && it->second == texture && !texture->hasMipmaps())
         {
-            Director::getInstance()->getScheduler()->unschedule(CC_SCHEDULE_SELECTOR(TextureCache::addImageAsyncCallBack), this);
+            texture->generateMipmap();
+            // the mip chain adds about a third of the base level
+            uploadedBytes += texture->getPixelsWide() * texture->getPixelsHigh() * texture->getBitsPerPixelForFormat() / 8 / 3;
         }
+        texture->release();
+    }
+
+    if (0 == _asyncRefCount && _pendingMipmapTextures.empty())
+    {
+        Director::getInstance()->getScheduler()->unschedule(CC_SCHEDULE_SELECTOR(TextureCache::addImageAsyncCallBack), this);
+        _asyncCallbackScheduled = false;
     }
 }
 
@@ -526,10 +608,16 @@ void TextureCache::reloadAllTextures()
 
 void TextureCache::waitForQuit()
 {
-    // notify sub thread to quick
+    // notify sub threads to quit, they finish the queued requests first
+    _asyncStructQueueMutex.lock();
     _needQuit = true;
-    _sleepCondition.notify_one();
-    if (_loadingThread) _loadingThread->join();
+    _asyncStructQueueMutex.unlock();
+    _sleepCondition.notify_all();
+    for (auto thread : _loadingThreads)
+    {
+        if (thread->joinable())
+            thread->join();
+    }
 }
 
 std::string TextureCache::getCachedTextureInfo() const
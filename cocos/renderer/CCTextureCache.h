@@ -32,9 +32,13 @@ THE SOFTWARE.
 #include <mutex>
 #include <thread>
 #include <condition_variable>
+#include <chrono>
 #include <queue>
+#include <deque>
 #include <string>
 #include <unordered_map>
+#include <map>
+#include <vector>
 #include <functional>
 
 #include "base/CCRef.h"
@@ -121,6 +125,82 @@ public:
      @since v0.8
     */
     virtual void addImageAsync(const std::string &filepath, const std::function<void(Texture2D*)>& callback);
+
+    /** Same as addImageAsync(filepath, callback), with a decode priority.
+    * Requests with a higher priority are decoded first; requests with the same priority are decoded in the order they were made.
+    * Callbacks are always invoked in the order the decode workers picked the requests up, one texture per frame.
+    * If the same file is already being loaded, the callback is attached to that request instead of decoding the file again,
+    * and the priority of the pending request is left unchanged.
+     @param filepath A null terminated string.
+     @param callback A callback function would be inovked after the image is loaded.
+     @param priority The decode priority, 0 by default.
+    */
+    virtual void addImageAsync(const std::string &filepath, const std::function<void(Texture2D*)>& callback, int priority);
+
+    /** Sets the number of threads used to decode images for addImageAsync.
+    * Default is 1. Raising it takes effect with the next asynchronous request; lowering it doesn't stop threads that are already running.
+    * @param count The number of decode threads, at least 1.
+    */
+    void setAsyncWorkerCount(int count);
+
+    /** Gets the number of threads used to decode images for addImageAsync. */
+    int getAsyncWorkerCount() const { return _asyncWorkerCount; }
+
+    /** Sets how much main thread time addImageAsync may spend uploading textures in one frame.
+    * Decoded images are uploaded one after another until the budget is spent; at least one image is uploaded per frame.
+    * Default is 0, which together with a byte budget of 0 keeps the original behaviour of one upload per frame.
+    * @param milliseconds The per frame time budget, 0 to disable the time limit.
+    */
+    void setAsyncUploadTimeBudget(float milliseconds) { _asyncUploadTimeBudget = milliseconds; }
+
+    /** Gets the per frame upload time budget, in milliseconds. */
+    float getAsyncUploadTimeBudget() const { return _asyncUploadTimeBudget; }
+
+    /** Sets how many bytes of decoded image data addImageAsync may upload in one frame.
+    * @param bytes The per frame byte budget, 0 to disable the byte limit.
+    */
+    void setAsyncUploadByteBudget(size_t bytes) { _asyncUploadByteBudget = bytes; }
+
+    /** Gets the per frame upload byte budget. */
+    size_t getAsyncUploadByteBudget() const { return _asyncUploadByteBudget; }
+
+    /** Sets whether textures loaded by addImageAsync get mipmaps.
+    * The mipmaps are generated in a later frame, from the upload budget left after the pending uploads,
+    * so the callback receives a texture without mipmaps. Only power of two textures without mipmaps are affected.
+    * The min filter isn't changed; use Texture2D::setTexParameters once Texture2D::hasMipmaps() returns true.
+    * Default is false.
+    */
+    void setAsyncMipmapsEnabled(bool enabled) { _asyncMipmapsEnabled = enabled; }
+
+    /** Whether textures loaded by addImageAsync get mipmaps. */
+    bool isAsyncMipmapsEnabled() const { return _asyncMipmapsEnabled; }
+
+    /** Counters of the asynchronous loader. */
+    struct AsyncLoadStats
+    {
+        /** Requests waiting for a decode thread. */
+        size_t queued;
+        /** Requests being decoded right now. */
+        size_t decoding;
+        /** Decoded images waiting to be uploaded on the main thread. */
+        size_t decoded;
+        /** Requests that were attached to a file already being loaded. */
+        size_t coalesced;
+        /** Textures waiting for their deferred mipmaps. */
+        size_t pendingMipmaps;
+        /** Textures delivered since the cache was created. */
+        unsigned int loaded;
+        /** Total time, in seconds, spent decoding the delivered images. */
+        float totalDecodeTime;
+    };
+
+    /** Returns a snapshot of the asynchronous loader counters. */
+    AsyncLoadStats getAsyncLoadStats() const;
+
+    /** Returns the time, in seconds, the last asynchronous decode of a file took, or -1 if the file wasn't loaded asynchronously.
+     @param filepath It's the related/absolute path of the file image.
+    */
+    float getAsyncDecodeTime(const std::string &filepath) const;
     
     /** Unbind a specified bound image asynchronous callback.
      * In the case an object who was bound to an image asynchronous callback was destroyed before the callback is invoked,
@@ -198,39 +278,75 @@ public:
 private:
     void addImageAsyncCallBack(float dt);
     void loadImage();
+    bool hasAsyncUploadBudget(const std::chrono::steady_clock::time_point& start, size_t uploadedBytes) const;
 
 public:
     struct AsyncStruct
     {
     public:
-        AsyncStruct(const std::string& fn, std::function<void(Texture2D*)> f) : filename(fn), callback(f) {}
+        AsyncStruct(const std::string& fn, std::function<void(Texture2D*)> f, int p, unsigned int seq)
+        : filename(fn), priority(p), sequence(seq), ticket(0), image(nullptr), decodeTime(0)
+        {
+            callbacks.push_back(f);
+        }
 
         std::string filename;
-        std::function<void(Texture2D*)> callback;
+        // touched only on the main thread
+        std::vector<std::function<void(Texture2D*)>> callbacks;
+        int priority;
+        unsigned int sequence;
+        // delivery order, assigned when a decode thread picks the request up
+        unsigned int ticket;
+        Image *image;
+        float decodeTime;
     };
 
 protected:
-    typedef struct _ImageInfo
+    struct AsyncStructCompare
     {
-        AsyncStruct *asyncStruct;
-        Image        *image;
-    } ImageInfo;
-    
-    std::thread* _loadingThread;
+        bool operator()(const AsyncStruct* a, const AsyncStruct* b) const
+        {
+            if (a->priority != b->priority)
+                return a->priority < b->priority;
+            return a->sequence > b->sequence;
+        }
+    };
 
-    std::queue<AsyncStruct*>* _asyncStructQueue;
-    std::deque<ImageInfo*>* _imageInfoQueue;
+    std::vector<std::thread*> _loadingThreads;
+    int _asyncWorkerCount;
 
-    std::mutex _asyncStructQueueMutex;
-    std::mutex _imageInfoMutex;
+    // guarded by _asyncStructQueueMutex
+    std::priority_queue<AsyncStruct*, std::vector<AsyncStruct*>, AsyncStructCompare> _asyncStructQueue;
+    unsigned int _nextAsyncTicket;
+    size_t _asyncDecodingCount;
+
+    // guarded by _imageInfoMutex, keyed by ticket
+    std::map<unsigned int, AsyncStruct*> _decodedAsyncStructs;
+
+    mutable std::mutex _asyncStructQueueMutex;
+    mutable std::mutex _imageInfoMutex;
 
-    std::mutex _sleepMutex;
     std::condition_variable _sleepCondition;
 
     bool _needQuit;
 
     int _asyncRefCount;
 
+    // main thread only
+    std::unordered_map<std::string, AsyncStruct*> _asyncStructsInFlight;
+    std::unordered_map<std::string, float> _asyncDecodeTimes;
+    unsigned int _nextAsyncSequence;
+    unsigned int _nextDeliveryTicket;
+    size_t _asyncCoalescedCount;
+    unsigned int _asyncLoadedCount;
+    float _asyncTotalDecodeTime;
+    bool _asyncCallbackScheduled;
+
+    float _asyncUploadTimeBudget;
+    size_t _asyncUploadByteBudget;
+    bool _asyncMipmapsEnabled;
+    std::deque<std::pair<std::string, Texture2D*>> _pendingMipmapTextures;  ///< cache key and texture
+
     std::unordered_map<std::string, Texture2D*> _textures;
 };
 
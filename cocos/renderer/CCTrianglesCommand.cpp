@@ -26,7 +26,7 @@
 #include "renderer/ccGLStateCache.h"
 #include "renderer/CCGLProgram.h"
 #include "renderer/CCGLProgramState.h"
-#include "xxhash.h"
+#include "renderer/CCMaterialIDCache.h"
 #include "renderer/CCRenderer.h"
 
 NS_CC_BEGIN
@@ -35,6 +35,7 @@ TrianglesCommand::TrianglesCommand()
 :_materialID(0)
 ,_textureID(0)
 ,_glProgramState(nullptr)
+,_glProgramStateVersion(0)
 ,_blendType(BlendFunc::DISABLE)
 {
     _type = RenderCommand::Type::TRIANGLES_COMMAND;
@@ -56,11 +57,13 @@ void TrianglesCommand::init(float globalOrder, GLuint textureID, GLProgramState*
     }
     _mv = mv;
     
-    if( _textureID != textureID || _blendType.src != blendType.src || _blendType.dst != blendType.dst || _glProgramState != glProgramState) {
+    if( _textureID != textureID || _blendType.src != blendType.src || _blendType.dst != blendType.dst || _glProgramState != glProgramState ||
+       _glProgramStateVersion != glProgramState->getMaterialVersion()) {
         
         _textureID = textureID;
         _blendType = blendType;
         _glProgramState = glProgramState;
+        _glProgramStateVersion = glProgramState->getMaterialVersion();
         
         generateMaterialID();
     }
@@ -84,10 +87,8 @@ void TrianglesCommand::generateMaterialID()
     }
     else
     {
-        int glProgram = (int)_glProgramState->getGLProgram()->getProgram();
-        int intArray[4] = { glProgram, (int)_textureID, (int)_blendType.src, (int)_blendType.dst};
-        
-        _materialID = XXH32((const void*)intArray, sizeof(intArray), 0);
+        GLuint glProgram = _glProgramState->getGLProgram()->getProgram();
+        _materialID = MaterialIDCache::getInstance()->getMaterialID(glProgram, _textureID, _blendType);
     }
 }
 
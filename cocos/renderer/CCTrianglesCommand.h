@@ -104,6 +104,8 @@ protected:
     GLuint _textureID;
     /**GLprogramstate for the commmand. encapsulate shaders and uniforms.*/
     GLProgramState* _glProgramState;
+    /**Material version of _glProgramState when _materialID was generated.*/
+    uint32_t _glProgramStateVersion;
     /**Blend function when rendering the triangles.*/
     BlendFunc _blendType;
     /**Rendered triangles.*/